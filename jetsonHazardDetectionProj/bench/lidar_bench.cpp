@@ -0,0 +1,1756 @@
+/**************************************************************************************************************
+ * Lidar benchmark
+ *
+ * Description:
+ * Microbenchmarks of the lidar SDK hot paths, built without jetson-inference or CUDA so the same numbers
+ * can be taken on the Jetson and on an x86 dev box:
+ *
+ *     varbitscale          decoder::varbitscaleDecode on every scale level
+ *     decoder              express, dense and ultra capsule decoders, once per available vector path
+ *     crc32                crc32::getResult on an HQ frame and on a 4 KiB block, once per path
+ *     parse                rx ring fill, frame search, check and decode of every answer type, fed from
+ *                          in-memory byte streams (parse/express/legacy is the former byte-wise reader)
+ *     ascend               scan_order::ascendQ14 behind ascendScanData, and the former float version
+ *     sector, soa          closest return in a sector on packed nodes against the structure-of-arrays
+ *     event                rp::hal::Event wake latency between two threads, and set() without waiter
+ *     udp                  ultra capsules over loopback UDP, read through the UDP channel's batched receive
+ *                          and by the former select and recvfrom per datagram (udp/loopback/recvfrom)
+ *     tcp                  express capsules streamed by a local TCP replay server, parsed through the rx ring
+ *                          on the TCP channel and by the byte-wise reader on the former channel (tcp/replay/legacy)
+ *
+ * With --lidar (a real device or tools/lidar_emulator) the live cases run as well:
+ *
+ *     live                 1..N devices on one fleet reactor at each --baud: nodes/s, CPU and read syscalls
+ *     replay               a recorded session of the first device decoded again as fast as possible
+ *
+ * Every case is calibrated to run at least --min-ms per repetition, warmed up until two repetitions in a
+ * row agree within 2 % (or 10 times --warmup-ms passed), then measured --reps times. The median time per
+ * item is reported along with the fastest and slowest repetition and the median absolute deviation.
+ * Results go to stdout as a table and with --json to a file, one result per line, which --baseline
+ * reads back to show the speedup against an earlier run.
+ *
+ * Example:
+ *     ./lidar_bench --json x86_before.json --tag before
+ *     ./lidar_bench --baseline x86_before.json --filter decoder/
+ *     ./lidar_emulator --link /tmp/ttyLIDAR --devices 4 &
+ *     ./lidar_bench --filter live/ --lidar /tmp/ttyLIDAR0 --lidar /tmp/ttyLIDAR1 --baud 115200,1000000
+ *
+ * Author: pontred
+ *************************************************************************************************************/
+#include "sl_lidar.h"
+#include "sl_lidar_recording.h"
+#include "sl_crc.h"
+#include "sdkcommon.h"
+#include "hal/event.h"
+#include "hal/socket.h"
+#include "sl_capsule_decoder.h"
+#include "sl_rx_ring.h"
+#include "sl_scan_order.h"
+#include "sl_scan_soa.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sl;
+
+#define DEFAULT_REPS            15
+#define DEFAULT_MIN_REP_MS      20
+#define DEFAULT_WARMUP_MS       200
+#define WARMUP_AGREEMENT        0.02
+#define SCAN_NODES              800
+#define STREAM_REVOLUTIONS      8
+#define EVENT_ROUND_TRIPS       20000
+#define LIVE_SETTLE_MS          1000
+#define UDP_BURST               32      // datagrams sent before the receiver catches up, far below the socket buffer
+#define TCP_REPLAY_CHUNK        4096    // bytes the TCP replay server writes at once
+
+struct BenchOptions
+{
+    int         reps;
+    int         min_rep_ms;
+    int         warmup_ms;
+    const char* filter;
+    const char* json_path;
+    const char* baseline_path;
+    const char* tag;
+    bool        list_only;
+    std::vector<const char*> lidars;
+    std::vector<int>         bauds;
+    float       live_seconds;
+};
+
+struct BenchResult
+{
+    std::string name;
+    std::string unit;
+    double      ns_per_item;    // median over the repetitions, p50 for latencies
+    double      min_ns;
+    double      max_ns;
+    double      mad_pct;        // median absolute deviation, in percent of the median
+    double      p99_ns;         // latencies only
+    double      items_per_s;
+    int         reps;
+    size_t      iterations;     // iterations of the case body per repetition
+    std::string extra;          // additional JSON members, starting with a comma
+};
+
+/**
+ * A case runs body(iterations) and gets back the number of items (nodes, bytes...) processed.
+ * setup runs once before the warm-up, e.g. to pin a decoder path, and teardown after the measurement.
+ * extra, if set, returns JSON members (starting with a comma) from counters the body kept.
+ */
+struct BenchCase
+{
+    std::string name;
+    const char* unit;
+    std::function<size_t(size_t)> body;
+    std::function<bool()> setup;
+    std::function<void()> teardown;
+    std::function<std::string()> extra;
+};
+
+// results feed this so the compiler cannot drop the measured work
+static volatile sl_u64 g_sink;
+
+static BenchOptions g_options;
+static std::vector<BenchResult> g_results;
+
+static bool selected(const std::string& name){
+    return !g_options.filter || strstr(name.c_str(), g_options.filter) != NULL;
+}
+
+// small deterministic generator, the streams are identical on every host
+static sl_u32 g_seed = 0x12345678;
+static sl_u32 next_random(){
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 17;
+    g_seed ^= g_seed << 5;
+    return g_seed;
+}
+
+static sl_u32 random_distance_mm(){
+    return 150 + next_random() % 11850;
+}
+
+static double median_of(std::vector<double> values){
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return (n & 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+//
+// Harness
+//
+
+// median, spread and rate of the time per item measured by each repetition
+static void summarize(const std::vector<double>& perItem, BenchResult& result){
+    result.ns_per_item = median_of(perItem);
+    result.min_ns = *std::min_element(perItem.begin(), perItem.end());
+    result.max_ns = *std::max_element(perItem.begin(), perItem.end());
+    std::vector<double> deviation;
+    for(size_t i = 0; i < perItem.size(); i++){
+        deviation.push_back(fabs(perItem[i] - result.ns_per_item));
+    }
+    result.mad_pct = result.ns_per_item > 0 ? median_of(deviation) * 100 / result.ns_per_item : 0;
+    result.p99_ns = 0;
+    result.items_per_s = result.ns_per_item > 0 ? 1e9 / result.ns_per_item : 0;
+    result.reps = (int)perItem.size();
+}
+
+static double time_body(const BenchCase& c, size_t iterations, size_t& items){
+    sl_u64 start = getns();
+    items = c.body(iterations);
+    sl_u64 elapsed = getns() - start;
+    return (double)elapsed;
+}
+
+static void run_case(const BenchCase& c){
+    if(!selected(c.name)) return;
+    if(g_options.list_only){
+        printf("%s\n", c.name.c_str());
+        return;
+    }
+    if(c.setup && !c.setup()){
+        printf("%-40s skipped\n", c.name.c_str());
+        return;
+    }
+
+// grow the batch until one repetition lasts min_rep_ms
+    const double minRepNs = g_options.min_rep_ms * 1e6;
+    size_t iterations = 1;
+    size_t items = 0;
+    for(;;){
+        double ns = time_body(c, iterations, items);
+        if(ns >= minRepNs) break;
+        double scale = ns > 0 ? minRepNs * 1.2 / ns : 16;
+        if(scale > 16) scale = 16;
+        if(scale < 2) scale = 2;
+        iterations = (size_t)(iterations * scale);
+    }
+
+// warm up until two repetitions in a row agree, caches, branch predictors and the CPU clock settle
+    sl_u64 warmupStart = getns();
+    double last = 0;
+    for(;;){
+        double ns = time_body(c, iterations, items) / (items ? items : 1);
+        double warmed = (double)(getns() - warmupStart);
+        bool stable = last > 0 && fabs(ns - last) <= WARMUP_AGREEMENT * last;
+        if((stable && warmed >= g_options.warmup_ms * 1e6) || warmed >= g_options.warmup_ms * 1e7) break;
+        last = ns;
+    }
+
+    std::vector<double> perItem;
+    for(int r = 0; r < g_options.reps; r++){
+        double ns = time_body(c, iterations, items);
+        perItem.push_back(ns / (items ? items : 1));
+    }
+
+    BenchResult result;
+    result.name = c.name;
+    result.unit = c.unit;
+    summarize(perItem, result);
+    result.iterations = iterations;
+    if(c.extra) result.extra = c.extra();
+    if(c.teardown) c.teardown();
+    g_results.push_back(result);
+
+    printf("%-40s %10.3f ns/%-5s %14.0f %s/s   min %.3f max %.3f mad %.1f%%%s%s\n", result.name.c_str(),
+        result.ns_per_item, c.unit, result.items_per_s, c.unit, result.min_ns, result.max_ns, result.mad_pct,
+        result.extra.empty() ? "" : "  ", result.extra.empty() ? "" : result.extra.c_str() + 2);
+}
+
+//
+// Generated input
+//
+
+static void seal_capsule(sl_u8* frame, size_t size){
+    // xor of everything from the start angle on, split over the sync nibbles
+    sl_u8 checksum = 0;
+    for(size_t i = 2; i < size; i++){
+        checksum ^= frame[i];
+    }
+    frame[0] = (SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xF);
+    frame[1] = (SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4);
+}
+
+// start angles of consecutive capsules of samplesPerCapsule samples, pointsPerRev samples per turn
+static sl_u16 capsule_start_angle(size_t index, size_t samplesPerCapsule, size_t pointsPerRev, bool& sync){
+    size_t sample = index * samplesPerCapsule;
+    size_t inRev = sample % pointsPerRev;
+    sync = inRev < samplesPerCapsule;
+    return (sl_u16)((inRev * 360 * 64) / pointsPerRev);
+}
+
+static std::vector<sl_u8> make_capsule_stream(size_t pointsPerRev){
+    std::vector<sl_u8> stream;
+    size_t count = STREAM_REVOLUTIONS * pointsPerRev / 32;
+    for(size_t i = 0; i < count; i++){
+        sl_lidar_response_capsule_measurement_nodes_t capsule;
+        bool sync;
+        sl_u16 angle = capsule_start_angle(i, 32, pointsPerRev, sync);
+        capsule.start_angle_sync_q6 = angle | (sync ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0);
+        for(size_t c = 0; c < _countof(capsule.cabins); c++){
+            sl_u32 offsets = next_random();
+            capsule.cabins[c].distance_angle_1 = (sl_u16)((random_distance_mm() << 2) | ((offsets >> 4) & 0x3));
+            capsule.cabins[c].distance_angle_2 = (sl_u16)((random_distance_mm() << 2) | ((offsets >> 8) & 0x3));
+            capsule.cabins[c].offset_angles_q3 = (sl_u8)offsets;
+        }
+        sl_u8* frame = reinterpret_cast<sl_u8*>(&capsule);
+        seal_capsule(frame, sizeof(capsule));
+        stream.insert(stream.end(), frame, frame + sizeof(capsule));
+    }
+    return stream;
+}
+
+static std::vector<sl_u8> make_dense_stream(size_t pointsPerRev){
+    std::vector<sl_u8> stream;
+    size_t count = STREAM_REVOLUTIONS * pointsPerRev / 40;
+    for(size_t i = 0; i < count; i++){
+        sl_lidar_response_dense_capsule_measurement_nodes_t capsule;
+        bool sync;
+        sl_u16 angle = capsule_start_angle(i, 40, pointsPerRev, sync);
+        capsule.start_angle_sync_q6 = angle | (sync ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0);
+        for(size_t c = 0; c < _countof(capsule.cabins); c++){
+            capsule.cabins[c].distance = (sl_u16)random_distance_mm();
+        }
+        sl_u8* frame = reinterpret_cast<sl_u8*>(&capsule);
+        seal_capsule(frame, sizeof(capsule));
+        stream.insert(stream.end(), frame, frame + sizeof(capsule));
+    }
+    return stream;
+}
+
+static std::vector<sl_u8> make_ultra_stream(size_t pointsPerRev){
+    std::vector<sl_u8> stream;
+    size_t count = STREAM_REVOLUTIONS * pointsPerRev / 96;
+    for(size_t i = 0; i < count; i++){
+        sl_lidar_response_ultra_capsule_measurement_nodes_t capsule;
+        bool sync;
+        sl_u16 angle = capsule_start_angle(i, 96, pointsPerRev, sync);
+        capsule.start_angle_sync_q6 = angle | (sync ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0);
+        for(size_t c = 0; c < _countof(capsule.ultra_cabins); c++){
+            // every scale level of the major distance, predictions within +-64 and now and then "no return"
+            sl_u32 bits = next_random();
+            sl_u32 major = bits & 0xFFF;
+            sl_u32 predict1 = (bits >> 12) & 0x7F;
+            sl_u32 predict2 = (bits & 0x100000) ? 0x1FF : ((bits >> 20) & 0x3F);
+            capsule.ultra_cabins[c].combined_x3 = major | (predict1 << 12) | (predict2 << 22);
+        }
+        sl_u8* frame = reinterpret_cast<sl_u8*>(&capsule);
+        seal_capsule(frame, sizeof(capsule));
+        stream.insert(stream.end(), frame, frame + sizeof(capsule));
+    }
+    return stream;
+}
+
+static void make_scan(sl_lidar_response_measurement_node_hq_t* nodes, size_t count, size_t first){
+    for(size_t i = 0; i < count; i++){
+        size_t sample = first + i;
+        nodes[i].angle_z_q14 = (sl_u16)(((sample % count) << 16) / count);
+        nodes[i].dist_mm_q2 = random_distance_mm() << 2;
+        nodes[i].quality = (sl_u8)(next_random() & 0xFC);
+        nodes[i].flag = (sample % count) == 0 ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+    }
+}
+
+static std::vector<sl_u8> make_hq_stream(size_t pointsPerRev){
+    std::vector<sl_u8> stream;
+    size_t count = STREAM_REVOLUTIONS * pointsPerRev / 96;
+    for(size_t i = 0; i < count; i++){
+        sl_lidar_response_hq_capsule_measurement_nodes_t capsule;
+        capsule.sync_byte = SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC;
+        capsule.time_stamp = i * 12000;
+        sl_lidar_response_measurement_node_hq_t nodes[96];
+        make_scan(nodes, 96, i * 96);
+        for(size_t n = 0; n < 96; n++){
+            nodes[n].angle_z_q14 = (sl_u16)((((i * 96 + n) % pointsPerRev) << 16) / pointsPerRev);
+            nodes[n].flag = ((i * 96 + n) % pointsPerRev) == 0 ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+            capsule.node_hq[n] = nodes[n];
+        }
+        sl_u8* frame = reinterpret_cast<sl_u8*>(&capsule);
+        capsule.crc32 = crc32::getResult(frame, sizeof(capsule) - 4);
+        stream.insert(stream.end(), frame, frame + sizeof(capsule));
+    }
+    return stream;
+}
+
+static std::vector<sl_u8> make_standard_stream(size_t pointsPerRev){
+    std::vector<sl_u8> stream;
+    size_t count = STREAM_REVOLUTIONS * pointsPerRev;
+    for(size_t i = 0; i < count; i++){
+        sl_lidar_response_measurement_node_t node;
+        bool sync = (i % pointsPerRev) == 0;
+        node.sync_quality = (sync ? 0x1 : 0x2) | (sl_u8)((next_random() & 0x3F) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT);
+        node.angle_q6_checkbit = (sl_u16)(((((i % pointsPerRev) * 360 * 64) / pointsPerRev) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT);
+        node.distance_q2 = (sl_u16)(random_distance_mm() << 2);
+        const sl_u8* frame = reinterpret_cast<const sl_u8*>(&node);
+        stream.insert(stream.end(), frame, frame + sizeof(node));
+    }
+    return stream;
+}
+
+/**
+ * Channel reading an in-memory byte stream in a loop, as if the lidar had sent it
+ */
+class MemoryChannel : public IChannel
+{
+public:
+    MemoryChannel(const std::vector<sl_u8>& stream)
+        : _stream(stream)
+        , _pos(0)
+    {
+    }
+
+    virtual bool open() { return true; }
+    virtual void close() {}
+    virtual void flush() {}
+    virtual void clearReadCache() {}
+    virtual int write(const void* data, size_t size) { return (int)size; }
+
+    virtual bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+    {
+        if(actualReady) *actualReady = _stream.size() - _pos;
+        return true;
+    }
+
+    virtual int read(void* buffer, size_t size)
+    {
+        size_t ready = _stream.size() - _pos;
+        if(size > ready) size = ready;
+        memcpy(buffer, &_stream[_pos], size);
+        _pos += size;
+        if(_pos == _stream.size()) _pos = 0;
+        return (int)size;
+    }
+
+    virtual int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+    {
+        // a wrap in the middle of the wanted size is completed by a second copy
+        int got = read(buffer, size);
+        if((size_t)got < minSize && (size_t)got < size){
+            got += read((sl_u8*)buffer + got, size - got);
+        }
+        return got;
+    }
+
+private:
+    const std::vector<sl_u8>& _stream;
+    size_t _pos;
+};
+
+/**
+ * Frame reader and decoder state of the driver, on a memory channel
+ */
+struct ParseState
+{
+    ParseState(const std::vector<sl_u8>& stream)
+        : channel(stream)
+        , previousReady(false)
+        , lastSyncBit(0)
+        , synced(false)
+    {
+    }
+
+    const sl_u8* wait(LidarFrameType type){
+        const sl_u8* frame;
+        size_t skipped;
+        for(;;){
+            int status = ring.nextFrame(type, frame, skipped);
+            if(skipped) previousReady = false;
+            if(status == LidarRxRing::FRAME_FOUND) return frame;
+            if(status == LidarRxRing::FRAME_NEED_MORE) ring.fill(&channel, LidarRxRing::frameSize(type), 0);
+        }
+    }
+
+    MemoryChannel channel;
+    LidarRxRing ring;
+    bool previousReady;
+    int lastSyncBit;
+    bool synced;
+    sl_lidar_response_capsule_measurement_nodes_t capsule;
+    sl_lidar_response_dense_capsule_measurement_nodes_t dense;
+    sl_lidar_response_ultra_capsule_measurement_nodes_t ultra;
+    sl_lidar_response_measurement_node_hq_t nodes[128];
+};
+
+/**
+ * The byte-wise capsule reader the driver used before the rx ring, kept to compare with
+ */
+static sl_result legacy_wait_capsule(IChannel* channel, sl_lidar_response_capsule_measurement_nodes_t& node, bool& previousReady, sl_u32 timeout = 0){
+    int recvPos = 0;
+    sl_u8 recvBuffer[sizeof(sl_lidar_response_capsule_measurement_nodes_t)];
+    sl_u8* nodeBuffer = (sl_u8*)&node;
+    for(;;){
+        size_t remainSize = sizeof(sl_lidar_response_capsule_measurement_nodes_t) - recvPos;
+        size_t recvSize;
+        if(!channel->waitForData(remainSize, timeout, &recvSize)) return SL_RESULT_OPERATION_TIMEOUT;
+        if(recvSize > remainSize) recvSize = remainSize;
+        recvSize = channel->read(recvBuffer, recvSize);
+
+        for(size_t pos = 0; pos < recvSize; ++pos){
+            sl_u8 currentByte = recvBuffer[pos];
+            if(recvPos == 0 && (currentByte >> 4) != SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1){
+                previousReady = false;
+                continue;
+            }
+            if(recvPos == 1 && (currentByte >> 4) != SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2){
+                recvPos = 0;
+                previousReady = false;
+                continue;
+            }
+            nodeBuffer[recvPos++] = currentByte;
+            if(recvPos == sizeof(sl_lidar_response_capsule_measurement_nodes_t)){
+                sl_u8 checksum = 0;
+                sl_u8 recvChecksum = ((node.s_checksum_1 & 0xF) | (node.s_checksum_2 << 4));
+                for(size_t cpos = offsetof(sl_lidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
+                    cpos < sizeof(sl_lidar_response_capsule_measurement_nodes_t); ++cpos){
+                    checksum ^= nodeBuffer[cpos];
+                }
+                if(recvChecksum == checksum){
+                    if(node.start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) previousReady = false;
+                    return SL_RESULT_OK;
+                }
+                previousReady = false;
+                return SL_RESULT_INVALID_DATA;
+            }
+        }
+    }
+}
+
+//
+// Cases
+//
+
+static void add_varbitscale_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<std::vector<sl_u32> > values(new std::vector<sl_u32>(4096));
+    for(size_t i = 0; i < values->size(); i++){
+        (*values)[i] = next_random() & 0xFFF;
+    }
+    BenchCase c;
+    c.name = "varbitscale/scalar";
+    c.unit = "node";
+    c.body = [values](size_t iterations) -> size_t {
+        sl_u64 sum = 0;
+        const std::vector<sl_u32>& v = *values;
+        for(size_t it = 0; it < iterations; it++){
+            for(size_t i = 0; i < v.size(); i++){
+                sl_u32 level;
+                sum += decoder::varbitscaleDecode(v[i], level) + level;
+            }
+        }
+        g_sink = sum;
+        return iterations * v.size();
+    };
+    cases.push_back(c);
+}
+
+static void add_decoder_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<std::vector<sl_u8> > express(new std::vector<sl_u8>(make_capsule_stream(400)));
+    std::shared_ptr<std::vector<sl_u8> > dense(new std::vector<sl_u8>(make_dense_stream(800)));
+    std::shared_ptr<std::vector<sl_u8> > ultra(new std::vector<sl_u8>(make_ultra_stream(800)));
+    std::shared_ptr<decoder::DecoderPath> initialPath(new decoder::DecoderPath(decoder::activePath()));
+
+    for(int p = 0; p < decoder::DECODER_PATH_COUNT; p++){
+        decoder::DecoderPath path = (decoder::DecoderPath)p;
+        if(!decoder::isPathAvailable(path)) continue;
+        BenchCase c;
+        c.unit = "node";
+        c.setup = [path]() { return decoder::selectPath(path); };
+        c.teardown = [initialPath]() { decoder::selectPath(*initialPath); };
+
+        c.name = std::string("decoder/capsule/") + decoder::pathName(path);
+        c.body = [express](size_t iterations) -> size_t {
+            typedef sl_lidar_response_capsule_measurement_nodes_t Frame;
+            const Frame* frames = reinterpret_cast<const Frame*>(&(*express)[0]);
+            size_t count = express->size() / sizeof(Frame);
+            sl_lidar_response_measurement_node_hq_t nodes[128];
+            size_t total = 0;
+            for(size_t it = 0; it < iterations; it++){
+                for(size_t i = 1; i < count; i++){
+                    total += decoder::capsuleToNormal(frames[i - 1], frames[i], nodes);
+                }
+            }
+            g_sink = nodes[0].dist_mm_q2;
+            return total;
+        };
+        cases.push_back(c);
+
+        c.name = std::string("decoder/dense/") + decoder::pathName(path);
+        c.body = [dense](size_t iterations) -> size_t {
+            typedef sl_lidar_response_dense_capsule_measurement_nodes_t Frame;
+            const Frame* frames = reinterpret_cast<const Frame*>(&(*dense)[0]);
+            size_t count = dense->size() / sizeof(Frame);
+            sl_lidar_response_measurement_node_hq_t nodes[128];
+            size_t total = 0;
+            for(size_t it = 0; it < iterations; it++){
+                int lastSyncBit = 0;
+                bool synced = false;
+                for(size_t i = 1; i < count; i++){
+                    total += decoder::denseCapsuleToNormal(frames[i - 1], frames[i], nodes, lastSyncBit, synced);
+                }
+            }
+            g_sink = nodes[0].dist_mm_q2;
+            return total;
+        };
+        cases.push_back(c);
+
+        c.name = std::string("decoder/ultra/") + decoder::pathName(path);
+        c.body = [ultra](size_t iterations) -> size_t {
+            typedef sl_lidar_response_ultra_capsule_measurement_nodes_t Frame;
+            const Frame* frames = reinterpret_cast<const Frame*>(&(*ultra)[0]);
+            size_t count = ultra->size() / sizeof(Frame);
+            sl_lidar_response_measurement_node_hq_t nodes[128];
+            size_t total = 0;
+            for(size_t it = 0; it < iterations; it++){
+                for(size_t i = 1; i < count; i++){
+                    total += decoder::ultraCapsuleToNormal(frames[i - 1], frames[i], nodes);
+                }
+            }
+            g_sink = nodes[0].dist_mm_q2;
+            return total;
+        };
+        cases.push_back(c);
+    }
+}
+
+static void add_crc_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<std::vector<sl_u8> > block(new std::vector<sl_u8>(4096));
+    for(size_t i = 0; i < block->size(); i++){
+        (*block)[i] = (sl_u8)next_random();
+    }
+    std::shared_ptr<crc32::Crc32Path> initialPath(new crc32::Crc32Path(crc32::activePath()));
+    const size_t sizes[] = { sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 4, 4096 };
+
+    for(int p = 0; p < crc32::CRC32_PATH_COUNT; p++){
+        crc32::Crc32Path path = (crc32::Crc32Path)p;
+        if(!crc32::isPathAvailable(path)) continue;
+        for(size_t s = 0; s < _countof(sizes); s++){
+            size_t size = sizes[s];
+            char name[64];
+            snprintf(name, sizeof(name), "crc32/%s/%uB", crc32::pathName(path), (unsigned)size);
+            BenchCase c;
+            c.name = name;
+            c.unit = "byte";
+            c.setup = [path]() { return crc32::selectPath(path); };
+            c.teardown = [initialPath]() { crc32::selectPath(*initialPath); };
+            c.body = [block, size](size_t iterations) -> size_t {
+                sl_u32 crc = 0;
+                for(size_t it = 0; it < iterations; it++){
+                    (*block)[0] = (sl_u8)it;
+                    crc ^= crc32::getResult(&(*block)[0], (sl_u32)size);
+                }
+                g_sink = crc;
+                return iterations * size;
+            };
+            cases.push_back(c);
+        }
+    }
+}
+
+static void add_parse_cases(std::vector<BenchCase>& cases){
+    // the frames a revolution of each mode needs, decoded the way the driver's cache loops do
+    std::shared_ptr<std::vector<sl_u8> > standard(new std::vector<sl_u8>(make_standard_stream(200)));
+    std::shared_ptr<std::vector<sl_u8> > express(new std::vector<sl_u8>(make_capsule_stream(400)));
+    std::shared_ptr<std::vector<sl_u8> > dense(new std::vector<sl_u8>(make_dense_stream(800)));
+    std::shared_ptr<std::vector<sl_u8> > ultra(new std::vector<sl_u8>(make_ultra_stream(800)));
+    std::shared_ptr<std::vector<sl_u8> > hq(new std::vector<sl_u8>(make_hq_stream(800)));
+    BenchCase c;
+    c.unit = "node";
+
+    c.name = "parse/standard";
+    c.body = [standard](size_t iterations) -> size_t {
+        ParseState state(*standard);
+        size_t frames = iterations * standard->size() / sizeof(sl_lidar_response_measurement_node_t);
+        sl_u32 sum = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_lidar_response_measurement_node_t* node = reinterpret_cast<const sl_lidar_response_measurement_node_t*>(state.wait(LIDAR_FRAME_MEASUREMENT_NODE));
+            sl_lidar_response_measurement_node_hq_t& hqNode = state.nodes[0];
+            hqNode.angle_z_q14 = (((node->angle_q6_checkbit) >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;
+            hqNode.quality = (node->sync_quality >> SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;
+            hqNode.flag = (node->sync_quality & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT);
+            hqNode.dist_mm_q2 = node->distance_q2;
+            sum += hqNode.angle_z_q14 + hqNode.dist_mm_q2;
+        }
+        g_sink = sum;
+        return frames;
+    };
+    cases.push_back(c);
+
+    c.name = "parse/express";
+    c.body = [express](size_t iterations) -> size_t {
+        ParseState state(*express);
+        size_t frames = iterations * express->size() / sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_lidar_response_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_capsule_measurement_nodes_t*>(state.wait(LIDAR_FRAME_CAPSULE));
+            if(capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) state.previousReady = false;
+            if(state.previousReady) total += decoder::capsuleToNormal(state.capsule, *capsule, state.nodes);
+            state.capsule = *capsule;
+            state.previousReady = true;
+        }
+        g_sink = state.nodes[0].dist_mm_q2;
+        return total;
+    };
+    cases.push_back(c);
+
+    c.name = "parse/express/legacy";
+    c.body = [express](size_t iterations) -> size_t {
+        MemoryChannel channel(*express);
+        sl_lidar_response_capsule_measurement_nodes_t capsule, previous;
+        sl_lidar_response_measurement_node_hq_t nodes[128];
+        bool previousReady = false;
+        size_t frames = iterations * express->size() / sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            if(SL_IS_FAIL(legacy_wait_capsule(&channel, capsule, previousReady))) continue;
+            if(previousReady) total += decoder::capsuleToNormal(previous, capsule, nodes);
+            previous = capsule;
+            previousReady = true;
+        }
+        g_sink = nodes[0].dist_mm_q2;
+        return total;
+    };
+    cases.push_back(c);
+
+    c.name = "parse/dense";
+    c.body = [dense](size_t iterations) -> size_t {
+        ParseState state(*dense);
+        size_t frames = iterations * dense->size() / sizeof(sl_lidar_response_dense_capsule_measurement_nodes_t);
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_lidar_response_dense_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_dense_capsule_measurement_nodes_t*>(state.wait(LIDAR_FRAME_CAPSULE));
+            if(capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) state.previousReady = false;
+            if(state.previousReady) total += decoder::denseCapsuleToNormal(state.dense, *capsule, state.nodes, state.lastSyncBit, state.synced);
+            state.dense = *capsule;
+            state.previousReady = true;
+        }
+        g_sink = state.nodes[0].dist_mm_q2;
+        return total;
+    };
+    cases.push_back(c);
+
+    c.name = "parse/ultra";
+    c.body = [ultra](size_t iterations) -> size_t {
+        ParseState state(*ultra);
+        size_t frames = iterations * ultra->size() / sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t);
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_lidar_response_ultra_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_ultra_capsule_measurement_nodes_t*>(state.wait(LIDAR_FRAME_ULTRA_CAPSULE));
+            if(capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) state.previousReady = false;
+            if(state.previousReady) total += decoder::ultraCapsuleToNormal(state.ultra, *capsule, state.nodes);
+            state.ultra = *capsule;
+            state.previousReady = true;
+        }
+        g_sink = state.nodes[0].dist_mm_q2;
+        return total;
+    };
+    cases.push_back(c);
+
+    c.name = "parse/hq";
+    c.body = [hq](size_t iterations) -> size_t {
+        ParseState state(*hq);
+        size_t frames = iterations * hq->size() / sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t);
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_lidar_response_hq_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_hq_capsule_measurement_nodes_t*>(state.wait(LIDAR_FRAME_HQ_CAPSULE));
+            for(size_t n = 0; n < _countof(capsule->node_hq); n++){
+                state.nodes[n] = capsule->node_hq[n];
+            }
+            total += _countof(capsule->node_hq);
+        }
+        g_sink = state.nodes[0].dist_mm_q2;
+        return total;
+    };
+    cases.push_back(c);
+}
+
+/**
+ * A revolution the way the device delivers it: ascending from somewhere after 0 degree, wrapping at 360,
+ * with small steps back and a few samples without a return
+ */
+static std::vector<sl_lidar_response_measurement_node_hq_t> make_revolution(size_t count){
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(count);
+    make_scan(&nodes[0], count, count / 7);
+    for(size_t i = 0; i < count; i++){
+        sl_u32 r = next_random();
+        if((r & 0x3F) == 0 && i > 0){
+            sl_u16 angle = nodes[i].angle_z_q14;
+            nodes[i].angle_z_q14 = nodes[i - 1].angle_z_q14;
+            nodes[i - 1].angle_z_q14 = angle;
+        }
+        if((r & 0x700) == 0) nodes[i].dist_mm_q2 = 0;
+    }
+    return nodes;
+}
+
+static void add_ascend_cases(std::vector<BenchCase>& cases){
+    const size_t counts[] = { SCAN_NODES, 4 * SCAN_NODES };
+    for(size_t n = 0; n < _countof(counts); n++){
+        size_t count = counts[n];
+        std::shared_ptr<std::vector<sl_lidar_response_measurement_node_hq_t> > scan(new std::vector<sl_lidar_response_measurement_node_hq_t>(make_revolution(count)));
+        char name[64];
+        BenchCase c;
+        c.unit = "node";
+
+        // each iteration restores the unsorted revolution first, the copy is part of the time
+        snprintf(name, sizeof(name), "ascend/q14/%u", (unsigned)count);
+        c.name = name;
+        c.body = [scan, count](size_t iterations) -> size_t {
+            std::vector<sl_lidar_response_measurement_node_hq_t> work(count), scratchNodes(count);
+            std::vector<sl_u64> timestamps(count), scratchTimestamps(count);
+            for(size_t it = 0; it < iterations; it++){
+                memcpy(&work[0], &(*scan)[0], count * sizeof(work[0]));
+                scan_order::ascendQ14(&work[0], &timestamps[0], count, &scratchNodes[0], &scratchTimestamps[0]);
+            }
+            g_sink = work[count / 2].angle_z_q14;
+            return iterations * count;
+        };
+        cases.push_back(c);
+
+        snprintf(name, sizeof(name), "ascend/float/%u", (unsigned)count);
+        c.name = name;
+        c.body = [scan, count](size_t iterations) -> size_t {
+            std::vector<sl_lidar_response_measurement_node_hq_t> work(count);
+            for(size_t it = 0; it < iterations; it++){
+                memcpy(&work[0], &(*scan)[0], count * sizeof(work[0]));
+                scan_order::ascendFloat(&work[0], count);
+            }
+            g_sink = work[count / 2].angle_z_q14;
+            return iterations * count;
+        };
+        cases.push_back(c);
+    }
+}
+
+struct SoaScan
+{
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+    std::vector<sl_u16> angle_q14;
+    std::vector<sl_u32> dist_q2;
+    std::vector<sl_u8>  quality;
+    std::vector<float>  x;
+    std::vector<float>  y;
+};
+
+static void add_soa_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<SoaScan> scan(new SoaScan);
+    scan->nodes = make_revolution(SCAN_NODES);
+    scan->angle_q14.resize(SCAN_NODES);
+    scan->dist_q2.resize(SCAN_NODES);
+    scan->quality.resize(SCAN_NODES);
+    scan->x.resize(SCAN_NODES);
+    scan->y.resize(SCAN_NODES);
+    scan_soa::splitNodes(&scan->nodes[0], SCAN_NODES, &scan->angle_q14[0], &scan->dist_q2[0], &scan->quality[0]);
+
+    // closest return within 30 degree of the heading, the query of the front sector monitor
+    const sl_u16 halfSector = (sl_u16)(30 * 65536 / 360);
+    BenchCase c;
+    c.unit = "node";
+
+    c.name = "sector/aos";
+    c.body = [scan, halfSector](size_t iterations) -> size_t {
+        sl_u32 closest = 0;
+        for(size_t it = 0; it < iterations; it++){
+            closest = 0xFFFFFFFF;
+            const sl_lidar_response_measurement_node_hq_t* nodes = &scan->nodes[0];
+            for(size_t i = 0; i < SCAN_NODES; i++){
+                sl_u16 offset = (sl_u16)(nodes[i].angle_z_q14 + halfSector);
+                sl_u32 dist = nodes[i].dist_mm_q2;
+                if(offset <= 2 * halfSector && dist && dist < closest) closest = dist;
+            }
+        }
+        g_sink = closest;
+        return iterations * SCAN_NODES;
+    };
+    cases.push_back(c);
+
+    c.name = "sector/soa";
+    c.body = [scan, halfSector](size_t iterations) -> size_t {
+        sl_u32 closest = 0;
+        for(size_t it = 0; it < iterations; it++){
+            closest = 0xFFFFFFFF;
+            const sl_u16* angle = &scan->angle_q14[0];
+            const sl_u32* dist = &scan->dist_q2[0];
+            for(size_t i = 0; i < SCAN_NODES; i++){
+                sl_u16 offset = (sl_u16)(angle[i] + halfSector);
+                sl_u32 d = (offset <= 2 * halfSector && dist[i]) ? dist[i] : 0xFFFFFFFF;
+                closest = d < closest ? d : closest;
+            }
+        }
+        g_sink = closest;
+        return iterations * SCAN_NODES;
+    };
+    cases.push_back(c);
+
+    c.name = "soa/split";
+    c.body = [scan](size_t iterations) -> size_t {
+        for(size_t it = 0; it < iterations; it++){
+            scan_soa::splitNodes(&scan->nodes[0], SCAN_NODES, &scan->angle_q14[0], &scan->dist_q2[0], &scan->quality[0]);
+        }
+        g_sink = scan->dist_q2[SCAN_NODES / 2];
+        return iterations * SCAN_NODES;
+    };
+    cases.push_back(c);
+
+    c.name = "soa/to_cartesian";
+    c.body = [scan](size_t iterations) -> size_t {
+        for(size_t it = 0; it < iterations; it++){
+            scan_soa::toCartesian(&scan->angle_q14[0], &scan->dist_q2[0], SCAN_NODES, &scan->x[0], &scan->y[0]);
+        }
+        g_sink = (sl_u64)scan->x[SCAN_NODES / 2];
+        return iterations * SCAN_NODES;
+    };
+    cases.push_back(c);
+}
+
+static void add_event_cases(std::vector<BenchCase>& cases){
+    BenchCase c;
+    c.name = "event/set_reset_no_waiter";
+    c.unit = "call";
+    c.body = [](size_t iterations) -> size_t {
+        rp::hal::Event event;
+        for(size_t it = 0; it < iterations; it++){
+            event.set();
+            event.set(false);
+        }
+        return iterations;
+    };
+    cases.push_back(c);
+}
+
+/**
+ * Sender end of the UDP cases, it learns the receiver's address from its first datagram like a network
+ * lidar answering a command, then sends bursts of ultra capsules to it
+ */
+struct UdpLoopback
+{
+    rp::net::DGramSocket*   sender;
+    rp::net::SocketAddress  receiver;
+    std::vector<sl_u8>      capsule;
+    std::vector<sl_u8>      buffer;
+    IChannel*               channel;
+    rp::net::DGramSocket*   socket;
+    sl_u64                  calls;
+    sl_u64                  datagrams;
+
+    UdpLoopback() : sender(NULL), channel(NULL), socket(NULL), calls(0), datagrams(0) {}
+
+    bool open(int& port){
+        std::vector<sl_u8> stream = make_ultra_stream(SCAN_NODES);
+        capsule.assign(stream.begin(), stream.begin() + sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t));
+        buffer.resize(8192);
+        sender = rp::net::DGramSocket::CreateSocket();
+        rp::net::SocketAddress local("127.0.0.1", 0);
+        if(!sender || IS_FAIL(sender->bind(local)) || IS_FAIL(sender->getLocalAddress(local))) return false;
+        port = local.getPort();
+        return true;
+    }
+
+    bool accept(){
+        char hello[16];
+        size_t len = 0;
+        if(sender->waitforData(1000) != RESULT_OK) return false;
+        return IS_OK(sender->recvFrom(hello, sizeof(hello), len, &receiver)) && IS_OK(sender->setPairAddress(&receiver));
+    }
+
+    void sendBurst(){
+        for(size_t i = 0; i < UDP_BURST; i++){
+            sender->sendTo(receiver, &capsule[0], capsule.size());
+        }
+    }
+
+    void close(){
+        if(channel){
+            channel->close();
+            delete channel;
+        }
+        if(socket) socket->dispose();
+        if(sender) sender->dispose();
+        channel = NULL;
+        socket = NULL;
+        sender = NULL;
+    }
+};
+
+static void add_udp_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<UdpLoopback> loop = std::make_shared<UdpLoopback>();
+
+    BenchCase c;
+    c.name = "udp/loopback/recvmmsg";
+    c.unit = "dgram";
+    c.setup = [loop]() -> bool {
+        int port = 0;
+        if(!loop->open(port)) return false;
+        Result<IChannel*> channel = createUdpChannel("127.0.0.1", port);
+        if(!channel) return false;
+        loop->channel = *channel;
+        return loop->channel->open() && loop->channel->write("hello", 5) == 5 && loop->accept();
+    };
+    c.body = [loop](size_t iterations) -> size_t {
+        const size_t burstBytes = UDP_BURST * loop->capsule.size();
+        for(size_t it = 0; it < iterations; it++){
+            loop->sendBurst();
+            size_t got = 0;
+            while(got < burstBytes){
+                int ans = loop->channel->waitAndRead(&loop->buffer[0], loop->buffer.size(), burstBytes - got, 1000);
+                if(ans <= 0) return it * UDP_BURST;
+                got += ans;
+            }
+            g_sink = loop->buffer[got % loop->capsule.size()];
+        }
+        return iterations * UDP_BURST;
+    };
+    c.extra = [loop]() -> std::string {
+        UdpChannelStatistics stats;
+        static_cast<IUdpChannel*>(loop->channel)->getStatistics(stats);
+        char extra[192];
+        snprintf(extra, sizeof(extra), ", \"receive_calls_per_dgram\": %.3f, \"truncated\": %llu, \"dropped\": %llu",
+            stats.datagrams_received ? (double)stats.receive_calls / stats.datagrams_received : 0,
+            (unsigned long long)stats.datagrams_truncated, (unsigned long long)stats.datagrams_dropped);
+        return extra;
+    };
+    c.teardown = [loop]() { loop->close(); };
+    cases.push_back(c);
+
+    c.name = "udp/loopback/recvfrom";
+    c.setup = [loop]() -> bool {
+        int port = 0;
+        if(!loop->open(port)) return false;
+        rp::net::SocketAddress senderAddr("127.0.0.1", port);
+        loop->socket = rp::net::DGramSocket::CreateSocket();
+        loop->calls = loop->datagrams = 0;
+        return loop->socket && IS_OK(loop->socket->setPairAddress(&senderAddr))
+            && IS_OK(loop->socket->sendTo(senderAddr, "hello", 5)) && loop->accept();
+    };
+    c.body = [loop](size_t iterations) -> size_t {
+        for(size_t it = 0; it < iterations; it++){
+            loop->sendBurst();
+            for(size_t i = 0; i < UDP_BURST; i++){
+                size_t len = 0;
+                loop->calls += 2;
+                if(loop->socket->waitforData(1000) != RESULT_OK
+                    || IS_FAIL(loop->socket->recvFrom(&loop->buffer[0], loop->buffer.size(), len))) return it * UDP_BURST + i;
+                ++loop->datagrams;
+            }
+            g_sink = loop->buffer[0];
+        }
+        return iterations * UDP_BURST;
+    };
+    c.extra = [loop]() -> std::string {
+        char extra[64];
+        snprintf(extra, sizeof(extra), ", \"receive_calls_per_dgram\": %.3f", loop->datagrams ? (double)loop->calls / loop->datagrams : 0);
+        return extra;
+    };
+    cases.push_back(c);
+}
+
+/**
+ * Local TCP server replaying a byte stream in a loop to one client, like a network lidar streaming scans
+ */
+struct TcpReplayServer
+{
+    rp::net::StreamSocket*      listener;
+    const std::vector<sl_u8>*   stream;
+    std::atomic<bool>           stopping;
+    std::thread                 thread;
+
+    TcpReplayServer() : listener(NULL), stream(NULL), stopping(false) {}
+
+    bool start(const std::vector<sl_u8>& data, int& port){
+        stream = &data;
+        stopping = false;
+        listener = rp::net::StreamSocket::CreateSocket();
+        rp::net::SocketAddress local("127.0.0.1", 0);
+        if(!listener || IS_FAIL(listener->bind(local)) || IS_FAIL(listener->listen(1)) || IS_FAIL(listener->getLocalAddress(local))) return false;
+        port = local.getPort();
+        thread = std::thread([this]() { serve(); });
+        return true;
+    }
+
+    void serve(){
+        if(listener->waitforIncomingConnection(2000) != RESULT_OK) return;
+        rp::net::StreamSocket* client = listener->accept(NULL);
+        if(!client) return;
+        size_t pos = 0;
+        while(!stopping.load()){
+            size_t chunk = std::min<size_t>(TCP_REPLAY_CHUNK, stream->size() - pos);
+            if(IS_FAIL(client->send(&(*stream)[pos], chunk))) break;
+            pos = (pos + chunk) % stream->size();
+        }
+        client->dispose();
+    }
+
+    // the client has to be closed first, the server may be blocked sending to it
+    void stop(){
+        stopping = true;
+        if(thread.joinable()) thread.join();
+        if(listener) listener->dispose();
+        listener = NULL;
+    }
+};
+
+/**
+ * The TCP channel before the receive ring: readiness from select alone and one recv per read
+ */
+class LegacyTcpChannel : public IChannel
+{
+public:
+    LegacyTcpChannel(int port)
+        : _socket(rp::net::StreamSocket::CreateSocket())
+        , _address("127.0.0.1", port)
+        , calls(0)
+    {
+    }
+
+    virtual ~LegacyTcpChannel() { close(); }
+
+    virtual bool open() { return _socket && IS_OK(_socket->connect(_address)); }
+    virtual void close()
+    {
+        if(_socket) _socket->dispose();
+        _socket = NULL;
+    }
+    virtual void flush() {}
+    virtual void clearReadCache() {}
+    virtual int write(const void* data, size_t size) { return IS_OK(_socket->send(data, size)) ? (int)size : -1; }
+
+    virtual bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+    {
+        ++calls;
+        if(actualReady) *actualReady = size;
+        return _socket->waitforData(timeoutInMs) == RESULT_OK;
+    }
+
+    virtual int read(void* buffer, size_t size)
+    {
+        size_t len = 0;
+        ++calls;
+        _socket->recv(buffer, size, len);
+        return (int)len;
+    }
+
+private:
+    rp::net::StreamSocket* _socket;
+    rp::net::SocketAddress _address;
+
+public:
+    sl_u64 calls;
+};
+
+struct TcpReplayCase
+{
+    TcpReplayServer     server;
+    IChannel*           channel;
+    LegacyTcpChannel*   legacy;
+    LidarRxRing         ring;
+    bool                previousReady;
+    sl_u64              frames;
+    sl_lidar_response_capsule_measurement_nodes_t capsule;
+    sl_lidar_response_measurement_node_hq_t nodes[128];
+
+    TcpReplayCase() : channel(NULL), legacy(NULL), previousReady(false), frames(0) {}
+
+    void close(){
+        if(channel){
+            channel->close();
+            delete channel;
+        }
+        channel = NULL;
+        legacy = NULL;
+        server.stop();
+    }
+};
+
+static void add_tcp_cases(std::vector<BenchCase>& cases){
+    std::shared_ptr<std::vector<sl_u8> > express(new std::vector<sl_u8>(make_capsule_stream(400)));
+    std::shared_ptr<TcpReplayCase> replay = std::make_shared<TcpReplayCase>();
+    const size_t framesPerStream = express->size() / sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+
+    BenchCase c;
+    c.unit = "node";
+    c.name = "tcp/replay/ring";
+    c.setup = [express, replay]() -> bool {
+        int port = 0;
+        replay->frames = 0;
+        replay->previousReady = false;
+        if(!replay->server.start(*express, port)) return false;
+        Result<IChannel*> channel = createTcpChannel("127.0.0.1", port);
+        if(!channel) return false;
+        replay->channel = *channel;
+        return replay->channel->open();
+    };
+    c.body = [replay, framesPerStream](size_t iterations) -> size_t {
+        size_t frames = iterations * framesPerStream;
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            const sl_u8* frame;
+            size_t skipped;
+            int status;
+            while((status = replay->ring.nextFrame(LIDAR_FRAME_CAPSULE, frame, skipped)) == LidarRxRing::FRAME_NEED_MORE){
+                if(!replay->ring.fill(replay->channel, LidarRxRing::frameSize(LIDAR_FRAME_CAPSULE), 1000)) return total;
+            }
+            if(skipped || status == LidarRxRing::FRAME_CORRUPTED) replay->previousReady = false;
+            if(status == LidarRxRing::FRAME_CORRUPTED) continue;
+            const sl_lidar_response_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_capsule_measurement_nodes_t*>(frame);
+            if(capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) replay->previousReady = false;
+            if(replay->previousReady) total += decoder::capsuleToNormal(replay->capsule, *capsule, replay->nodes);
+            replay->capsule = *capsule;
+            replay->previousReady = true;
+            ++replay->frames;
+        }
+        g_sink = replay->nodes[0].dist_mm_q2;
+        return total;
+    };
+    c.extra = [replay]() -> std::string {
+        TcpChannelStatistics stats;
+        static_cast<ITcpChannel*>(replay->channel)->getStatistics(stats);
+        char extra[160];
+        snprintf(extra, sizeof(extra), ", \"syscalls_per_frame\": %.4f, \"bytes_per_receive\": %.0f",
+            replay->frames ? (double)(stats.receive_calls + stats.wait_calls) / replay->frames : 0,
+            stats.receive_calls ? (double)stats.bytes_received / stats.receive_calls : 0);
+        return extra;
+    };
+    c.teardown = [replay]() { replay->close(); };
+    cases.push_back(c);
+
+    c.name = "tcp/replay/legacy";
+    c.setup = [express, replay]() -> bool {
+        int port = 0;
+        replay->frames = 0;
+        replay->previousReady = false;
+        if(!replay->server.start(*express, port)) return false;
+        replay->legacy = new LegacyTcpChannel(port);
+        replay->channel = replay->legacy;
+        return replay->channel->open();
+    };
+    c.body = [replay, framesPerStream](size_t iterations) -> size_t {
+        sl_lidar_response_capsule_measurement_nodes_t capsule;
+        size_t frames = iterations * framesPerStream;
+        size_t total = 0;
+        for(size_t i = 0; i < frames; i++){
+            if(SL_IS_FAIL(legacy_wait_capsule(replay->channel, capsule, replay->previousReady, 1000))) continue;
+            if(replay->previousReady) total += decoder::capsuleToNormal(replay->capsule, capsule, replay->nodes);
+            replay->capsule = capsule;
+            replay->previousReady = true;
+            ++replay->frames;
+        }
+        g_sink = replay->nodes[0].dist_mm_q2;
+        return total;
+    };
+    c.extra = [replay]() -> std::string {
+        char extra[64];
+        snprintf(extra, sizeof(extra), ", \"syscalls_per_frame\": %.4f", replay->frames ? (double)replay->legacy->calls / replay->frames : 0);
+        return extra;
+    };
+    cases.push_back(c);
+}
+
+// wake latency from set() on one thread until wait() returns on the other, the cache thread to consumer hop
+static void run_event_latency(){
+    const char* name = "event/wake_latency";
+    if(!selected(name)) return;
+    if(g_options.list_only){
+        printf("%s\n", name);
+        return;
+    }
+
+    rp::hal::Event ping, pong;
+    std::atomic<sl_u64> sent(0);
+    std::vector<double> latency;
+    latency.reserve(EVENT_ROUND_TRIPS);
+    const int warmup = EVENT_ROUND_TRIPS / 10;
+    std::thread waiter([&]() {
+        for(int i = 0; i < warmup + EVENT_ROUND_TRIPS; i++){
+            ping.wait();
+            sl_u64 woke = getns();
+            if(i >= warmup) latency.push_back((double)(woke - sent.load()));
+            pong.set();
+        }
+    });
+    for(int i = 0; i < warmup + EVENT_ROUND_TRIPS; i++){
+        sent.store(getns());
+        ping.set();
+        pong.wait();
+    }
+    waiter.join();
+    std::sort(latency.begin(), latency.end());
+
+    BenchResult result;
+    result.name = name;
+    result.unit = "wake";
+    result.ns_per_item = latency[latency.size() / 2];
+    result.min_ns = latency.front();
+    result.max_ns = latency.back();
+    result.p99_ns = latency[latency.size() * 99 / 100];
+    result.mad_pct = 0;
+    result.items_per_s = 1e9 / result.ns_per_item;
+    result.reps = 1;
+    result.iterations = latency.size();
+    g_results.push_back(result);
+    printf("%-40s p50 %.0f ns  p99 %.0f ns  max %.0f ns over %u wakes\n", name,
+        result.ns_per_item, result.p99_ns, result.max_ns, (unsigned)latency.size());
+}
+
+//
+// Live cases
+//
+
+struct ProcessUsage
+{
+    sl_u64 ns;
+    double cpu_s;
+    sl_u64 read_syscalls;
+};
+
+static ProcessUsage sample_usage(){
+    ProcessUsage usage;
+    usage.ns = getns();
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    usage.cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    usage.read_syscalls = 0;
+    FILE* io = fopen("/proc/self/io", "r");
+    if(io){
+        char line[128];
+        unsigned long long value;
+        while(fgets(line, sizeof(line), io)){
+            if(sscanf(line, "syscr: %llu", &value) == 1) usage.read_syscalls = value;
+        }
+        fclose(io);
+    }
+    return usage;
+}
+
+// bucket i counts latencies below (64 << i) us, the percentile is reported as the bucket bound
+static double histogram_percentile_ns(const sl_u64* histogram, double fraction){
+    sl_u64 total = 0;
+    for(int i = 0; i < LIDAR_LATENCY_HISTOGRAM_BUCKETS; i++){
+        total += histogram[i];
+    }
+    if(!total) return 0;
+    sl_u64 seen = 0;
+    for(int i = 0; i < LIDAR_LATENCY_HISTOGRAM_BUCKETS; i++){
+        seen += histogram[i];
+        if(seen >= fraction * total) return (64 << i) * 1000.0;
+    }
+    return (64 << (LIDAR_LATENCY_HISTOGRAM_BUCKETS - 1)) * 1000.0;
+}
+
+struct LiveDevice
+{
+    IChannel*     channel;
+    ILidarDriver* driver;
+    int           id;
+};
+
+static bool connect_device(const char* path, int baud, const char* recordPath, LiveDevice& device){
+    device.channel = NULL;
+    device.driver = NULL;
+    device.id = -1;
+    Result<IChannel*> channel = createSerialPortChannel(path, baud);
+    if(!channel) return false;
+    device.channel = *channel;
+    if(recordPath){
+        Result<IChannel*> recorder = createRecordingChannel(device.channel, CHANNEL_TYPE_SERIALPORT, recordPath);
+        if(!recorder){
+            delete device.channel;
+            device.channel = NULL;
+            return false;
+        }
+        device.channel = *recorder;
+    }
+    device.driver = *createLidarDriver();
+    sl_lidar_response_device_info_t info;
+    if(!device.driver || SL_IS_FAIL(device.driver->connect(device.channel)) || SL_IS_FAIL(device.driver->getDeviceInfo(info))){
+        fprintf(stderr, "no lidar answering on %s at %d baud\n", path, baud);
+        return false;
+    }
+    return true;
+}
+
+// revolutions decoded by all the drivers, a consumer waiting on the fleet may see fewer of them
+static sl_u64 count_revolutions(const std::vector<LiveDevice>& devices){
+    sl_u64 revolutions = 0;
+    for(size_t i = 0; i < devices.size(); i++){
+        LidarStatistics stats;
+        devices[i].driver->getStatistics(stats);
+        revolutions += stats.revolutions;
+    }
+    return revolutions;
+}
+
+static void disconnect_device(LiveDevice& device){
+    if(device.driver){
+        device.driver->stop();
+        device.driver->disconnect();
+    }
+    delete device.driver;
+    delete device.channel;
+    device.driver = NULL;
+    device.channel = NULL;
+}
+
+/**
+ * Counts the nodes of every revolution on the decoding thread, a consumer grabbing scans only sees the latest one
+ */
+class RevolutionCounter : public ILidarSectorListener
+{
+public:
+    RevolutionCounter()
+        : nodes(0)
+        , last_ns(0)
+    {
+    }
+
+    virtual void onScanSector(const LidarScanSector& sector)
+    {
+        nodes.fetch_add(sector.count, std::memory_order_relaxed);
+        last_ns.store(getns(), std::memory_order_relaxed);
+    }
+
+    std::atomic<sl_u64> nodes;
+    std::atomic<sl_u64> last_ns;
+};
+
+// decode the session of the first device again, the driver reads the recording as fast as it can
+// returns the nodes decoded, the time from the start of the scan to the last revolution and the driver counters
+static sl_u64 replay_once(const char* recordPath, sl_u64& elapsedNs, LidarStatistics& stats){
+    Result<IReplayChannel*> replay = createReplayChannel(recordPath, false);
+    if(!replay){
+        fprintf(stderr, "cannot replay %s\n", recordPath);
+        return 0;
+    }
+    ILidarDriver* driver = *createLidarDriver();
+    RevolutionCounter counter;
+    sl_lidar_response_device_info_t info;
+    if(SL_IS_FAIL(driver->connect(*replay)) || SL_IS_FAIL(driver->getDeviceInfo(info))
+        || SL_IS_FAIL(driver->setScanSectorListener(&counter, 360)) || SL_IS_FAIL(driver->startScan(false, true))){
+        fprintf(stderr, "the recording does not replay\n");
+        delete driver;
+        delete *replay;
+        return 0;
+    }
+
+    // done once the whole recording is delivered and no revolution came for a while
+    sl_u64 start = getns();
+    LidarScanLease lease;
+    for(;;){
+        sl_result ans = driver->grabScanLease(lease, 20);
+        if(SL_IS_FAIL(ans) && (*replay)->isFinished()) break;
+    }
+    lease.release();
+    driver->getStatistics(stats);
+    driver->stop();
+    driver->disconnect();
+    delete driver;
+    delete *replay;
+    elapsedNs = counter.last_ns.load() - start;
+    return counter.nodes.load();
+}
+
+static void run_replay(const char* recordPath){
+    std::string name = "replay/driver";
+    std::vector<double> perNode;
+    sl_u64 histogram[LIDAR_LATENCY_HISTOGRAM_BUCKETS] = { 0 };
+    sl_u64 revolutions = 0;
+    for(int r = 0; r < g_options.reps; r++){
+        sl_u64 elapsed;
+        LidarStatistics stats;
+        sl_u64 nodes = replay_once(recordPath, elapsed, stats);
+        if(!nodes) return;
+        perNode.push_back((double)elapsed / nodes);
+        for(int i = 0; i < LIDAR_LATENCY_HISTOGRAM_BUCKETS; i++){
+            histogram[i] += stats.publish_latency_histogram[i];
+        }
+        revolutions = stats.revolutions;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.unit = "node";
+    summarize(perNode, result);
+    result.iterations = 1;
+    double p50 = histogram_percentile_ns(histogram, 0.5);
+    double p99 = histogram_percentile_ns(histogram, 0.99);
+    char extra[256];
+    snprintf(extra, sizeof(extra), ", \"publish_p50_ns\": %.0f, \"publish_p99_ns\": %.0f, \"revolutions\": %llu",
+        p50, p99, (unsigned long long)revolutions);
+    result.extra = extra;
+    g_results.push_back(result);
+    printf("%-40s %10.3f ns/node  %14.0f node/s   min %.3f max %.3f mad %.1f%%, %llu revolutions, publish p50 < %.0f us p99 < %.0f us\n",
+        name.c_str(), result.ns_per_item, result.items_per_s, result.min_ns, result.max_ns, result.mad_pct,
+        (unsigned long long)revolutions, p50 / 1000, p99 / 1000);
+}
+
+// deviceCount devices on one fleet reactor, CPU and read syscalls of the whole process per decoded node
+// With recordPath the session of the first device is recorded for the replay case instead, and not reported.
+static void run_live(size_t deviceCount, int baud, const char* recordPath){
+    char name[64];
+    snprintf(name, sizeof(name), "live/fleet/%u/%d", (unsigned)deviceCount, baud);
+    bool report = !recordPath;
+    if(report && !selected(name)) return;
+    if(report && g_options.list_only){
+        printf("%s\n", name);
+        return;
+    }
+
+    Result<ILidarFleet*> fleet = createLidarFleet();
+    if(!fleet){
+        printf("%-40s skipped, no fleet support\n", name);
+        return;
+    }
+    std::vector<LiveDevice> devices(deviceCount);
+    bool ready = true;
+    for(size_t i = 0; i < deviceCount && ready; i++){
+        ready = connect_device(g_options.lidars[i], baud, i == 0 ? recordPath : NULL, devices[i])
+            && SL_IS_OK((*fleet)->addDevice(devices[i].driver, devices[i].id))
+            && SL_IS_OK(devices[i].driver->startScan(false, true));
+    }
+
+    sl_u64 nodes = 0;
+    sl_u64 revolutions = 0;
+    ProcessUsage before, after;
+    if(ready && SL_IS_OK((*fleet)->start())){
+        LidarFleetScan scan;
+        sl_u64 settle = getns() + LIVE_SETTLE_MS * 1000000ULL;
+        while(getns() < settle){
+            (*fleet)->waitAnyScan(scan, 100);
+        }
+        before = sample_usage();
+        revolutions = count_revolutions(devices);
+        sl_u64 end = before.ns + (sl_u64)(g_options.live_seconds * 1e9);
+        while(getns() < end){
+            if(SL_IS_OK((*fleet)->waitAnyScan(scan, 100))){
+                nodes += scan.lease.count();
+            }
+        }
+        after = sample_usage();
+        revolutions = count_revolutions(devices) - revolutions;
+        scan.lease.release();
+        (*fleet)->stop();
+    }
+    for(size_t i = 0; i < deviceCount; i++){
+        if(devices[i].id >= 0){
+            devices[i].driver->stop();
+            (*fleet)->removeDevice(devices[i].id);
+        }
+        disconnect_device(devices[i]);
+    }
+    delete *fleet;
+
+    if(!nodes){
+        printf("%-40s skipped, no scan received\n", name);
+        return;
+    }
+    if(!report) return;
+    double seconds = (after.ns - before.ns) / 1e9;
+    double cpu = after.cpu_s - before.cpu_s;
+    BenchResult result;
+    result.name = name;
+    result.unit = "node";
+    result.ns_per_item = cpu * 1e9 / nodes;
+    result.min_ns = result.max_ns = result.ns_per_item;
+    result.mad_pct = 0;
+    result.p99_ns = 0;
+    result.items_per_s = nodes / seconds;
+    result.reps = 1;
+    result.iterations = (size_t)revolutions;
+    char extra[256];
+    snprintf(extra, sizeof(extra), ", \"devices\": %u, \"baud\": %d, \"cpu_pct\": %.2f, \"read_syscalls_per_s\": %.0f, \"revolutions_per_s\": %.2f",
+        (unsigned)deviceCount, baud, cpu * 100 / seconds, (after.read_syscalls - before.read_syscalls) / seconds, revolutions / seconds);
+    result.extra = extra;
+    g_results.push_back(result);
+    printf("%-40s %10.1f cpu ns/node %10.0f node/s   cpu %.2f%%  %.0f read syscalls/s  %.2f rev/s\n", name,
+        result.ns_per_item, result.items_per_s, cpu * 100 / seconds, (after.read_syscalls - before.read_syscalls) / seconds, revolutions / seconds);
+}
+
+static void run_live_cases(){
+    if(g_options.lidars.empty()) return;
+
+    for(size_t b = 0; b < g_options.bauds.size(); b++){
+        for(size_t n = 1; n <= g_options.lidars.size(); n++){
+            run_live(n, g_options.bauds[b], NULL);
+        }
+    }
+
+    if(!selected("replay/driver")) return;
+    if(g_options.list_only){
+        printf("replay/driver\n");
+        return;
+    }
+    // a session of its own, the recording thread would count in the live figures
+    char recordPath[] = "/tmp/lidar_bench_XXXXXX";
+    int fd = mkstemp(recordPath);
+    if(fd < 0) return;
+    close(fd);
+    run_live(1, g_options.bauds[0], recordPath);
+    run_replay(recordPath);
+    unlink(recordPath);
+}
+
+//
+// Report
+//
+
+static std::string json_escape(const std::string& text){
+    std::string out;
+    for(size_t i = 0; i < text.size(); i++){
+        char c = text[i];
+        if(c == '"' || c == '\\'){
+            out += '\\';
+            out += c;
+        } else if((unsigned char)c >= 0x20){
+            out += c;
+        }
+    }
+    return out;
+}
+
+static std::string read_cpu_model(){
+    std::string model;
+    FILE* file = fopen("/proc/device-tree/model", "r");
+    if(file){
+        char buffer[128] = { 0 };
+        if(fgets(buffer, sizeof(buffer), file)) model = buffer;
+        fclose(file);
+        if(!model.empty()) return model;
+    }
+    file = fopen("/proc/cpuinfo", "r");
+    if(file){
+        char line[256];
+        while(fgets(line, sizeof(line), file)){
+            if(strncmp(line, "model name", 10) == 0 || strncmp(line, "Hardware", 8) == 0){
+                const char* value = strchr(line, ':');
+                if(value){
+                    model = value + 2;
+                    model.erase(model.find_last_not_of("\r\n") + 1);
+                }
+                break;
+            }
+        }
+        fclose(file);
+    }
+    return model;
+}
+
+static bool write_json(const char* path){
+    FILE* file = fopen(path, "w");
+    if(!file){
+        fprintf(stderr, "cannot write %s\n", path);
+        return false;
+    }
+    struct utsname host;
+    uname(&host);
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"suite\": \"lidar_bench\",\n");
+    fprintf(file, "  \"format\": 1,\n");
+    fprintf(file, "  \"tag\": \"%s\",\n", json_escape(g_options.tag ? g_options.tag : "").c_str());
+    fprintf(file, "  \"date\": \"%s\",\n", date);
+    fprintf(file, "  \"host\": {\"name\": \"%s\", \"machine\": \"%s\", \"kernel\": \"%s\", \"cpu\": \"%s\", \"cpus\": %ld, \"compiler\": \"%s\"},\n",
+        json_escape(host.nodename).c_str(), json_escape(host.machine).c_str(), json_escape(host.release).c_str(),
+        json_escape(read_cpu_model()).c_str(), sysconf(_SC_NPROCESSORS_ONLN), json_escape(__VERSION__).c_str());
+    fprintf(file, "  \"paths\": {\"decoder\": \"%s\", \"crc32\": \"%s\"},\n",
+        decoder::pathName(decoder::activePath()), crc32::pathName(crc32::activePath()));
+    fprintf(file, "  \"method\": {\"reps\": %d, \"min_rep_ms\": %d, \"warmup_ms\": %d, \"statistic\": \"median\"},\n",
+        g_options.reps, g_options.min_rep_ms, g_options.warmup_ms);
+    fprintf(file, "  \"results\": [\n");
+    // one result per line, --baseline relies on it
+    for(size_t i = 0; i < g_results.size(); i++){
+        const BenchResult& r = g_results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"unit\": \"%s\", \"ns_per_item\": %.4f, \"items_per_s\": %.1f, \"min_ns\": %.4f, \"max_ns\": %.4f, \"mad_pct\": %.2f, \"p99_ns\": %.4f, \"reps\": %d, \"iterations\": %llu%s}%s\n",
+            json_escape(r.name).c_str(), r.unit.c_str(), r.ns_per_item, r.items_per_s, r.min_ns, r.max_ns, r.mad_pct, r.p99_ns,
+            r.reps, (unsigned long long)r.iterations, r.extra.c_str(), i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+static void compare_baseline(const char* path){
+    FILE* file = fopen(path, "r");
+    if(!file){
+        fprintf(stderr, "cannot read %s\n", path);
+        return;
+    }
+    printf("\n%-40s %14s %14s %9s\n", "against baseline", "baseline ns", "now ns", "speedup");
+    char line[1024];
+    while(fgets(line, sizeof(line), file)){
+        char name[128];
+        double ns;
+        const char* nameField = strstr(line, "\"name\": \"");
+        const char* nsField = strstr(line, "\"ns_per_item\": ");
+        if(!nameField || !nsField) continue;
+        if(sscanf(nameField + 9, "%127[^\"]", name) != 1 || sscanf(nsField + 15, "%lf", &ns) != 1) continue;
+        for(size_t i = 0; i < g_results.size(); i++){
+            if(g_results[i].name == name && g_results[i].ns_per_item > 0){
+                printf("%-40s %14.3f %14.3f %8.2fx\n", name, ns, g_results[i].ns_per_item, ns / g_results[i].ns_per_item);
+            }
+        }
+    }
+    fclose(file);
+}
+
+static void print_usage(const char* name){
+    printf("usage: %s [options]\n"
+        "  --filter TEXT        only run the cases whose name contains TEXT\n"
+        "  --list               list the cases and exit\n"
+        "  --reps N             measured repetitions per case (default %d)\n"
+        "  --min-ms N           minimum duration of one repetition (default %d)\n"
+        "  --warmup-ms N        minimum warm-up per case (default %d)\n"
+        "  --json FILE          write the results as JSON\n"
+        "  --tag TEXT           label stored in the JSON, e.g. the commit or the board\n"
+        "  --baseline FILE      compare with the JSON of an earlier run\n"
+        "  --lidar PATH         lidar for the live cases, repeat it for several devices\n"
+        "  --baud N[,N...]      baud rates of the live cases (default 115200)\n"
+        "  --seconds F          duration of each live case (default 5)\n", name, DEFAULT_REPS, DEFAULT_MIN_REP_MS, DEFAULT_WARMUP_MS);
+}
+
+int main(int argc, char** argv){
+    g_options.reps = DEFAULT_REPS;
+    g_options.min_rep_ms = DEFAULT_MIN_REP_MS;
+    g_options.warmup_ms = DEFAULT_WARMUP_MS;
+    g_options.filter = NULL;
+    g_options.json_path = NULL;
+    g_options.baseline_path = NULL;
+    g_options.tag = NULL;
+    g_options.list_only = false;
+    g_options.live_seconds = 5.0f;
+
+    for(int i = 1; i < argc; i++){
+        bool has_value = i + 1 < argc;
+        if(strcmp(argv[i], "--filter") == 0 && has_value){
+            g_options.filter = argv[++i];
+        } else if(strcmp(argv[i], "--list") == 0){
+            g_options.list_only = true;
+        } else if(strcmp(argv[i], "--reps") == 0 && has_value){
+            g_options.reps = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--min-ms") == 0 && has_value){
+            g_options.min_rep_ms = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--warmup-ms") == 0 && has_value){
+            g_options.warmup_ms = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--json") == 0 && has_value){
+            g_options.json_path = argv[++i];
+        } else if(strcmp(argv[i], "--tag") == 0 && has_value){
+            g_options.tag = argv[++i];
+        } else if(strcmp(argv[i], "--baseline") == 0 && has_value){
+            g_options.baseline_path = argv[++i];
+        } else if(strcmp(argv[i], "--lidar") == 0 && has_value){
+            g_options.lidars.push_back(argv[++i]);
+        } else if(strcmp(argv[i], "--baud") == 0 && has_value){
+            for(char* rate = strtok(argv[++i], ","); rate; rate = strtok(NULL, ",")){
+                g_options.bauds.push_back(atoi(rate));
+            }
+        } else if(strcmp(argv[i], "--seconds") == 0 && has_value){
+            g_options.live_seconds = (float)atof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if(g_options.reps < 1) g_options.reps = 1;
+    if(g_options.bauds.empty()) g_options.bauds.push_back(115200);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if(!g_options.list_only){
+        printf("decoder path %s, crc32 path %s, %d reps of at least %d ms per case\n",
+            decoder::pathName(decoder::activePath()), crc32::pathName(crc32::activePath()), g_options.reps, g_options.min_rep_ms);
+    }
+
+    std::vector<BenchCase> cases;
+    add_varbitscale_cases(cases);
+    add_decoder_cases(cases);
+    add_crc_cases(cases);
+    add_parse_cases(cases);
+    add_ascend_cases(cases);
+    add_soa_cases(cases);
+    add_event_cases(cases);
+    add_udp_cases(cases);
+    add_tcp_cases(cases);
+    for(size_t i = 0; i < cases.size(); i++){
+        run_case(cases[i]);
+    }
+    run_event_latency();
+    run_live_cases();
+
+    if(g_options.list_only) return 0;
+    if(g_options.baseline_path) compare_baseline(g_options.baseline_path);
+    if(g_options.json_path && !write_json(g_options.json_path)) return 1;
+    return 0;
+}
@@ -36,8 +36,22 @@
 #include "sl_lidar_cmd.h"
 
 namespace sl {namespace crc32 {
+    enum Crc32Path
+    {
+        CRC32_PATH_BYTEWISE = 0,
+        CRC32_PATH_SLICING_BY_8,
+        CRC32_PATH_ARMV8,
+        CRC32_PATH_COUNT,
+    };
+
+    // the fastest available path is used unless selectPath() overrides it (e.g. for benchmarking)
+    Crc32Path activePath();
+    bool selectPath(Crc32Path path);
+    bool isPathAvailable(Crc32Path path);
+    const char* pathName(Crc32Path path);
+
     sl_u32 bitrev(sl_u32 input, sl_u16 bw);//reflect
-    void init(sl_u32 poly); // table init
+    void init(sl_u32 poly); // tables are built at compile time, kept for compatibility
     sl_u32 cal(sl_u32 crc, void* input, sl_u16 len);
     sl_result getResult(sl_u8 *ptr, sl_u32 len);
 }}
@@ -34,6 +34,10 @@
 #pragma once
 
 #include "sl_lidar_driver.h"
+#include "sl_lidar_fleet.h"
+#include "sl_lidar_calibration.h"
+#include "sl_lidar_supervisor.h"
+#include "sl_lidar_recording.h"
 
 #define SL_LIDAR_SDK_VERSION_MAJOR  2
 #define SL_LIDAR_SDK_VERSION_MINOR  0
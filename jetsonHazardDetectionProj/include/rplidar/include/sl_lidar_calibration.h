@@ -0,0 +1,113 @@
+/*
+* Slamtec LIDAR SDK
+*
+* sl_lidar_calibration.h
+*
+* Copyright (c) 2020 Shanghai Slamtec Co., Ltd.
+*/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * What the scan mode picked by calibrateLidar has to achieve
+    */
+    struct LidarCalibrationTarget
+    {
+        LidarCalibrationTarget()
+            : min_points_per_degree(1.f)
+            , max_revolution_ms(100.f)
+            , measure_ms(2000)
+        {
+        }
+
+        // Angular density, nodes per revolution divided by 360
+        float   min_points_per_degree;
+
+        // Time taken by one revolution (in milliseconds)
+        float   max_revolution_ms;
+
+        // Time each scan mode is measured for (in milliseconds)
+        sl_u32  measure_ms;
+
+        // Baudrates to try, the highest one both the lidar and the UART sustain is kept.
+        // Rates the serial driver has no constant for are fine on Linux. Leave it empty to keep the current rate.
+        std::vector<sl_u32> baud_rates;
+    };
+
+    /**
+    * Figures measured for one scan mode
+    */
+    struct LidarScanModeReport
+    {
+        LidarScanMode   mode;
+
+        // Result of starting and grabbing the mode, the figures below are 0 if it failed
+        sl_result       result;
+
+        // Points delivered per second, below nominal_points_per_second when the link cannot carry the mode
+        float           points_per_second;
+
+        // Points per second announced by the lidar (1 / us_per_sample)
+        float           nominal_points_per_second;
+
+        float           points_per_degree;
+        float           revolution_ms;
+        bool            meets_target;
+    };
+
+    struct LidarCalibrationResult
+    {
+        // Baudrate the link has been left at
+        sl_u32          baud_rate;
+
+        // The scan mode to use
+        sl_u16          selected_mode;
+
+        // false if no mode meets the target, selected_mode is the one coming closest then
+        bool            target_met;
+
+        std::vector<LidarScanModeReport> modes;
+    };
+
+    /// Probe the link and the scan modes of a connected serial lidar and select the mode meeting the target
+    ///
+    /// 1) The baudrates of the target are tried from the highest one. A rate is kept once the lidar confirmed it
+    ///    (negotiateSerialBaudRate) and answers getDeviceInfo, otherwise the link goes back to the current rate.
+    /// 2) Every mode of getAllSupportedScanModes is started for measure_ms and the delivered points are counted.
+    /// 3) The mode meeting both targets with the most points per second is selected.
+    ///
+    /// The lidar is stopped afterwards, start the selected mode with startScanExpress(false, result.selected_mode).
+    /// The interface will return SL_RESULT_OPERATION_NOT_SUPPORT if the lidar cannot list its scan modes.
+    sl_result calibrateLidar(ILidarDriver* driver, ISerialPortChannel* channel, const LidarCalibrationTarget& target, LidarCalibrationResult& result);
+}
@@ -175,11 +175,36 @@ namespace sl {
         */
         virtual int read(void* buffer, size_t size) = 0;
 
+        /**
+        * Wait until at least minSize bytes are ready and read as many as fit in the buffer
+        * Channels which can do it in fewer system calls than waitForData followed by read override it.
+        * \param buffer The buffer to receive data
+        * \param size The size of the read buffer
+        * \param minSize Bytes to wait for
+        * \param timeoutInMs Wait timeout (in milliseconds, -1 for forever)
+        * \return Bytes read, including the ones received before a timeout (negative for read failure)
+        */
+        virtual int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs = -1)
+        {
+            size_t ready = 0;
+            if (!waitForData(minSize, timeoutInMs, &ready)) return 0;
+            if (ready < minSize) ready = minSize;
+            if (ready > size) ready = size;
+            return read(buffer, ready);
+        }
+
         /**
         * Clear read cache
         */
         virtual void clearReadCache() = 0;
 
+        /**
+        * Handle to poll for incoming data (a file descriptor on POSIX systems)
+        * Reads on a pollable channel return the bytes available right away instead of waiting for the full size.
+        * \return -1 if the channel cannot be polled
+        */
+        virtual int getPollHandle() { return -1; }
+
     private:
 
     };
@@ -194,6 +219,102 @@ namespace sl {
 
     public:
         virtual void setDTR(bool dtr) = 0;
+
+        /**
+        * Reopen the port at another baudrate
+        * The lidar has to be switched to the same rate, see ILidarDriver::negotiateSerialBaudRate.
+        * \return false if the port cannot run at this rate, the port is left closed then
+        */
+        virtual bool setBaudRate(int baudrate) = 0;
+
+        /**
+        * Baudrate the port runs at, the UART may only approximate the requested one
+        */
+        virtual int getBaudRate() = 0;
+    };
+
+    /**
+    * Counters of the datagrams received by a UDP channel, see IUdpChannel::getStatistics
+    */
+    struct UdpChannelStatistics
+    {
+        // Datagrams and payload bytes taken from the socket
+        sl_u64  datagrams_received;
+        sl_u64  bytes_received;
+
+        // Datagrams longer than a receive slot, their tail is lost
+        sl_u64  datagrams_truncated;
+
+        // Datagrams the system dropped because the socket receive buffer was full (0 where the system cannot tell)
+        sl_u64  datagrams_dropped;
+
+        // Receive system calls made, each one takes every datagram queued up to the free slots
+        sl_u64  receive_calls;
+    };
+
+    /**
+    * Abstract interface of UDP channel
+    *
+    * The datagrams are received in batches into a preallocated ring of slots and read back as one
+    * byte stream, waitForData reports the bytes actually buffered.
+    */
+    class IUdpChannel : public IChannel
+    {
+    public:
+        virtual ~IUdpChannel() {}
+
+    public:
+        virtual void getStatistics(UdpChannelStatistics& stats) = 0;
+    };
+
+    /**
+    * Counters of the data received by a TCP channel, see ITcpChannel::getStatistics
+    */
+    struct TcpChannelStatistics
+    {
+        // Bytes taken from the socket
+        sl_u64  bytes_received;
+
+        // Receive system calls made, each one takes everything queued up to the space it is given
+        sl_u64  receive_calls;
+
+        // Waits for the socket to become readable
+        sl_u64  wait_calls;
+
+        // Bytes read through the receive ring instead of straight into the reader's buffer
+        sl_u64  bytes_buffered;
+    };
+
+    /**
+    * Abstract interface of TCP channel
+    *
+    * Reads go straight from the socket into the reader's buffer, as much as is queued in one receive.
+    * waitForData takes the queued bytes into a receive ring to report exactly how many are ready,
+    * the next reads are served from the ring first.
+    */
+    class ITcpChannel : public IChannel
+    {
+    public:
+        virtual ~ITcpChannel() {}
+
+    public:
+        /**
+        * Send small writes at once instead of coalescing them (Nagle's algorithm), enabled by default
+        */
+        virtual bool setNoDelay(bool enable) = 0;
+
+        /**
+        * Size of the system receive buffer (SO_RCVBUF), 0 keeps the system default
+        */
+        virtual bool setReceiveBufferSize(size_t bytes) = 0;
+
+        /**
+        * Busy-poll the network device for up to this time in waits and receives instead of sleeping
+        * Trades CPU time for latency, 0 disables it. Only supported on Linux (SO_BUSY_POLL).
+        */
+        virtual bool setBusyPoll(sl_u32 microseconds) = 0;
+
+        virtual void getStatistics(TcpChannelStatistics& stats) = 0;
     };
 
     /**
@@ -207,14 +328,14 @@ namespace sl {
     Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate);
 
     /**
-    * Create a TCP channel
+    * Create a TCP channel, the channel is an ITcpChannel
     * \param ip IP address of the device
     * \param port TCP port
     */
     Result<IChannel*> createTcpChannel(const std::string& ip, int port);
 
     /**
-    * Create a UDP channel
+    * Create a UDP channel, the channel is an IUdpChannel
     * \param ip IP address of the device
     * \param port UDP port
     */
@@ -233,6 +354,44 @@ namespace sl {
         CHANNEL_TYPE_UDP = 0x2,
     };
 
+    /**
+    * Processing applied by the driver to every scan before publishing it, see ILidarDriver::setScanPublishOptions
+    */
+    enum ScanPublishFlag {
+        // nodes ordered by ascending angle, the same way ascendScanData does
+        SCAN_PUBLISH_SORTED = 0x1,
+        // structure-of-arrays copy of the nodes, see LidarScanBuffer::angle_q14
+        SCAN_PUBLISH_SOA = 0x2,
+        // Cartesian coordinates of the nodes, implies SCAN_PUBLISH_SOA
+        SCAN_PUBLISH_CARTESIAN = 0x4,
+    };
+
+    /**
+    * Scheduling of the thread decoding the scan data, see ILidarDriver::setScanThreadPolicy
+    */
+    enum LidarThreadPriority {
+        // inherit the scheduling of the thread calling startScan
+        LIDAR_THREAD_PRIORITY_DEFAULT = 0,
+        // SCHED_RR on Linux, below the realtime level
+        LIDAR_THREAD_PRIORITY_HIGH,
+        // SCHED_FIFO on Linux, just below the threaded interrupt handlers
+        LIDAR_THREAD_PRIORITY_REALTIME,
+    };
+
+    struct LidarThreadPolicy
+    {
+        LidarThreadPolicy()
+            : priority(LIDAR_THREAD_PRIORITY_DEFAULT)
+            , cpu_mask(0)
+        {
+        }
+
+        LidarThreadPriority priority;
+
+        // Bit n allows the thread on CPU n, 0 leaves the affinity alone
+        sl_u64              cpu_mask;
+    };
+
         /**
     * Lidar motor info
     */
@@ -250,6 +409,324 @@ namespace sl {
         sl_u16 min_speed;
     };
 
+    enum {
+        LIDAR_MAX_SCAN_VIEWS = 4,
+        LIDAR_SCAN_VIEW_MAX_WINDOWS = 4,
+    };
+
+    /**
+    * Angular range [start_degree, end_degree), it wraps over 0 degree when start_degree > end_degree
+    */
+    struct LidarAngleWindow
+    {
+        float   start_degree;
+        float   end_degree;
+    };
+
+    /**
+    * Subset of every revolution a consumer is interested in, see ILidarDriver::addScanView
+    * Nodes without a distance are never part of a view.
+    */
+    struct LidarScanViewDesc
+    {
+        // Nodes must lie in one of the windows, no window keeps the whole revolution
+        LidarAngleWindow windows[LIDAR_SCAN_VIEW_MAX_WINDOWS];
+        size_t  window_count;
+
+        // Lowest quality kept
+        sl_u8   min_quality;
+
+        // Distance range kept (in millimeters), a max_distance_mm of 0 sets no upper bound
+        float   min_distance_mm;
+        float   max_distance_mm;
+
+        // Size of the decimation bins (in degrees, from 0.1 to 360), only the nearest node of each bin is kept.
+        // 0 keeps every node.
+        float   bin_degree;
+    };
+
+    /**
+    * Nodes of one revolution selected by a view
+    */
+    struct LidarScanView
+    {
+        // In the order of the scan, or by ascending bin when the view decimates
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // Sampling time of each node, parallel to nodes (in nanoseconds, host monotonic clock)
+        const sl_u64* timestamps_ns;
+
+        size_t  count;
+    };
+
+    /**
+    * One complete 0-360 degree scan kept by the driver
+    */
+    struct LidarScanBuffer
+    {
+        // Nodes of the scan, nodes[0] is the first sample of the scan (start_bit == 1) unless the scan is sorted
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // Number of nodes in the scan
+        size_t  count;
+
+        // Increases by one for every scan published by the driver
+        sl_u64  sequence;
+
+        // Time when the scan has been completed (in microseconds, monotonic clock)
+        sl_u64  timestamp_us;
+
+        // Sampling time of each node, parallel to nodes (in nanoseconds, host monotonic clock)
+        // Derived from the arrival time of the data and the sample duration of the scan mode,
+        // or from the device clock when the lidar reports it (HQ capsules).
+        const sl_u64* timestamps_ns;
+
+        // Sampling time of the first and the last node of the scan
+        sl_u64  start_ns;
+        sl_u64  end_ns;
+
+        // ScanPublishFlag applied to the scan. With SCAN_PUBLISH_SORTED the timestamps follow their nodes.
+        sl_u32  publish_flags;
+
+        // Fields of the nodes as parallel arrays (SCAN_PUBLISH_SOA), NULL otherwise
+        // Each array starts on a 64 byte boundary, so loops over them can be vectorized.
+        const sl_u16* angle_q14;    // 16384 per 90 degrees
+        const sl_u32* dist_q2;      // millimeters * 4, 0 for an invalid node
+        const sl_u8*  quality;
+
+        // Coordinates of the nodes in millimeters (SCAN_PUBLISH_CARTESIAN), NULL otherwise
+        // x points to 0 degree and y to 90 degree, an invalid node lies at (0, 0).
+        const float*  x;
+        const float*  y;
+
+        // Result of each view registered with addScanView, indexed by view id
+        const LidarScanView* views;
+        size_t  view_count;
+    };
+
+    /**
+    * State of the buffer behind getScanDataWithIntervalHq
+    */
+    struct LidarIntervalBufferStats
+    {
+        // Number of nodes the buffer can hold
+        size_t  capacity;
+
+        // Nodes waiting to be retrieved
+        size_t  buffered;
+
+        // Nodes dropped because the buffer was full
+        sl_u64  dropped_nodes;
+
+        // Number of times the buffer ran full, consecutive drops count once
+        sl_u64  overflow_count;
+    };
+
+    enum {
+        LIDAR_LATENCY_HISTOGRAM_BUCKETS = 12,
+    };
+
+    /**
+    * Counters of the data received from the lidar, see ILidarDriver::getStatistics
+    *
+    * The counters only ever grow. Rates (bytes per second, frames per second...) are obtained
+    * by taking two snapshots and dividing the difference by the difference of timestamp_ns.
+    */
+    struct LidarStatistics
+    {
+        // Time the snapshot has been taken (in nanoseconds, host monotonic clock)
+        sl_u64  timestamp_ns;
+
+        // Bytes read from the channel
+        sl_u64  bytes_received;
+
+        // Frames (response headers, measurement nodes, capsules) which passed their integrity check
+        sl_u64  frames_decoded;
+
+        // Measurement nodes and capsules rejected by their check bit or checksum
+        sl_u64  checksum_errors;
+
+        // HQ capsules rejected by their CRC32
+        sl_u64  crc_errors;
+
+        // Times the frame boundaries were lost, and bytes discarded to find them again
+        sl_u64  sync_losses;
+        sl_u64  resync_bytes;
+
+        // Complete revolutions, the dropped ones could not be published because every scan buffer was leased
+        sl_u64  revolutions;
+        sl_u64  revolutions_dropped;
+
+        // Nodes of the last complete revolution
+        size_t  points_per_revolution;
+
+        // Rotation frequency measured between the starts of the last two revolutions (in Hz), 0 until then
+        float   rotation_frequency_hz;
+
+        // Time from the arrival of the data completing a revolution until the scan is published.
+        // Bucket i counts the latencies below (64 << i) microseconds not counted by bucket i - 1,
+        // the last bucket counts everything above.
+        sl_u64  publish_latency_histogram[LIDAR_LATENCY_HISTOGRAM_BUCKETS];
+    };
+
+    /**
+    * Part of a revolution, delivered by the driver as soon as the lidar has swept over it
+    */
+    struct LidarScanSector
+    {
+        // Nodes of the sector, in the order they have been measured. They point into the scan being
+        // written by the driver and are only valid during the callback.
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // Sampling time of each node, parallel to nodes (in nanoseconds, host monotonic clock)
+        const sl_u64* timestamps_ns;
+
+        // Number of nodes in the sector
+        size_t  count;
+
+        // Sequence the scan holding the sector will be published with, see LidarScanBuffer::sequence
+        sl_u64  scan_sequence;
+
+        // The sector covers [index * size, (index + 1) * size) degrees, the last sector of a revolution may be smaller
+        int     index;
+        float   start_angle;
+        float   end_angle;
+
+        // Sampling time of the first and the last node of the sector
+        sl_u64  start_ns;
+        sl_u64  end_ns;
+    };
+
+    /**
+    * Receiver of the sectors of every revolution, see ILidarDriver::setScanSectorListener
+    */
+    class ILidarSectorListener
+    {
+    public:
+        virtual ~ILidarSectorListener() {}
+
+    public:
+        /// Called from the thread decoding the scan data once a sector is complete, it must return quickly
+        virtual void onScanSector(const LidarScanSector& sector) = 0;
+    };
+
+    /**
+    * Owner of the scan buffers handed out through LidarScanLease
+    */
+    class IScanBufferOwner
+    {
+    public:
+        virtual ~IScanBufferOwner() {}
+
+    public:
+        virtual void retainScanBuffer(int slot) = 0;
+        virtual void releaseScanBuffer(int slot) = 0;
+    };
+
+    /**
+    * Read-only, reference counted view of a scan owned by the driver
+    *
+    * The buffer is not copied. It goes back to the driver once the last lease referring to it
+    * is released or destroyed. A lease must not outlive the driver it has been grabbed from.
+    */
+    class LidarScanLease
+    {
+    public:
+        LidarScanLease()
+            : _owner(NULL)
+            , _slot(-1)
+        {
+            _buffer.nodes = NULL;
+            _buffer.count = 0;
+            _buffer.sequence = 0;
+            _buffer.timestamp_us = 0;
+            _buffer.timestamps_ns = NULL;
+            _buffer.start_ns = 0;
+            _buffer.end_ns = 0;
+            _buffer.publish_flags = 0;
+            _buffer.angle_q14 = NULL;
+            _buffer.dist_q2 = NULL;
+            _buffer.quality = NULL;
+            _buffer.x = NULL;
+            _buffer.y = NULL;
+            _buffer.views = NULL;
+            _buffer.view_count = 0;
+        }
+
+        LidarScanLease(IScanBufferOwner* owner, int slot, const LidarScanBuffer& buffer)
+            : _owner(owner)
+            , _slot(slot)
+            , _buffer(buffer)
+        {
+        }
+
+        LidarScanLease(const LidarScanLease& other)
+            : _owner(other._owner)
+            , _slot(other._slot)
+            , _buffer(other._buffer)
+        {
+            if (_owner) _owner->retainScanBuffer(_slot);
+        }
+
+        ~LidarScanLease()
+        {
+            release();
+        }
+
+        LidarScanLease& operator= (const LidarScanLease& other)
+        {
+            if (this != &other) {
+                if (other._owner) other._owner->retainScanBuffer(other._slot);
+                release();
+                _owner = other._owner;
+                _slot = other._slot;
+                _buffer = other._buffer;
+            }
+            return *this;
+        }
+
+        /// Give the buffer back to the driver, the lease is empty afterwards
+        void release()
+        {
+            if (_owner) _owner->releaseScanBuffer(_slot);
+            _owner = NULL;
+            _slot = -1;
+            _buffer.nodes = NULL;
+            _buffer.timestamps_ns = NULL;
+            _buffer.count = 0;
+        }
+
+        bool valid() const { return _owner != NULL; }
+
+        const sl_lidar_response_measurement_node_hq_t* nodes() const { return _buffer.nodes; }
+        size_t count() const { return _buffer.count; }
+        sl_u64 sequence() const { return _buffer.sequence; }
+        sl_u64 timestamp_us() const { return _buffer.timestamp_us; }
+        const sl_u64* timestamps_ns() const { return _buffer.timestamps_ns; }
+        sl_u64 start_ns() const { return _buffer.start_ns; }
+        sl_u64 end_ns() const { return _buffer.end_ns; }
+        sl_u32 publish_flags() const { return _buffer.publish_flags; }
+        const sl_u16* angle_q14() const { return _buffer.angle_q14; }
+        const sl_u32* dist_q2() const { return _buffer.dist_q2; }
+        const sl_u8* quality() const { return _buffer.quality; }
+        const float* x() const { return _buffer.x; }
+        const float* y() const { return _buffer.y; }
+        size_t view_count() const { return _buffer.view_count; }
+
+        /// Result of a view for this scan, NULL if the view did not exist when the scan was published
+        const LidarScanView* view(int viewId) const
+        {
+            return (viewId >= 0 && (size_t)viewId < _buffer.view_count) ? &_buffer.views[viewId] : NULL;
+        }
+
+        const sl_lidar_response_measurement_node_hq_t& operator[] (size_t pos) const { return _buffer.nodes[pos]; }
+
+    private:
+        IScanBufferOwner* _owner;
+        int               _slot;
+        LidarScanBuffer   _buffer;
+    };
+
     class ILidarDriver
     {
     public:
@@ -359,7 +836,8 @@ namespace sl {
         ///
         /// 1) The first node of the grabbed data array (nodebuffer[0]) must be the first sample of a scan, i.e. the start_bit == 1
         /// 2) All data nodes are belong to exactly ONE complete 360-degrees's scan
-        /// 3) Note, the angle data in one scan may not be ascending. You can use API ascendScanData to reorder the nodebuffer.
+        /// 3) Note, the angle data in one scan may not be ascending. You can use API ascendScanData to reorder the nodebuffer, or let the driver sort every scan (see setScanPublishOptions).
+        /// 4) Each complete scan is handed out once. Use grabScanLease to read a scan without copying it.
         ///
         /// \param nodebuffer     Buffer provided by the caller application to store the scan data
         ///
@@ -373,6 +851,25 @@ namespace sl {
         /// \The caller application can set the timeout value to Zero(0) to make this interface always returns immediately to achieve non-block operation.
         virtual sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Same as grabScanDataHq, and store the sampling time of every node as well
+        ///
+        /// \param timestamps     Buffer receiving one timestamp per node (in nanoseconds, monotonic clock), it must hold count entries.
+        ///                       timestamps[i] is the sampling time of nodebuffer[i], on the host monotonic clock (CLOCK_MONOTONIC on Linux).
+        virtual sl_result grabScanDataHqWithTimestamps(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Wait for a complete 0-360 degree scan newer than the one currently held by the lease and grab it without copying.
+        /// The lease keeps the scan buffer alive, the driver will not reuse it before the lease (and all of its copies) is released.
+        /// The leased data has the same charactistics as the data returned by grabScanDataHq.
+        ///
+        /// \param lease          Lease to store the scan in. A previously held scan is released once the new one has been grabbed.
+        ///                       An empty lease grabs the latest scan available.
+        ///
+        /// \param timeout        Max duration allowed to wait for a newer scan.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT and leave the lease untouched if no newer scan can be retrieved withing the given timeout duration.
+        /// Note, grabScanLease and grabScanDataHq share the same scan notification, wait for scans from one thread only. The lease itself can be handed to other threads.
+        virtual sl_result grabScanLease(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
         /// Ascending the scan data according to the angle value in the scan.
         ///
         /// \param nodebuffer     Buffer provided by the caller application to do the reorder. Should be retrived from the grabScanData
@@ -380,6 +877,8 @@ namespace sl {
         /// \param count          The caller must initialize this parameter to set the max data count of the provided buffer (in unit of rplidar_response_measurement_node_t).
         ///                       Once the interface returns, this parameter will store the actual received data count.
         /// The interface will return SL_RESULT_OPERATION_FAIL when all the scan data is invalid. 
+        /// The angles are handled as q14 integers. A scan in device order is ascending apart from the wrap at 360 degrees,
+        /// reordering it costs little more than one pass over the nodes.
         virtual sl_result ascendScanData(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t count) = 0;
 
         /// Return received scan points even if it's not complete scan
@@ -389,7 +888,88 @@ namespace sl {
         /// \param count          Once the interface returns, this parameter will store the actual received data count.
         ///
         /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
+        /// At most 8192 nodes are returned per call, use drainScanDataWithIntervalHq to pass the buffer size.
         virtual sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count) = 0;
+
+        /// Move the nodes received since last call into the caller's buffer
+        /// The nodes are buffered in a lock-free ring, nodes which do not fit are dropped and counted (see getScanIntervalBufferStats).
+        /// Only one thread should retrieve interval data at a time.
+        ///
+        /// \param nodebuffer     Buffer provided by the caller application to store the scan data
+        ///
+        /// \param count          The caller must initialize this parameter to set the max data count of the provided buffer (in unit of sl_lidar_response_measurement_node_hq_t).
+        ///                       Once the interface returns, this parameter will store the actual received data count.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT if no node is available.
+        virtual sl_result drainScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count) = 0;
+
+        /// Same as drainScanDataWithIntervalHq, but blocks until at least one node is available
+        ///
+        /// \param timeout        The timeout value (in millisecond) to wait for the first node
+        virtual sl_result waitScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Set the size of the interval data buffer, it takes effect at the next startScan
+        /// By default the buffer holds two revolutions of the selected scan mode.
+        ///
+        /// \param nodeCount      Number of nodes to hold, rounded up to a power of two. 0 restores the default size.
+        virtual sl_result setScanIntervalBufferSize(size_t nodeCount) = 0;
+
+        /// Set the upper bound of the number of nodes kept per scan (8192 by default), it takes effect at the next startScan
+        /// The scan buffers are allocated at startScan and sized from the points per revolution of the selected scan mode.
+        /// They can only be moved when no LidarScanLease is held, otherwise startScan keeps them if they are large enough.
+        ///
+        /// \param maxNodes       Maximum number of nodes of one scan
+        virtual sl_result setScanBufferLimit(size_t maxNodes) = 0;
+
+        /// Deliver every revolution in angular sectors, each one as soon as the lidar has swept over it
+        /// A consumer interested in part of the field of view does not need to wait for the complete revolution.
+        /// Sectors are only delivered for revolutions which start at the sync node, like the scans published by the driver.
+        /// It can only be changed while the lidar is not scanning.
+        ///
+        /// \param listener       Receives the sectors, NULL to stop the delivery. It must outlive the scan.
+        /// \param sectorDegrees  Angular size of a sector (in degrees), up to 360
+        virtual sl_result setScanSectorListener(ILidarSectorListener* listener, float sectorDegrees) = 0;
+
+        /// Select the processing applied by the cache thread to every scan before it is published
+        /// A sorted scan is handed out by grabScanDataHq and grabScanLease in ascending angle order, the consumers do not need to call ascendScanData.
+        /// The SoA arrays and Cartesian coordinates are only available through grabScanLease.
+        /// It can only be changed while the lidar is not scanning.
+        ///
+        /// \param flags          Combination of ScanPublishFlag, 0 publishes the scans in device order
+        virtual sl_result setScanPublishOptions(sl_u32 flags) = 0;
+
+        /// Set the priority and CPU affinity of the cache thread, applied each time startScan creates it
+        /// A realtime thread pinned away from the inference and display threads decodes every frame as soon as it arrives on a loaded system.
+        /// The policy is applied on a best effort basis: realtime priorities need CAP_SYS_NICE or an RLIMIT_RTPRIO, the scan starts with
+        /// the default scheduling if they are refused. Called while scanning, the policy is also applied to the running thread right away.
+        ///
+        /// The interface will return the result of applying the policy to the running thread, SL_RESULT_OK if the lidar is not scanning.
+        virtual sl_result setScanThreadPolicy(const LidarThreadPolicy& policy) = 0;
+
+        /// Register a view, the cache thread filters every revolution through it once before publishing the scan
+        /// The views share the decoding of the scan, each one is read from the lease with LidarScanLease::view.
+        /// Views can only be added while the lidar is not scanning, and hold storage for a full scan in every scan buffer.
+        ///
+        /// \param desc           Windows, quality, distance range and decimation of the view
+        /// \param viewId         Receives the id of the view, ids are given in increasing order from 0
+        ///
+        /// The interface will return SL_RESULT_INVALID_DATA for an invalid descriptor, SL_RESULT_INSUFFICIENT_MEMORY once LIDAR_MAX_SCAN_VIEWS views exist.
+        virtual sl_result addScanView(const LidarScanViewDesc& desc, int& viewId) = 0;
+
+        /// Remove every view, it can only be done while the lidar is not scanning
+        virtual sl_result clearScanViews() = 0;
+
+        /// Maximum number of nodes of one scan with the current scan buffers
+        /// It is 0 until the first startScan. A buffer of this size always holds a complete grabScanDataHq result.
+        virtual size_t getMaxScanNodes() = 0;
+
+        /// Retrieve the capacity, fill level and drop counters of the interval data buffer
+        virtual void getScanIntervalBufferStats(LidarIntervalBufferStats& stats) = 0;
+
+        /// Retrieve the protocol and throughput counters of the driver
+        /// The counters are updated lock-free by the thread decoding the data and can be read at any time from any thread.
+        virtual void getStatistics(LidarStatistics& stats) = 0;
+
         /// Set lidar motor speed
         /// The host system can use this operation to set lidar motor speed.
         ///
@@ -412,6 +992,24 @@ namespace sl {
         /// \param requiredBaudRate   The new baudrate required to be used. It MUST matches with the baudrate of the binded channel.
         /// \param baudRateDetected   The actual baudrate detected by the LIDAR system
         virtual sl_result negotiateSerialBaudRate(sl_u32 requiredBaudRate, sl_u32* baudRateDetected = NULL) = 0;
+
+        /// Let the caller decode the scan data instead of the driver's own cache thread (used by ILidarFleet)
+        /// In external pump mode startScan does not spawn a thread, the data is only processed by pumpScanData.
+        /// It can only be changed while the lidar is not scanning.
+        ///
+        /// \param enable         true to switch to external pump mode
+        virtual sl_result setExternalPump(bool enable) = 0;
+
+        /// Decode the scan data the channel has received so far, without blocking
+        /// The channel must be pollable (see IChannel::getPollHandle), call this once it has data ready.
+        ///
+        /// \param publishedScans Receives the number of complete scans published by this call
+        ///
+        /// The interface will return SL_RESULT_OPERATION_STOP if the lidar is not scanning, SL_RESULT_OPERATION_FAIL on channel errors.
+        virtual sl_result pumpScanData(size_t& publishedScans) = 0;
+
+        /// Poll handle of the bound channel, -1 if it cannot be polled
+        virtual int getPollHandle() = 0;
 };
 
     /**
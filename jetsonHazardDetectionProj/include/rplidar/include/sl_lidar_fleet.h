@@ -0,0 +1,117 @@
+/*
+* Slamtec LIDAR SDK
+*
+* sl_lidar_fleet.h
+*
+* Copyright (c) 2020 Shanghai Slamtec Co., Ltd.
+*/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * A complete scan delivered by ILidarFleet, tagged with the device it comes from
+    */
+    struct LidarFleetScan
+    {
+        LidarFleetScan()
+            : device_id(-1)
+        {
+        }
+
+        // ID returned by ILidarFleet::addDevice
+        int             device_id;
+
+        // The scan itself, it stays valid as long as the lease is held
+        LidarScanLease  lease;
+    };
+
+    /**
+    * Drives several lidars from a single reactor thread
+    *
+    * The drivers added to a fleet do not run their own cache thread. The fleet waits on all their
+    * channels at once (epoll) and decodes the received frames in its reactor. The channels must be
+    * pollable, see IChannel::getPollHandle.
+    */
+    class ILidarFleet
+    {
+    public:
+        virtual ~ILidarFleet() {}
+
+        /// Add a connected driver which is not scanning yet
+        /// The driver is switched to external pump mode, start its scan with startScan as usual afterwards.
+        ///
+        /// \param driver        The driver to add, it must outlive its membership in the fleet
+        /// \param deviceId      Receives the ID tagging the scans of this driver
+        virtual sl_result addDevice(ILidarDriver* driver, int& deviceId) = 0;
+
+        /// Remove a driver from the fleet and give it its cache thread back
+        /// Its scan must be stopped first.
+        virtual sl_result removeDevice(int deviceId) = 0;
+
+        /// Start the reactor thread
+        virtual sl_result start() = 0;
+
+        /// Stop the reactor thread
+        virtual void stop() = 0;
+
+        /// Run the reactor from the caller's thread instead of start()
+        /// Waits up to timeout ms for data on any device and decodes everything received.
+        virtual sl_result runOnce(sl_u32 timeout) = 0;
+
+        /// Wait until any device has a revolution which has not been delivered yet
+        /// Each revolution is delivered once, devices are served in turn.
+        ///
+        /// \param scan          Receives the device ID and the lease on its latest scan, the lease it held before is released
+        /// \param timeout       The timeout value (in millisecond)
+        virtual sl_result waitAnyScan(LidarFleetScan& scan, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+    };
+
+    /**
+    * Create a lidar fleet, only supported on Linux
+    *
+    * Example
+    * auto fleet = createLidarFleet();
+    * int front, rear;
+    * (*fleet)->addDevice(frontLidar, front);
+    * (*fleet)->addDevice(rearLidar, rear);
+    * frontLidar->startScan(false, true);
+    * rearLidar->startScan(false, true);
+    * (*fleet)->start();
+    *
+    * LidarFleetScan scan;
+    * while (SL_IS_OK((*fleet)->waitAnyScan(scan))) {
+    *     printf("device %d: %d nodes\n", scan.device_id, (int)scan.lease.count());
+    * }
+    */
+    Result<ILidarFleet*> createLidarFleet();
+}
@@ -0,0 +1,124 @@
+/*
+* Slamtec LIDAR SDK
+*
+* sl_lidar_fleet.h
+*
+* Copyright (c) 2020 Shanghai Slamtec Co., Ltd.
+*/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Recording file layout
+    *
+    * The file starts with an 8 bytes header: the "SLLR" magic, the format version and a reserved word.
+    * Records follow back to back, each one a RecordingBlockHeader and the bytes of the block. Fields are
+    * in host byte order. A session recorded into an existing file appends its records after the previous ones.
+    */
+    enum
+    {
+        LIDAR_RECORDING_MAGIC = 0x524C4C53, // "SLLR"
+        LIDAR_RECORDING_VERSION = 1,
+    };
+
+    // Set in RecordingBlockHeader::size for bytes written to the device, the others have been received from it
+    static const sl_u32 LIDAR_RECORDING_BLOCK_TX = 0x80000000;
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+    struct RecordingFileHeader
+    {
+        sl_u32  magic;
+        sl_u16  version;
+        sl_u16  reserved;
+    } __attribute__((packed));
+
+    struct RecordingBlockHeader
+    {
+        // Host monotonic time the block has been read or written (in nanoseconds)
+        sl_u64  timestamp_ns;
+        // Byte count of the block, LIDAR_RECORDING_BLOCK_TX flags the written ones
+        sl_u32  size;
+    } __attribute__((packed));
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+    /**
+    * Create a channel which records the traffic of another one
+    *
+    * Every call is forwarded to channel. The blocks it reads and writes are copied, with the time they went
+    * through, to a buffer which a background thread appends to the file, the calls never wait for the disk.
+    * If the disk falls behind by more than the buffer holds (a few seconds at the highest baudrate) blocks are
+    * dropped from the recording instead.
+    *
+    * \param channel  The channel to record, it is deleted with the recording channel
+    * \param type     Type of channel, the recording channel of a serial port is an ISerialPortChannel as well
+    * \param path     Recording file, created if needed and appended to otherwise
+    */
+    Result<IChannel*> createRecordingChannel(IChannel* channel, ChannelType type, const std::string& path);
+
+    /**
+    * Channel playing a recording back, see createReplayChannel
+    */
+    class IReplayChannel : public IChannel
+    {
+    public:
+        virtual ~IReplayChannel() {}
+
+        /// True once every recorded block has been delivered, the channel then behaves like a silent device
+        virtual bool isFinished() = 0;
+
+        /// Received bytes delivered so far, out of the recorded total
+        virtual sl_u64 getDeliveredBytes() = 0;
+        virtual sl_u64 getRecordedBytes() = 0;
+    };
+
+    /**
+    * Create a channel which plays a recording back to the driver
+    *
+    * open() loads the whole file. A received block is delivered only after the driver has written as many
+    * blocks as it had when the block was recorded, so the answers to commands never arrive before the
+    * commands, whatever the pace. Bytes the driver writes are discarded.
+    *
+    * \param path      Recording file made by a channel of createRecordingChannel
+    * \param realTime  Deliver the blocks with their recorded spacing, counted from the write they answer.
+    *                  Otherwise they are delivered as fast as they are read, to run the decoder offline.
+    */
+    Result<IReplayChannel*> createReplayChannel(const std::string& path, bool realTime);
+
+}
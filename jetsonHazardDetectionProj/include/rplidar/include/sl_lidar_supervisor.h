@@ -0,0 +1,159 @@
+/*
+* Slamtec LIDAR SDK
+*
+* sl_lidar_fleet.h
+*
+* Copyright (c) 2020 Shanghai Slamtec Co., Ltd.
+*/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    enum LidarSupervisorState
+    {
+        // start() has not been called, or stop() has
+        LIDAR_SUPERVISOR_STOPPED = 0,
+
+        // Opening the channel and starting the scan for the first time
+        LIDAR_SUPERVISOR_STARTING,
+
+        // Revolutions arrive in time
+        LIDAR_SUPERVISOR_RUNNING,
+
+        // No revolution for stall_timeout_ms, the channel is being reopened and the scan restarted
+        LIDAR_SUPERVISOR_DEGRADED,
+    };
+
+    /**
+    * How ILidarSupervisor detects a stalled lidar and how it restarts it
+    */
+    struct LidarSupervisorConfig
+    {
+        LidarSupervisorConfig()
+            : stall_timeout_ms(1000)
+            , backoff_min_ms(100)
+            , backoff_max_ms(5000)
+            , use_typical_scan(true)
+            , scan_mode(0)
+        {
+        }
+
+        // Time without a complete revolution after which the lidar is considered stalled (in milliseconds).
+        // A freshly started scan gets the same time to deliver its first revolution.
+        sl_u32  stall_timeout_ms;
+
+        // Delay between two failed restart attempts, doubled after each failure up to backoff_max_ms (in milliseconds)
+        sl_u32  backoff_min_ms;
+        sl_u32  backoff_max_ms;
+
+        // Scan to (re)start: startScan(false, true) if use_typical_scan, startScanExpress(false, scan_mode) otherwise
+        bool    use_typical_scan;
+        sl_u16  scan_mode;
+    };
+
+    struct LidarSupervisorStatus
+    {
+        LidarSupervisorState state;
+
+        // Complete revolutions seen since start()
+        sl_u64      revolutions;
+
+        // Host monotonic time the last revolution has been seen (in nanoseconds), 0 before the first one
+        sl_u64      last_revolution_ns;
+
+        // Host monotonic time the current stall has been detected (in nanoseconds), 0 while running
+        sl_u64      degraded_since_ns;
+
+        // Failed restart attempts of the current stall
+        sl_u32      failed_attempts;
+
+        // Stalls the lidar recovered from
+        sl_u64      recoveries;
+
+        // Time from detecting the last stall to the first revolution after it (in nanoseconds)
+        sl_u64      last_recovery_ns;
+
+        // Result of the last failed restart attempt
+        sl_result   last_error;
+    };
+
+    /**
+    * Keeps a lidar scanning across link failures
+    *
+    * The supervisor thread watches the revolutions published by the driver. When none has arrived for
+    * stall_timeout_ms (unplugged USB adapter, dead motor, hung firmware) it stops the driver, reopens
+    * the channel and restarts the scan, waiting backoff_min_ms to backoff_max_ms between attempts.
+    * The driver keeps its configuration (publish options, views, listeners) across restarts.
+    *
+    * None of the calls made by the consumer block on the restart, it reads the scans through the
+    * supervisor and carries on with what it has while the lidar is degraded. The driver must use its own
+    * cache thread (not be part of an ILidarFleet) and must not be started or stopped by anyone else.
+    */
+    class ILidarSupervisor
+    {
+    public:
+        virtual ~ILidarSupervisor() {}
+
+        /// Start the supervisor thread, which connects the driver if needed and starts the scan
+        virtual sl_result start() = 0;
+
+        /// Stop the supervisor thread and the scan
+        virtual void stop() = 0;
+
+        /// Grab the latest scan if it is newer than the one held by the lease, without waiting
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT if the lease already holds the latest scan,
+        /// and SL_RESULT_OPERATION_STOP if the lidar is not running (see getState). The lease is left untouched then.
+        virtual sl_result grabScanLease(LidarScanLease& lease) = 0;
+
+        virtual LidarSupervisorState getState() = 0;
+
+        virtual void getStatus(LidarSupervisorStatus& status) = 0;
+    };
+
+    /**
+    * Create a supervisor around a driver and the channel it uses
+    *
+    * Example
+    * LidarSupervisorConfig config;
+    * ILidarSupervisor* supervisor = *createLidarSupervisor(drv, channel, config);
+    * supervisor->start();
+    *
+    * LidarScanLease scan;
+    * for (;;) {
+    *     if (supervisor->getState() != LIDAR_SUPERVISOR_RUNNING) scan.release();
+    *     supervisor->grabScanLease(scan);
+    *     if (scan.valid()) { ... }
+    * }
+    */
+    Result<ILidarSupervisor*> createLidarSupervisor(ILidarDriver* driver, IChannel* channel, const LidarSupervisorConfig& config = LidarSupervisorConfig());
+}
@@ -46,9 +46,13 @@
 #include <time.h>
 #include "hal/types.h"
 #include "arch/linux/net_serial.h"
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <linux/serial.h>
 
 #include <algorithm>
+#include <limits.h>
 //__GNUC__
 #if defined(__GNUC__)
 // for Linux extension
@@ -69,6 +73,7 @@ namespace rp{ namespace arch{ namespace net{
 raw_serial::raw_serial()
     : rp::hal::serial_rxtx()
     , _baudrate(0)
+    , _actual_baudrate(0)
     , _flags(0)
     , serial_fd(-1)
 {
@@ -147,6 +152,7 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
         close();
         return false;
     }
+    _actual_baudrate = baudrate;
 
 #else
 
@@ -170,7 +176,9 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
     tio.c_iflag &= ~(IXON | IXOFF | IXANY); // no sw flow control
 
 
-    tio.c_cc[VMIN] = 0;         //min chars to read
+    // The port is non-blocking and waits in epoll, VMIN / VTIME never delay a read. VMIN = 1 makes an
+    // empty read fail with EAGAIN, so that a read returning 0 only means the device has hung up.
+    tio.c_cc[VMIN] = 1;         //min chars to read
     tio.c_cc[VTIME] = 0;        //time in 1/10th sec wait
 
     tio.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
@@ -181,7 +189,25 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
     tio.c_ospeed = baudrate;
 
 
-    ioctl(serial_fd, TCSETS2, &tio);
+    if (ioctl(serial_fd, TCSETS2, &tio) == -1)
+    {
+        close();
+        return false;
+    }
+
+    // BOTHER accepts any rate, the UART driver picks the closest one its clock divider can produce.
+    // Read it back and refuse rates it cannot get close enough to for the lidar to keep in sync.
+    if (ioctl(serial_fd, TCGETS2, &tio) == -1)
+    {
+        close();
+        return false;
+    }
+    _actual_baudrate = tio.c_ospeed;
+    if ((_u64)std::max(_actual_baudrate, baudrate) * 100 > (_u64)std::min(_actual_baudrate, baudrate) * (100 + BAUDRATE_TOLERANCE_PERCENT))
+    {
+        close();
+        return false;
+    }
 
 #endif
 
@@ -195,33 +221,47 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
     }
 
 
+#if defined(__GNUC__)
+    // USB serial adapters (FTDI) hold received bytes up to 16 ms before passing them on, low latency
+    // mode hands them over every millisecond. Ports which do not know the flag (pty, CDC-ACM) refuse it.
+    struct serial_struct serial_info;
+    if (ioctl(serial_fd, TIOCGSERIAL, &serial_info) == 0)
+    {
+        serial_info.flags |= ASYNC_LOW_LATENCY;
+        ioctl(serial_fd, TIOCSSERIAL, &serial_info);
+    }
+#endif
+
+    // the eventfd wakes up a wait from cancelOperation, a single read resets it however often it was signalled
+    _cancel_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (_cancel_fd == -1 || _epoll_fd == -1)
+    {
+        close();
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = serial_fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, serial_fd, &event) == -1)
+    {
+        close();
+        return false;
+    }
+    event.data.fd = _cancel_fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _cancel_fd, &event) == -1)
+    {
+        close();
+        return false;
+    }
+
     _is_serial_opened = true;
     _operation_aborted = false;
+    _rx_drained = false;
 
     //Clear the DTR bit to let the motor spin
     clearDTR();
-    do {
-        // create self pipeline for wait cancellation
-        if (pipe(_selfpipe) == -1) break;
-
-        int flags = fcntl(_selfpipe[0], F_GETFL);
-        if (flags == -1)
-            break;
-
-        flags |= O_NONBLOCK;                /* Make read end nonblocking */
-        if (fcntl(_selfpipe[0], F_SETFL, flags) == -1)
-            break;
-
-        flags = fcntl(_selfpipe[1], F_GETFL);
-        if (flags == -1)
-            break;
-
-        flags |= O_NONBLOCK;                /* Make write end nonblocking */
-        if (fcntl(_selfpipe[1], F_SETFL, flags) == -1)
-            break;
-
-    } while (0);
-    
     return true;
 }
 
@@ -231,16 +271,17 @@ void raw_serial::close()
         ::close(serial_fd);
     serial_fd = -1;
     
-    if (_selfpipe[0] != -1)
-        ::close(_selfpipe[0]);
+    if (_epoll_fd != -1)
+        ::close(_epoll_fd);
 
-    if (_selfpipe[1] != -1)
-        ::close(_selfpipe[1]);
+    if (_cancel_fd != -1)
+        ::close(_cancel_fd);
 
-    _selfpipe[0] = _selfpipe[1] = -1;
+    _epoll_fd = _cancel_fd = -1;
 
     _operation_aborted = false;
     _is_serial_opened = false;
+    _actual_baudrate = 0;
 }
 
 int raw_serial::senddata(const unsigned char * data, size_t size)
@@ -273,10 +314,80 @@ int raw_serial::recvdata(unsigned char * data, size_t size)
     int ans = ::read(serial_fd, data, size);
     
     if (ans == -1) ans=0;
+    _rx_drained = (size_t)ans < size;
     required_rx_cnt = ans;
     return ans;
 }
 
+int raw_serial::waitandrecv(unsigned char * data, size_t size, size_t min_count, _u32 timeout)
+{
+    if (!isOpened()) return -1;
+    if (min_count > size) min_count = size;
+
+    _u64 deadline = _deadline(timeout);
+    size_t received = 0;
+
+    // the last read left the port empty, there is no point reading again before epoll reports data
+    bool readable = !_rx_drained;
+
+    for (;;)
+    {
+        if (readable)
+        {
+            ssize_t ans = ::read(serial_fd, data + received, size - received);
+            if (ans > 0)
+            {
+                received += ans;
+                _rx_drained = received < size;
+                if (received >= min_count || received == size) break;
+            }
+            else if (ans == 0 || (errno != EAGAIN && errno != EINTR))
+            {
+                // 0 means hangup, see VMIN in open()
+                _rx_drained = true;
+                return received ? (int)received : -1;
+            }
+            else
+            {
+                _rx_drained = true;
+            }
+        }
+
+        _u32 remaining = _remainingMs(deadline);
+        if (remaining == 0) break;
+
+        int ans;
+        if (received)
+        {
+            // the rest of the frame is on its way, sleep for its transfer time instead of waking up for every USB packet
+            _u64 transfer_us = (_u64)(min_count - received) * 10 * 1000000 / (_actual_baudrate ? _actual_baudrate : _baudrate);
+            ans = _sleepCancellable(std::min<_u64>(transfer_us, (_u64)remaining * 1000));
+        }
+        else
+        {
+            ans = _waitReadable(remaining);
+        }
+
+        if (ans == ANS_DEV_ERR) return received ? (int)received : -1;
+        if (ans != ANS_OK) break;
+        readable = true;
+    }
+
+    required_rx_cnt = received;
+    return (int)received;
+}
+
+
+int raw_serial::getPollHandle()
+{
+    // the port is opened with O_NDELAY, reads return what is available
+    return isOpened() ? serial_fd : -1;
+}
+
+_u32 raw_serial::getBaudRate()
+{
+    return _actual_baudrate;
+}
 
 void raw_serial::flush( _u32 flags)
 {
@@ -303,87 +414,104 @@ int raw_serial::waitfordata(size_t data_count, _u32 timeout, size_t * returned_s
     if (returned_size==NULL) returned_size=(size_t *)&length;
     *returned_size = 0;
 
-    int max_fd;
-    fd_set input_set;
-    struct timeval timeout_val;
-
-    /* Initialize the input set */
-    FD_ZERO(&input_set);
-    FD_SET(serial_fd, &input_set);
-
-    if (_selfpipe[0] != -1)
-        FD_SET(_selfpipe[0], &input_set);
-
-    max_fd =  std::max<int>(serial_fd, _selfpipe[0]) + 1;
+    if (!isOpened()) return ANS_DEV_ERR;
 
-    /* Initialize the timeout structure */
-    timeout_val.tv_sec = timeout / 1000;
-    timeout_val.tv_usec = (timeout % 1000) * 1000;
-
-    if ( isOpened() )
+    if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
+    if (*returned_size >= data_count)
     {
-        if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
-        if (*returned_size >= data_count)
-        {
-            return 0;
-        }
+        return 0;
     }
 
+    _u64 deadline = _deadline(timeout);
     while ( isOpened() )
     {
-        /* Do the select */
-        int n = ::select(max_fd, &input_set, NULL, NULL, &timeout_val);
+        _u32 remaining = _remainingMs(deadline);
+        int ans = *returned_size ? ANS_OK : _waitReadable(remaining);
+        if (ans == ANS_OK && *returned_size)
+        {
+            // sleep for the transfer time of the missing bytes instead of waking up for every USB packet
+            _u64 transfer_us = (_u64)(data_count - *returned_size) * 10 * 1000000 / (_actual_baudrate ? _actual_baudrate : _baudrate);
+            ans = _sleepCancellable(std::min<_u64>(transfer_us, (_u64)remaining * 1000));
+        }
+        if (ans != ANS_OK)
+        {
+            *returned_size = 0;
+            return ans;
+        }
 
-        if (n < 0)
+        if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
+        if (*returned_size >= data_count)
         {
-            // select error
-            *returned_size =  0;
-            return ANS_DEV_ERR;
+            return 0;
         }
-        else if (n == 0)
+        if (remaining == 0)
         {
-            // time out
-            *returned_size =0;
+            *returned_size = 0;
             return ANS_TIMEOUT;
         }
-        else
-        {
-            if (FD_ISSET(_selfpipe[0], &input_set)) {   
-                // require aborting the current operation
-                int ch;
-                for (;;) {                    
-                    if (::read(_selfpipe[0], &ch, 1) == -1) {
-                        break;
-                    }
-                    
-                }
-
-                // treat as  timeout
-                *returned_size = 0;
-                return ANS_TIMEOUT;
-            }
+    }
 
-            // data avaliable
-            assert (FD_ISSET(serial_fd, &input_set));
+    return ANS_DEV_ERR;
+}
+
+_u64 raw_serial::_deadline(_u32 timeout)
+{
+    if (timeout == (_u32)-1) return (_u64)-1;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (_u64)now.tv_sec * 1000 + now.tv_nsec / 1000000 + timeout;
+}
 
+_u32 raw_serial::_remainingMs(_u64 deadline)
+{
+    if (deadline == (_u64)-1) return (_u32)-1;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    _u64 now_ms = (_u64)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    return now_ms >= deadline ? 0 : (_u32)(deadline - now_ms);
+}
 
-            if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
-            if (*returned_size >= data_count)
-            {
-                return 0;
-            }
-            else 
-            {
-                int remain_timeout = timeout_val.tv_sec*1000000 + timeout_val.tv_usec;
-                int expect_remain_time = (data_count - *returned_size)*1000000*8/_baudrate;
-                if (remain_timeout > expect_remain_time)
-                    usleep(expect_remain_time);
-            }
+int raw_serial::_waitReadable(_u32 timeout)
+{
+    epoll_event events[2];
+    int n = epoll_wait(_epoll_fd, events, 2, timeout == (_u32)-1 ? -1 : (int)std::min<_u32>(timeout, INT_MAX));
+    if (n < 0) return errno == EINTR ? ANS_OK : ANS_DEV_ERR;
+    if (n == 0) return ANS_TIMEOUT;
+
+    int ans = ANS_OK;
+    for (int i = 0; i < n; ++i)
+    {
+        if (events[i].data.fd == _cancel_fd)
+        {
+            // require aborting the current operation, treat as timeout
+            eventfd_t value;
+            eventfd_read(_cancel_fd, &value);
+            return ANS_TIMEOUT;
         }
-        
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) ans = ANS_DEV_ERR;
     }
+    return ans;
+}
 
-    return ANS_DEV_ERR;
+int raw_serial::_sleepCancellable(_u64 us)
+{
+    if (!us) return ANS_OK;
+
+    pollfd cancel;
+    cancel.fd = _cancel_fd;
+    cancel.events = POLLIN;
+    timespec wait_time;
+    wait_time.tv_sec = us / 1000000;
+    wait_time.tv_nsec = (us % 1000000) * 1000;
+
+    int n = ppoll(&cancel, 1, &wait_time, NULL);
+    if (n > 0)
+    {
+        eventfd_t value;
+        eventfd_read(_cancel_fd, &value);
+        return ANS_TIMEOUT;
+    }
+    return (n < 0 && errno != EINTR) ? ANS_DEV_ERR : ANS_OK;
 }
 
 size_t raw_serial::rxqueue_count()
@@ -417,15 +545,16 @@ void raw_serial::_init()
     _portName[0] = 0;
     required_tx_cnt = required_rx_cnt = 0;
     _operation_aborted = false;
-    _selfpipe[0] = _selfpipe[1] = -1;
+    _rx_drained = false;
+    _epoll_fd = _cancel_fd = -1;
 }
 
 void raw_serial::cancelOperation()
 {
     _operation_aborted = true;
-    if (_selfpipe[1] == -1) return;
+    if (_cancel_fd == -1) return;
 
-    ::write(_selfpipe[1], "x", 1);
+    eventfd_write(_cancel_fd, 1);
 }
 
 _u32 raw_serial::getTermBaudBitmap(_u32 baud)
@@ -44,6 +44,8 @@ public:
     enum{
         SERIAL_RX_BUFFER_SIZE = 512,
         SERIAL_TX_BUFFER_SIZE = 128,
+        // largest mismatch between the requested and the actual baudrate open() accepts
+        BAUDRATE_TOLERANCE_PERCENT = 2,
     };
 
     raw_serial();
@@ -57,6 +59,7 @@ public:
 
     virtual int senddata(const unsigned char * data, size_t size);
     virtual int recvdata(unsigned char * data, size_t size);
+    virtual int waitandrecv(unsigned char * data, size_t size, size_t min_count, _u32 timeout = -1);
 
     virtual int waitforsent(_u32 timeout = -1, size_t * returned_size = NULL);
     virtual int waitforrecv(_u32 timeout = -1, size_t * returned_size = NULL);
@@ -70,12 +73,25 @@ public:
 
     virtual void cancelOperation();
 
+    virtual int getPollHandle();
+
+    virtual _u32 getBaudRate();
+
 protected:
     bool open(const char * portname, uint32_t baudrate, uint32_t flags = 0);
     void _init();
 
+    // deadline / remaining time in milliseconds on the monotonic clock, -1 waits forever
+    _u64 _deadline(_u32 timeout);
+    _u32 _remainingMs(_u64 deadline);
+
+    // ANS_OK once the port is readable, ANS_TIMEOUT on timeout or cancellation
+    int _waitReadable(_u32 timeout);
+    int _sleepCancellable(_u64 us);
+
     char _portName[200];
     uint32_t _baudrate;
+    uint32_t _actual_baudrate;
     uint32_t _flags;
 
     int serial_fd;
@@ -83,8 +99,12 @@ protected:
     size_t required_tx_cnt;
     size_t required_rx_cnt;
 
-    int    _selfpipe[2];
+    int    _epoll_fd;
+    int    _cancel_fd;
     bool   _operation_aborted;
+
+    // the last read returned less than asked for, the port has nothing left
+    bool   _rx_drained;
 };
 
 }}}
@@ -167,7 +167,7 @@ u_result SocketAddress::getAddressAsString(char * buffer, size_t buffersize) con
 
         break;
     }
-    return ans<=0?RESULT_OPERATION_FAIL:RESULT_OK;
+    return ans==NULL?RESULT_OPERATION_FAIL:RESULT_OK;
 }
 
 
@@ -476,7 +476,6 @@ public:
         }
     }
 
-#if 0
     virtual u_result recvNoWait(void *buf, size_t len, size_t & recv_len)
     {
         size_t ans = ::recv( _socket_fd, buf, len, MSG_DONTWAIT);
@@ -491,11 +490,34 @@ public:
 
         } else {
             recv_len = ans;
+            // the peer closed the connection
+            if (!ans && len) return RESULT_OPERATION_FAIL;
             return RESULT_OK;
         }
 
     }
+
+    virtual u_result setReceiveBufferSize(size_t size)
+    {
+        if (!size) return RESULT_OK;
+        int value = (int)size;
+        return ::setsockopt( _socket_fd, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value) )?RESULT_OPERATION_FAIL:RESULT_OK;
+    }
+
+    virtual u_result setBusyPoll(_u32 microseconds)
+    {
+#ifdef SO_BUSY_POLL
+        int value = (int)microseconds;
+        return ::setsockopt( _socket_fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value) )?RESULT_OPERATION_FAIL:RESULT_OK;
+#else
+        return RESULT_OPERATION_NOT_SUPPORT;
 #endif
+    }
+
+    virtual int getPollHandle()
+    {
+        return _socket_fd;
+    }
 
     virtual u_result getPeerAddress(SocketAddress & peerAddr)
     {
@@ -604,10 +626,15 @@ public:
 
     DGramSocketImpl(int fd)
         : _socket_fd(fd)
+        , _drop_count(0)
     {
         assert(fd>=0);
         int bool_true = 1;
         ::setsockopt( _socket_fd, SOL_SOCKET, SO_REUSEADDR | SO_BROADCAST , (char *)&bool_true, sizeof(bool_true) );
+#ifdef SO_RXQ_OVFL
+        // have the kernel attach its drop counter to every datagram received through recvmmsg
+        ::setsockopt( _socket_fd, SOL_SOCKET, SO_RXQ_OVFL, (char *)&bool_true, sizeof(bool_true) );
+#endif
         setTimeout(DEFAULT_SOCKET_TIMEOUT, SOCKET_DIR_BOTH);
     }
 
@@ -779,6 +806,75 @@ public:
 
     }
 
+    virtual u_result recvBatch(void * const * buffers, size_t buffer_size, size_t count, size_t * recv_lens, size_t & received, size_t & truncated)
+    {
+        enum {
+            MAX_BATCH = 64,
+        };
+
+        received = 0;
+        truncated = 0;
+        if (count > MAX_BATCH) count = MAX_BATCH;
+        if (!count) return RESULT_OK;
+
+        mmsghdr msgs[MAX_BATCH];
+        iovec iovs[MAX_BATCH];
+        char controls[MAX_BATCH][CMSG_SPACE(sizeof(_u32))];
+
+        memset(msgs, 0, sizeof(mmsghdr) * count);
+        for (size_t pos = 0; pos < count; ++pos) {
+            iovs[pos].iov_base = buffers[pos];
+            iovs[pos].iov_len = buffer_size;
+            msgs[pos].msg_hdr.msg_iov = &iovs[pos];
+            msgs[pos].msg_hdr.msg_iovlen = 1;
+            msgs[pos].msg_hdr.msg_control = controls[pos];
+            msgs[pos].msg_hdr.msg_controllen = sizeof(controls[pos]);
+        }
+
+        // one system call for every datagram already queued
+        int ans = ::recvmmsg(_socket_fd, msgs, (unsigned int)count, MSG_DONTWAIT, NULL);
+        if (ans < 0) {
+            switch (errno) {
+                case EAGAIN:
+#if EWOULDBLOCK!=EAGAIN
+                case EWOULDBLOCK:
+#endif
+                    return RESULT_OK;
+                default:
+                    return RESULT_OPERATION_FAIL;
+            }
+        }
+
+        for (int pos = 0; pos < ans; ++pos) {
+            recv_lens[pos] = msgs[pos].msg_len;
+            if (msgs[pos].msg_hdr.msg_flags & MSG_TRUNC) ++truncated;
+#ifdef SO_RXQ_OVFL
+            for (cmsghdr * cmsg = CMSG_FIRSTHDR(&msgs[pos].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[pos].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    memcpy(&_drop_count, CMSG_DATA(cmsg), sizeof(_drop_count));
+                }
+            }
+#endif
+        }
+        received = ans;
+        return RESULT_OK;
+    }
+
+    virtual u_result getDropCount(_u32 & dropped)
+    {
+        dropped = _drop_count;
+#ifdef SO_RXQ_OVFL
+        return RESULT_OK;
+#else
+        return RESULT_OPERATION_NOT_SUPPORT;
+#endif
+    }
+
+    virtual int getPollHandle()
+    {
+        return _socket_fd;
+    }
+
 #if 0
     virtual u_result recvFromNoWait(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr)
     {
@@ -807,6 +903,7 @@ public:
     
 protected:
     int  _socket_fd;
+    _u32 _drop_count;
 
 };
 
@@ -36,6 +36,14 @@
 
 #include <sched.h>
 
+// pthread_clockjoin_np (glibc 2.34) measures the join timeout on the monotonic clock,
+// pthread_timedjoin_np only knows the wall clock
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 34)
+#define RP_THREAD_CLOCKJOIN
+#endif
+#endif
+
 namespace rp{ namespace hal{
 
 Thread Thread::create(thread_proc_t proc, void * data)
@@ -57,43 +65,51 @@ u_result Thread::terminate()
     return pthread_cancel((pthread_t)this->_handle)==0?RESULT_OK:RESULT_OPERATION_FAIL;
 }
 
+// Threaded interrupt handlers run at SCHED_FIFO 50. The realtime level stays below them, so the
+// USB / UART interrupt feeding a realtime thread still preempts it.
+static int realtimePriority()
+{
+    int lowest = sched_get_priority_min(SCHED_FIFO);
+    return lowest + (sched_get_priority_max(SCHED_FIFO) - lowest) / 2 - 1;
+}
+
+static int highPriority()
+{
+    int lowest = sched_get_priority_min(SCHED_RR);
+    return lowest + (sched_get_priority_max(SCHED_RR) - lowest) / 4;
+}
+
 u_result Thread::setPriority( priority_val_t p)
 {
     if (!this->_handle) return RESULT_OPERATION_FAIL;
-    
-    // check whether current schedule policy supports priority levels
-    
-    int current_policy;
-    struct sched_param current_param;
-    int ans;
-    if (pthread_getschedparam( (pthread_t) this->_handle, &current_policy, &current_param))
-    {
-        // cannot retreieve values
-        return RESULT_OPERATION_FAIL;
-    }   
 
-    //int pthread_priority = 0 ;
+    int policy = SCHED_OTHER;
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
 
     switch(p)
     {
     case PRIORITY_REALTIME:
-        //pthread_priority = pthread_priority_max;
-        current_policy = SCHED_RR;
+        policy = SCHED_FIFO;
+        param.sched_priority = realtimePriority();
         break;
     case PRIORITY_HIGH:
-        //pthread_priority = (pthread_priority_max + pthread_priority_min)/2;
-        current_policy = SCHED_RR;
+        policy = SCHED_RR;
+        param.sched_priority = highPriority();
         break;
     case PRIORITY_NORMAL:
+        policy = SCHED_OTHER;
+        break;
     case PRIORITY_LOW:
+        policy = SCHED_BATCH;
+        break;
     case PRIORITY_IDLE:
-        //pthread_priority = 0;
-        current_policy = SCHED_OTHER;
+        policy = SCHED_IDLE;
         break;
     }
 
-    current_param.__sched_priority = current_policy;
-    if ( (ans = pthread_setschedparam( (pthread_t) this->_handle, current_policy, &current_param)) )
+    // SCHED_FIFO / SCHED_RR need CAP_SYS_NICE or a high enough RLIMIT_RTPRIO, EPERM otherwise
+    if (pthread_setschedparam( (pthread_t) this->_handle, policy, &param))
     {
         return RESULT_OPERATION_FAIL;
     }
@@ -112,25 +128,94 @@ Thread::priority_val_t Thread::getPriority()
         return PRIORITY_NORMAL;
     }   
 
-    int pthread_priority_max = sched_get_priority_max(SCHED_RR);
-    int pthread_priority_min = sched_get_priority_min(SCHED_RR);
-
-    if (current_param.__sched_priority ==(pthread_priority_max ))
+    switch (current_policy)
     {
+    case SCHED_FIFO:
         return PRIORITY_REALTIME;
+    case SCHED_RR:
+        return PRIORITY_HIGH;
+    case SCHED_BATCH:
+        return PRIORITY_LOW;
+    case SCHED_IDLE:
+        return PRIORITY_IDLE;
+    default:
+        return PRIORITY_NORMAL;
     }
-    if (current_param.__sched_priority >=(pthread_priority_max + pthread_priority_min)/2)
+}
+
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+    if (!cpuMask) return RESULT_INVALID_DATA;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu)
     {
-        return PRIORITY_HIGH;
+        if (cpuMask & ((_u64)1 << cpu)) CPU_SET(cpu, &cpus);
     }
-    return PRIORITY_NORMAL;
+
+    // EINVAL when none of the CPUs of the mask is online
+    if (pthread_setaffinity_np((pthread_t)this->_handle, sizeof(cpus), &cpus))
+    {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
+u_result Thread::setName(const char* name)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+    if (!name) return RESULT_INVALID_DATA;
+
+    // the kernel keeps 15 characters, longer names are rejected with ERANGE
+    char truncated[16];
+    strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = 0;
+    if (pthread_setname_np((pthread_t)this->_handle, truncated))
+    {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
 }
 
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
-    
-    pthread_join((pthread_t)(this->_handle), NULL);
+
+    int ans;
+    if (timeout == (unsigned long)-1)
+    {
+        ans = pthread_join((pthread_t)(this->_handle), NULL);
+    }
+    else
+    {
+#ifdef RP_THREAD_CLOCKJOIN
+        clockid_t clock = CLOCK_MONOTONIC;
+#else
+        clockid_t clock = CLOCK_REALTIME;
+#endif
+        timespec deadline;
+        clock_gettime(clock, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000;
+        }
+#ifdef RP_THREAD_CLOCKJOIN
+        ans = pthread_clockjoin_np((pthread_t)(this->_handle), NULL, clock, &deadline);
+#else
+        ans = pthread_timedjoin_np((pthread_t)(this->_handle), NULL, &deadline);
+#endif
+    }
+
+    if (ans == ETIMEDOUT) return RESULT_OPERATION_TIMEOUT;
+    if (ans) return RESULT_OPERATION_FAIL;
+
+    // a joined pthread_t must not be joined again
+    this->_handle = 0;
     return RESULT_OK;
 }
 
@@ -35,6 +35,13 @@
 #include "arch/linux/arch_linux.h"
 
 namespace rp{ namespace arch{
+_u64 rp_getns()
+{
+    struct timespec t;
+    t.tv_sec = t.tv_nsec = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1000000000LL + t.tv_nsec;
+}
 _u64 rp_getus()
 {
     struct timespec t;
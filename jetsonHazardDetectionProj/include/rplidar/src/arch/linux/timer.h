@@ -49,9 +49,12 @@ static inline void delay(_word_size_t ms){
 // TODO: the highest timer interface should be clock_gettime
 namespace rp{ namespace arch{
 
+_u64 rp_getns();
 _u64 rp_getus();
 _u32 rp_getms();
 
 }}
 
 #define getms() rp::arch::rp_getms()
+#define getus() rp::arch::rp_getus()
+#define getns() rp::arch::rp_getns()
@@ -68,11 +68,27 @@ Thread::priority_val_t Thread::getPriority()
 	return PRIORITY_NORMAL;
 }
 
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+    // macOS has affinity tags but no way to pin a thread to a core
+    return RESULT_OPERATION_NOT_SUPPORT;
+}
+
+u_result Thread::setName(const char* name)
+{
+    if (!this->_handle) return RESULT_OPERATION_FAIL;
+    // pthread_setname_np only names the calling thread here
+    return RESULT_OPERATION_NOT_SUPPORT;
+}
+
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
     
+    // there is no timed join, the timeout is ignored
     pthread_join((pthread_t)(this->_handle), NULL);
+    this->_handle = 0;
     return RESULT_OK;
 }
 
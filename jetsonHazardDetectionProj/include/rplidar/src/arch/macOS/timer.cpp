@@ -33,10 +33,19 @@
  */
 
 #include "arch/macOS/arch_macOS.h"
+#include <mach/mach_time.h>
 
 
 namespace rp{ namespace arch{
-_u64 getus()
+_u64 rp_getns()
+{
+    // mach_absolute_time is monotonic, unlike gettimeofday
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom) mach_timebase_info(&timebase);
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+_u64 rp_getus()
 {
     timeval now;
     gettimeofday(&now,NULL);
@@ -54,6 +54,17 @@ _u32 getHDTimer()
     return (_u32)(current.QuadPart/_current_freq.QuadPart);
 }
 
+_u64 getHDTimerNs()
+{
+    LARGE_INTEGER current;
+    QueryPerformanceCounter(&current);
+
+    // _current_freq holds ticks per millisecond, split the division so the product cannot overflow
+    _u64 ticks = (_u64)current.QuadPart;
+    _u64 perMs = (_u64)_current_freq.QuadPart;
+    return (ticks / perMs) * 1000000 + (ticks % perMs) * 1000000 / perMs;
+}
+
 BEGIN_STATIC_CODE(timer_cailb)
 {
     HPtimer_reset();
@@ -41,7 +41,10 @@
 namespace rp{ namespace arch{
     void HPtimer_reset();
     _u32 getHDTimer();
+    _u64 getHDTimerNs();
 }}
 
 #define getms()   rp::arch::getHDTimer()
+#define getus()   ((_u64)rp::arch::getHDTimer() * 1000)
+#define getns()   rp::arch::getHDTimerNs()
 
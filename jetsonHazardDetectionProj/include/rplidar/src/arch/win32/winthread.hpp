@@ -123,6 +123,25 @@ Thread::priority_val_t Thread::getPriority()
 	return PRIORITY_NORMAL;
 }
 
+u_result Thread::setAffinity(_u64 cpuMask)
+{
+	if (!this->_handle) return RESULT_OPERATION_FAIL;
+	if (!cpuMask) return RESULT_INVALID_DATA;
+
+	if (SetThreadAffinityMask(reinterpret_cast<HANDLE>(this->_handle), (DWORD_PTR)cpuMask))
+	{
+		return RESULT_OK;
+	}
+	return RESULT_OPERATION_FAIL;
+}
+
+u_result Thread::setName(const char* name)
+{
+	if (!this->_handle) return RESULT_OPERATION_FAIL;
+	// SetThreadDescription needs Windows 10 1607, it is not looked up
+	return RESULT_OPERATION_NOT_SUPPORT;
+}
+
 u_result Thread::join(unsigned long timeout)
 {
     if (!this->_handle) return RESULT_OK;
@@ -64,6 +64,19 @@ public:
     virtual int senddata(const unsigned char * data, size_t size) = 0;
     virtual int recvdata(unsigned char * data, size_t size) = 0;
 
+    // wait until min_count bytes are ready and read as many as fit in data, the bytes received before a timeout
+    // are returned as well. Returns the number of bytes read, -1 on device error.
+    virtual int waitandrecv(unsigned char * data, size_t size, size_t min_count, _u32 timeout = -1)
+    {
+        size_t ready = 0;
+        int ans = waitfordata(min_count, timeout, &ready);
+        if (ans == ANS_DEV_ERR) return -1;
+        if (ans != ANS_OK) return 0;
+        if (ready > size) ready = size;
+        if (ready < min_count) ready = min_count;
+        return recvdata(data, ready);
+    }
+
     virtual int waitforsent(_u32 timeout = -1, size_t * returned_size = NULL) = 0;
     virtual int waitforrecv(_u32 timeout = -1, size_t * returned_size = NULL) = 0;
 
@@ -73,6 +86,12 @@ public:
     virtual void clearDTR() = 0;
     virtual void cancelOperation() {}
 
+    // handle usable with select/poll/epoll, -1 if the port cannot be polled
+    virtual int getPollHandle() { return -1; }
+
+    // baudrate the UART actually runs at once opened, 0 if the platform cannot tell
+    virtual _u32 getBaudRate() { return 0; }
+
     virtual bool isOpened()
     {
         return _is_serial_opened;
@@ -0,0 +1,134 @@
+/*
+ *  RPLIDAR SDK
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, 
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stddef.h>
+
+namespace rp{ namespace hal{
+
+/**
+ * A single heap block carved into cache line aligned sections.
+ *
+ * The owner computes the total size with sectionSize(), calls reset() once and then takes the
+ * sections out with allocate(). Nothing is freed individually, the whole block goes away on the
+ * next reset() with a different size or when the arena is destroyed.
+ */
+class Arena
+{
+public:
+    enum
+    {
+        ALIGNMENT = 64,
+    };
+
+    Arena()
+        : _block(NULL)
+        , _base(NULL)
+        , _capacity(0)
+        , _used(0)
+    {
+    }
+
+    ~Arena()
+    {
+        free(_block);
+    }
+
+    /// Bytes taken by a section of the given size, including the alignment padding
+    static size_t sectionSize(size_t bytes)
+    {
+        return (bytes + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    }
+
+    /// Drop every section and make sure the block holds exactly capacity bytes
+    /// \return false if the memory cannot be allocated, the arena is empty then
+    bool reset(size_t capacity)
+    {
+        _used = 0;
+        if (capacity == _capacity && _block) return true;
+
+        free(_block);
+        _block = (unsigned char*)malloc(capacity + ALIGNMENT);
+        if (!_block) {
+            _base = NULL;
+            _capacity = 0;
+            return false;
+        }
+        _base = (unsigned char*)(((size_t)_block + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1));
+        _capacity = capacity;
+        return true;
+    }
+
+    /// \return NULL if the section does not fit in the remaining space
+    void* allocate(size_t bytes)
+    {
+        size_t size = sectionSize(bytes);
+        if (!_base || size > _capacity - _used) return NULL;
+
+        void* section = _base + _used;
+        _used += size;
+        return section;
+    }
+
+    /// Typed helper for plain data, no constructor is run
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(allocate(sizeof(T) * count));
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    size_t used() const
+    {
+        return _used;
+    }
+
+protected:
+    unsigned char* _block;
+    unsigned char* _base;
+    size_t         _capacity;
+    size_t         _used;
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+};
+
+}}
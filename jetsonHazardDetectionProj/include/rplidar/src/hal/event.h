@@ -33,8 +33,23 @@
  */
 
 #pragma once
+
+#ifdef __linux__
+#include <atomic>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 namespace rp{ namespace hal{
 
+/**
+ * Auto or manual reset event
+ *
+ * Timeouts are measured on the monotonic clock, a wall clock step (NTP, GPS time sync) does not change
+ * how long wait() sleeps. On Linux the event is a futex word: set() only enters the kernel when a thread
+ * sleeps on it, and wait() does not when the event is already signalled.
+ */
 class Event
 {
 public:
@@ -50,13 +65,16 @@ public:
 #ifdef _WIN32
         : _event(NULL)
 #else
-        : _is_signalled(isSignal)
-        , _isAutoReset(isAutoReset)
+        : _isAutoReset(isAutoReset)
 #endif
     {
 #ifdef _WIN32
         _event = CreateEvent(NULL, isAutoReset?FALSE:TRUE, isSignal?TRUE:FALSE, NULL); 
+#elif defined(__linux__)
+        _signalled.store(isSignal ? 1 : 0, std::memory_order_relaxed);
+        _waiters.store(0, std::memory_order_relaxed);
 #else
+        _is_signalled = isSignal;
         pthread_mutex_init(&_cond_locker, NULL);
         pthread_cond_init(&_cond_var, NULL);
 #endif
@@ -72,6 +90,13 @@ public:
         if (isSignal){
 #ifdef _WIN32
             SetEvent(_event);
+#elif defined(__linux__)
+            if (_signalled.load(std::memory_order_relaxed) == 1) return;
+            _signalled.store(1, std::memory_order_seq_cst);
+            // pairs with the increment of _waiters in wait(): either the waiter sees the flag, or we see the waiter
+            if (_waiters.load(std::memory_order_seq_cst)) {
+                _futex(FUTEX_WAKE_PRIVATE, _isAutoReset ? 1 : INT_MAX, NULL);
+            }
 #else
             pthread_mutex_lock(&_cond_locker);
                
@@ -87,6 +112,8 @@ public:
         {
 #ifdef _WIN32
             ResetEvent(_event);
+#elif defined(__linux__)
+            _signalled.store(0, std::memory_order_relaxed);
 #else
             pthread_mutex_lock(&_cond_locker);
             _is_signalled = false;
@@ -108,48 +135,72 @@ public:
             return EVENT_TIMEOUT;
         }
         return EVENT_OK;
+#elif defined(__linux__)
+        if (_tryConsume()) return EVENT_OK;
+        if (timeout == 0) return EVENT_TIMEOUT;
+
+        _u64 deadline = (timeout == 0xFFFFFFFF) ? 0 : _monotonicNs() + (_u64)timeout * 1000000;
+        unsigned long ans = EVENT_OK;
+
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        while (!_tryConsume())
+        {
+            timespec remaining;
+            timespec* remainingPtr = NULL;
+            if (deadline)
+            {
+                _u64 now = _monotonicNs();
+                if (now >= deadline)
+                {
+                    ans = EVENT_TIMEOUT;
+                    break;
+                }
+                remaining.tv_sec = (time_t)((deadline - now) / 1000000000);
+                remaining.tv_nsec = (long)((deadline - now) % 1000000000);
+                remainingPtr = &remaining;
+            }
+
+            // returns at once with EAGAIN if set() got in before we went to sleep
+            if (_futex(FUTEX_WAIT_PRIVATE, 0, remainingPtr) == -1
+                && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+            {
+                ans = EVENT_FAILED;
+                break;
+            }
+        }
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
+        return ans;
 #else
         unsigned long ans = EVENT_OK;
         pthread_mutex_lock( &_cond_locker );
 
-        if ( !_is_signalled )
+        _u64 deadline = (timeout == 0xFFFFFFFF) ? 0 : _monotonicNs() + (_u64)timeout * 1000000;
+        while ( !_is_signalled )
         {
-            
-                if (timeout == 0xFFFFFFFF){
-                    pthread_cond_wait(&_cond_var,&_cond_locker);
-                }else
-                {
-                    timespec wait_time;
-                    timeval now;
-                    gettimeofday(&now,NULL);
-
-                    wait_time.tv_sec = timeout/1000 + now.tv_sec;
-                    wait_time.tv_nsec = (timeout%1000)*1000000ULL + now.tv_usec*1000;
-                
-                    if (wait_time.tv_nsec >= 1000000000)
-                    {
-                       ++wait_time.tv_sec;
-                       wait_time.tv_nsec -= 1000000000;
-                    }
-                    switch (pthread_cond_timedwait(&_cond_var,&_cond_locker,&wait_time))
-                    {
-                    case 0:
-                        // signalled
-                        break;
-                    case ETIMEDOUT:
-                        // time up
-                        ans = EVENT_TIMEOUT;
-                        goto _final;
-                        break;
-                    default:
-                        ans = EVENT_FAILED;
-                        goto _final;
-                    }
-       
+            if (!deadline)
+            {
+                pthread_cond_wait(&_cond_var,&_cond_locker);
+                continue;
+            }
+
+            _u64 now = _monotonicNs();
+            if (now >= deadline)
+            {
+                ans = EVENT_TIMEOUT;
+                goto _final;
+            }
+
+            // a relative wait is not affected by steps of the wall clock
+            timespec wait_time;
+            wait_time.tv_sec = (time_t)((deadline - now) / 1000000000);
+            wait_time.tv_nsec = (long)((deadline - now) % 1000000000);
+            int err = pthread_cond_timedwait_relative_np(&_cond_var, &_cond_locker, &wait_time);
+            if (err != 0 && err != ETIMEDOUT)
+            {
+                ans = EVENT_FAILED;
+                goto _final;
             }
         }
-          
-        assert(_is_signalled);
 
         if ( _isAutoReset )
         {
@@ -168,14 +219,43 @@ protected:
     {
 #ifdef _WIN32
         CloseHandle(_event);
+#elif defined(__linux__)
 #else
         pthread_mutex_destroy(&_cond_locker);
         pthread_cond_destroy(&_cond_var);
 #endif
     }
 
+#ifndef _WIN32
+    static _u64 _monotonicNs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (_u64)now.tv_sec * 1000000000 + now.tv_nsec;
+    }
+#endif
+
+#ifdef __linux__
+    bool _tryConsume()
+    {
+        if (!_isAutoReset) return _signalled.load(std::memory_order_acquire) == 1;
+        int expected = 1;
+        return _signalled.compare_exchange_strong(expected, 0, std::memory_order_seq_cst);
+    }
+
+    long _futex(int op, int value, const timespec* timeout)
+    {
+        return syscall(SYS_futex, reinterpret_cast<int*>(&_signalled), op, value, timeout, NULL, 0);
+    }
+#endif
+
 #ifdef _WIN32
         HANDLE _event;
+#elif defined(__linux__)
+        // 1 when signalled, the futex word
+        std::atomic<int>       _signalled;
+        std::atomic<int>       _waiters;
+        bool                   _isAutoReset;
 #else
         pthread_cond_t         _cond_var;
         pthread_mutex_t        _cond_locker;
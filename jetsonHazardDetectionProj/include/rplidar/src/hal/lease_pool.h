@@ -0,0 +1,142 @@
+/*
+ *  RPLIDAR SDK
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, 
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace rp{ namespace hal{
+
+/**
+ * Slot bookkeeping of a lock-free pool of reference counted buffers.
+ *
+ * One producer claims a free slot, fills it in place and publishes it as the latest data.
+ * Any number of consumers can take a reference on the latest slot and keep it as long as
+ * they need. A slot goes back to the pool once the last reference is released, the pool
+ * itself holds one reference on the latest slot until a newer one is published.
+ */
+class LeasePoolIndex
+{
+public:
+    enum
+    {
+        SLOT_COUNT   = 5,
+        INVALID_SLOT = -1,
+    };
+
+    LeasePoolIndex()
+        : _latest(INVALID_SLOT)
+    {
+        for (int i = 0; i < SLOT_COUNT; ++i) _refs[i].store(0, std::memory_order_relaxed);
+    }
+
+    /// Producer side: take a free slot for writing
+    /// \return INVALID_SLOT if every slot is still referenced
+    int claim()
+    {
+        for (int i = 0; i < SLOT_COUNT; ++i) {
+            unsigned int expected = 0;
+            if (_refs[i].compare_exchange_strong(expected, WRITING_FLAG, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return i;
+            }
+        }
+        return INVALID_SLOT;
+    }
+
+    /// Producer side: publish a claimed slot as the latest data and drop the previous one
+    void publish(int slot)
+    {
+        _refs[slot].store(1, std::memory_order_release);
+        int previous = _latest.exchange(slot, std::memory_order_acq_rel);
+        if (previous != INVALID_SLOT) release(previous);
+    }
+
+    /// Consumer side: take a reference on the latest published slot
+    /// \return INVALID_SLOT if nothing has been published yet
+    int acquireLatest()
+    {
+        for (;;) {
+            int slot = _latest.load(std::memory_order_acquire);
+            if (slot == INVALID_SLOT) return INVALID_SLOT;
+
+            unsigned int refs = _refs[slot].load(std::memory_order_relaxed);
+            while (refs != 0 && !(refs & WRITING_FLAG)) {
+                if (_refs[slot].compare_exchange_weak(refs, refs + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return slot;
+                }
+            }
+            // the slot has been recycled meanwhile, a newer one is about to be published
+        }
+    }
+
+    /// Producer side: withdraw the latest slot and check that no consumer still holds a reference
+    /// \param writingSlot   The slot claimed by the producer, it is left untouched
+    /// \return false if a slot is still leased, the slot buffers must not be moved then
+    bool reset(int writingSlot)
+    {
+        int previous = _latest.exchange(INVALID_SLOT, std::memory_order_acq_rel);
+        if (previous != INVALID_SLOT) release(previous);
+
+        // nothing new can be acquired now, a consumer racing with the exchange either got its
+        // reference in before the release above or gives up once it sees the slot recycled
+        bool idle = true;
+        for (int i = 0; i < SLOT_COUNT; ++i) {
+            if (i != writingSlot && _refs[i].load(std::memory_order_acquire) != 0) idle = false;
+        }
+        return idle;
+    }
+
+    /// Add a reference to a slot which is already referenced by the caller
+    void retain(int slot)
+    {
+        _refs[slot].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Drop a reference, the slot can be claimed again once nobody refers to it
+    void release(int slot)
+    {
+        _refs[slot].fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+protected:
+    enum
+    {
+        WRITING_FLAG = 0x80000000,
+    };
+
+    std::atomic<unsigned int> _refs[SLOT_COUNT];
+    std::atomic<int>          _latest;
+};
+
+}}
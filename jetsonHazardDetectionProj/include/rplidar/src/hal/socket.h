@@ -123,6 +123,25 @@ public:
     
     virtual u_result enableNoDelay(bool enable = true) = 0;
 
+    // receive what is already queued without waiting, recv_len is 0 if nothing is. Fails once the peer closed.
+    virtual u_result recvNoWait(void *buf, size_t len, size_t & recv_len)
+    {
+        recv_len = 0;
+        if (waitforData(0) != RESULT_OK) return RESULT_OK;
+        u_result ans = recv(buf, len, recv_len);
+        if (IS_OK(ans) && !recv_len) return RESULT_OPERATION_FAIL;
+        return ans;
+    }
+
+    // size of the system receive buffer, 0 keeps the system default
+    virtual u_result setReceiveBufferSize(size_t size) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // busy-poll the device queue for up to microseconds in receives and waits instead of sleeping, 0 to disable
+    virtual u_result setBusyPoll(_u32 microseconds) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // handle usable with select/poll/epoll, -1 if the socket cannot be polled
+    virtual int getPollHandle() { return -1; }
+
 protected:
     virtual ~StreamSocket() {} // use dispose();
     StreamSocket() {}
@@ -141,7 +160,27 @@ public:
    
     virtual u_result recvFrom(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr = NULL) = 0;
 
-    
+    // receive the datagrams already queued without waiting, at most count of them and one per buffer.
+    // recv_lens receives their sizes, the ones longer than buffer_size are cut and counted in truncated
+    // where the platform can tell.
+    virtual u_result recvBatch(void * const * buffers, size_t buffer_size, size_t count, size_t * recv_lens, size_t & received, size_t & truncated)
+    {
+        received = 0;
+        truncated = 0;
+        while (received < count && waitforData(0) == RESULT_OK) {
+            u_result ans = recvFrom(buffers[received], buffer_size, recv_lens[received]);
+            if (IS_FAIL(ans)) return received ? RESULT_OK : ans;
+            ++received;
+        }
+        return RESULT_OK;
+    }
+
+    // datagrams the system dropped for this socket because its receive buffer was full
+    virtual u_result getDropCount(_u32 & dropped) { dropped = 0; return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // handle usable with select/poll/epoll, -1 if the socket cannot be polled
+    virtual int getPollHandle() { return -1; }
+
 protected:
     virtual ~DGramSocket() {} // use dispose();
 
@@ -0,0 +1,183 @@
+/*
+ *  RPLIDAR SDK
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR 
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR 
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, 
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "hal/types.h"
+#include <atomic>
+#include <algorithm>
+#include <stddef.h>
+
+namespace rp{ namespace hal{
+
+/**
+ * Wait-free single producer / single consumer ring of items.
+ *
+ * The storage is provided by the owner through attach(), its capacity must be a power of two.
+ * When the ring is full, push() drops the new item instead of overwriting unread data. Dropped
+ * items are counted, and so are overflow episodes (runs of consecutive drops). Only the producer
+ * thread may call push() and only the consumer thread may call pop(). attach() and clear() need
+ * both sides to be idle, and push() must not be called before the ring has been attached.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    SpscRing()
+        : _buffer(NULL)
+        , _mask(0)
+        , _cachedTail(0)
+        , _overflowing(false)
+        , _cachedHead(0)
+    {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+        _dropped.store(0, std::memory_order_relaxed);
+        _overflows.store(0, std::memory_order_relaxed);
+    }
+
+    /// Smallest valid capacity able to hold count items
+    static size_t roundCapacity(size_t count)
+    {
+        size_t rounded = 1;
+        while (rounded < count) rounded <<= 1;
+        return rounded;
+    }
+
+    /// Move the ring to new storage, any buffered item is discarded
+    void attach(T* storage, size_t capacity)
+    {
+        _buffer = storage;
+        _mask = storage ? roundCapacity(capacity) - 1 : 0;
+        clear();
+    }
+
+    size_t capacity() const
+    {
+        return _buffer ? _mask + 1 : 0;
+    }
+
+    /// Number of items waiting to be popped
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    void clear()
+    {
+        _tail.store(_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _cachedTail = _cachedHead = _head.load(std::memory_order_relaxed);
+        _overflowing = false;
+    }
+
+    /// Producer side: append one item
+    /// \return false if the ring is full and the item has been dropped
+    bool push(const T& item)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cachedTail > _mask) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head - _cachedTail > _mask) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                if (!_overflowing) {
+                    _overflowing = true;
+                    _overflows.fetch_add(1, std::memory_order_relaxed);
+                }
+                return false;
+            }
+        }
+        _overflowing = false;
+        _buffer[head & _mask] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side: move up to maxCount items into dest
+    /// \return the number of items popped
+    size_t pop(T* dest, size_t maxCount)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (_cachedHead == tail) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+        }
+        size_t count = std::min(_cachedHead - tail, maxCount);
+        if (!count) return 0;
+
+        size_t first = tail & _mask;
+        size_t firstCount = std::min(count, capacity() - first);
+        std::copy(_buffer + first, _buffer + first + firstCount, dest);
+        std::copy(_buffer, _buffer + (count - firstCount), dest + firstCount);
+
+        _tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /// Total number of items dropped because the ring was full
+    _u64 droppedCount() const
+    {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    /// Number of times the ring ran full, consecutive drops count once
+    _u64 overflowCount() const
+    {
+        return _overflows.load(std::memory_order_relaxed);
+    }
+
+protected:
+    enum
+    {
+        CACHE_LINE_SIZE = 64,
+    };
+
+    T*                  _buffer;
+    size_t              _mask;
+
+    // written by the producer only
+    char                _producerPad[CACHE_LINE_SIZE];
+    std::atomic<size_t> _head;
+    size_t              _cachedTail;
+    bool                _overflowing;
+
+    // written by the consumer only
+    char                _consumerPad[CACHE_LINE_SIZE];
+    std::atomic<size_t> _tail;
+    size_t              _cachedHead;
+
+    char                _counterPad[CACHE_LINE_SIZE];
+    std::atomic<_u64>   _dropped;
+    std::atomic<_u64>   _overflows;
+};
+
+}}
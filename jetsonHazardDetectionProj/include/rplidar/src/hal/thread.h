@@ -71,10 +71,17 @@ public:
     _word_size_t getHandle(){ return _handle;}
     u_result terminate();
     void *getData() { return _data;}
+    // the handle is cleared once the thread has been joined, RESULT_OPERATION_TIMEOUT leaves it running
     u_result join(unsigned long timeout = -1);
 	u_result setPriority( priority_val_t p);
 	priority_val_t getPriority();
 
+    // bit n of cpuMask allows the thread on CPU n
+    u_result setAffinity(_u64 cpuMask);
+
+    // shown by top / ps and debuggers, truncated to 15 characters on Linux
+    u_result setName(const char* name);
+
     bool operator== ( const Thread & right) { return this->_handle == right._handle; }
 protected:
     Thread( thread_proc_t proc, void * data ): _data(data),_func(proc), _handle(0)  {}
@@ -0,0 +1,1027 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_capsule_decoder.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SL_DECODER_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SL_DECODER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl { namespace decoder {
+
+    enum
+    {
+        CIRCLE_Q16 = (360 << 16),
+        CIRCLE_Q6  = (360 << 6),
+
+        CAPSULE_SAMPLES       = 32,
+        DENSE_CAPSULE_SAMPLES = 40,
+        ULTRA_CABINS          = 32,
+        ULTRA_CAPSULE_SAMPLES = ULTRA_CABINS * 3,
+
+        // ultra capsule angle offsets are looked up by k2 = 98361 / dist_q2, which is below 492 for dist_q2 >= 200
+        ULTRA_OFFSET_DEFAULT_SLOT = 492,
+        ULTRA_OFFSET_SLOTS        = 493,
+    };
+
+    // per-sample angle stage shared by all capsule types
+    typedef void (*AngleKernel)(int startAngle_q16, int angleInc_q16, int syncWindow_q16, const int* offset_q16, size_t count, int* angle_z_q14, int* syncBit);
+
+    // unpacks the 32 cabins of an ultra capsule into distances and angle offset slots, one row per sample of a cabin
+    // combined holds the cabins followed by the first cabin of the next capsule
+    typedef void (*UltraKernel)(const sl_u32* combined, int dist_q2[3][ULTRA_CABINS], int offsetSlot[3][ULTRA_CABINS]);
+
+    struct DecoderKernels
+    {
+        AngleKernel angles;
+        UltraKernel ultra;
+    };
+
+    //
+    // Scalar reference decoders
+    //
+
+    static sl_u32 varbitscaleDecodeScalar(sl_u32 scaled, sl_u32 & scaleLevel)
+    {
+        static const sl_u32 VBS_SCALED_BASE[] = {
+            SL_LIDAR_VARBITSCALE_X16_DEST_VAL,
+            SL_LIDAR_VARBITSCALE_X8_DEST_VAL,
+            SL_LIDAR_VARBITSCALE_X4_DEST_VAL,
+            SL_LIDAR_VARBITSCALE_X2_DEST_VAL,
+            0,
+        };
+
+        static const sl_u32 VBS_SCALED_LVL[] = {
+            4,
+            3,
+            2,
+            1,
+            0,
+        };
+
+        static const sl_u32 VBS_TARGET_BASE[] = {
+            (0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT),
+            (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT),
+            (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT),
+            (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT),
+            0,
+        };
+
+        for (size_t i = 0; i < _countof(VBS_SCALED_BASE); ++i) {
+            int remain = ((int)scaled - (int)VBS_SCALED_BASE[i]);
+            if (remain >= 0) {
+                scaleLevel = VBS_SCALED_LVL[i];
+                return VBS_TARGET_BASE[i] + (remain << scaleLevel);
+            }
+        }
+        return 0;
+    }
+
+    static size_t capsuleToNormalScalar(const sl_lidar_response_capsule_measurement_nodes_t& prev, const sl_lidar_response_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        size_t nodeCount = 0;
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((prev.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 3);
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        for (size_t pos = 0; pos < _countof(prev.cabins); ++pos) {
+            int dist_q2[2];
+            int angle_q6[2];
+            int syncBit[2];
+
+            dist_q2[0] = (prev.cabins[pos].distance_angle_1 & 0xFFFC);
+            dist_q2[1] = (prev.cabins[pos].distance_angle_2 & 0xFFFC);
+
+            int angle_offset1_q3 = ((prev.cabins[pos].offset_angles_q3 & 0xF) | ((prev.cabins[pos].distance_angle_1 & 0x3) << 4));
+            int angle_offset2_q3 = ((prev.cabins[pos].offset_angles_q3 >> 4) | ((prev.cabins[pos].distance_angle_2 & 0x3) << 4));
+
+            angle_q6[0] = ((currentAngle_raw_q16 - (angle_offset1_q3 << 13)) >> 10);
+            syncBit[0] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+            currentAngle_raw_q16 += angleInc_q16;
+
+
+            angle_q6[1] = ((currentAngle_raw_q16 - (angle_offset2_q3 << 13)) >> 10);
+            syncBit[1] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+            currentAngle_raw_q16 += angleInc_q16;
+
+            for (int cpos = 0; cpos < 2; ++cpos) {
+
+                if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
+                if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
+
+                sl_lidar_response_measurement_node_hq_t node;
+
+                node.angle_z_q14 = sl_u16((angle_q6[cpos] << 8) / 90);
+                node.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
+                node.quality = dist_q2[cpos] ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+                node.dist_mm_q2 = dist_q2[cpos];
+
+                nodebuffer[nodeCount++] = node;
+            }
+        }
+        return nodeCount;
+    }
+
+    static size_t denseCapsuleToNormalScalar(const sl_lidar_response_dense_capsule_measurement_nodes_t& prev, const sl_lidar_response_dense_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer, int& lastNodeSyncBit, bool& synced)
+    {
+        size_t nodeCount = 0;
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((prev.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 8) / 40;
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        for (size_t pos = 0; pos < _countof(prev.cabins); ++pos) {
+            int dist_q2;
+            int angle_q6;
+            int syncBit;
+            const int dist = static_cast<const int>(prev.cabins[pos].distance);
+            dist_q2 = dist << 2;
+            angle_q6 = (currentAngle_raw_q16 >> 10);
+
+            syncBit = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < (angleInc_q16<<1)) ? 1 : 0;
+            syncBit = (syncBit^ lastNodeSyncBit)&syncBit;//Ensure that syncBit is exactly detected
+            if (syncBit) {
+                synced = true;
+            }
+
+            currentAngle_raw_q16 += angleInc_q16;
+
+            if (angle_q6 < 0) angle_q6 += (360 << 6);
+            if (angle_q6 >= (360 << 6)) angle_q6 -= (360 << 6);
+
+            sl_lidar_response_measurement_node_hq_t node;
+
+            node.angle_z_q14 = sl_u16((angle_q6 << 8) / 90);
+            node.flag = (syncBit | ((!syncBit) << 1));
+            node.quality = dist_q2 ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+            node.dist_mm_q2 = dist_q2;
+            if (synced)
+                nodebuffer[nodeCount++] = node;
+            lastNodeSyncBit = syncBit;
+        }
+        return nodeCount;
+    }
+
+    static size_t ultraCapsuleToNormalScalar(const sl_lidar_response_ultra_capsule_measurement_nodes_t& prev, const sl_lidar_response_ultra_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        size_t nodeCount = 0;
+        int diffAngle_q8;
+        int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((prev.start_angle_sync_q6 & 0x7FFF) << 2);
+
+        diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+
+        int angleInc_q16 = (diffAngle_q8 << 3) / 3;
+        int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        for (size_t pos = 0; pos < _countof(prev.ultra_cabins); ++pos) {
+            int dist_q2[3];
+            int angle_q6[3];
+            int syncBit[3];
+
+
+            sl_u32 combined_x3 = prev.ultra_cabins[pos].combined_x3;
+
+            // unpack ...
+            int dist_major = (combined_x3 & 0xFFF);
+
+            // signed partical integer, using the magic shift here
+            // DO NOT TOUCH
+
+            int dist_predict1 = (((int)(combined_x3 << 10)) >> 22);
+            int dist_predict2 = (((int)combined_x3) >> 22);
+
+            int dist_major2;
+
+            sl_u32 scalelvl1, scalelvl2;
+
+            // prefetch next ...
+            if (pos == _countof(prev.ultra_cabins) - 1) {
+                dist_major2 = (capsule.ultra_cabins[0].combined_x3 & 0xFFF);
+            }
+            else {
+                dist_major2 = (prev.ultra_cabins[pos + 1].combined_x3 & 0xFFF);
+            }
+
+            // decode with the var bit scale ...
+            dist_major = varbitscaleDecodeScalar(dist_major, scalelvl1);
+            dist_major2 = varbitscaleDecodeScalar(dist_major2, scalelvl2);
+
+
+            int dist_base1 = dist_major;
+            int dist_base2 = dist_major2;
+
+            if ((!dist_major) && dist_major2) {
+                dist_base1 = dist_major2;
+                scalelvl1 = scalelvl2;
+            }
+
+
+            dist_q2[0] = (dist_major << 2);
+            if ((dist_predict1 == 0xFFFFFE00) || (dist_predict1 == 0x1FF)) {
+                dist_q2[1] = 0;
+            }
+            else {
+                dist_predict1 = (dist_predict1 << scalelvl1);
+                dist_q2[1] = (dist_predict1 + dist_base1) << 2;
+
+            }
+
+            if ((dist_predict2 == 0xFFFFFE00) || (dist_predict2 == 0x1FF)) {
+                dist_q2[2] = 0;
+            }
+            else {
+                dist_predict2 = (dist_predict2 << scalelvl2);
+                dist_q2[2] = (dist_predict2 + dist_base2) << 2;
+            }
+
+
+            for (int cpos = 0; cpos < 3; ++cpos) {
+                syncBit[cpos] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
+
+                int offsetAngleMean_q16 = (int)(7.5 * 3.1415926535 * (1 << 16) / 180.0);
+
+                if (dist_q2[cpos] >= (50 * 4))
+                {
+                    const int k1 = 98361;
+                    const int k2 = int(k1 / dist_q2[cpos]);
+
+                    offsetAngleMean_q16 = (int)(8 * 3.1415926535 * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
+                }
+
+                angle_q6[cpos] = ((currentAngle_raw_q16 - int(offsetAngleMean_q16 * 180 / 3.14159265)) >> 10);
+                currentAngle_raw_q16 += angleInc_q16;
+
+                if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
+                if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
+
+                sl_lidar_response_measurement_node_hq_t node;
+
+                node.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
+                node.quality = dist_q2[cpos] ? (0x2F << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+                node.angle_z_q14 = sl_u16((angle_q6[cpos] << 8) / 90);
+                node.dist_mm_q2 = dist_q2[cpos];
+
+                nodebuffer[nodeCount++] = node;
+            }
+        }
+        return nodeCount;
+    }
+
+    //
+    // Vectorized decoders, split into an unpack stage, the angle kernel and the node packing
+    //
+
+    struct UltraOffsetTable
+    {
+        int offset_q16[ULTRA_OFFSET_SLOTS];
+
+        UltraOffsetTable()
+        {
+            // the exact expressions of the scalar decoder, evaluated once per possible k2
+            for (int k2 = 0; k2 < ULTRA_OFFSET_DEFAULT_SLOT; ++k2) {
+                int offsetAngleMean_q16 = (int)(8 * 3.1415926535 * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
+                offset_q16[k2] = int(offsetAngleMean_q16 * 180 / 3.14159265);
+            }
+            int offsetAngleMean_q16 = (int)(7.5 * 3.1415926535 * (1 << 16) / 180.0);
+            offset_q16[ULTRA_OFFSET_DEFAULT_SLOT] = int(offsetAngleMean_q16 * 180 / 3.14159265);
+        }
+    };
+
+    static const UltraOffsetTable g_ultraOffsets;
+
+    static inline void angleScalar(int raw_q16, int angleInc_q16, int syncWindow_q16, int offset_q16, int& angle_z_q14, int& syncBit)
+    {
+        syncBit = (((raw_q16 + angleInc_q16) % CIRCLE_Q16) < syncWindow_q16) ? 1 : 0;
+
+        int angle_q6 = ((raw_q16 - offset_q16) >> 10);
+        if (angle_q6 < 0) angle_q6 += CIRCLE_Q6;
+        if (angle_q6 >= CIRCLE_Q6) angle_q6 -= CIRCLE_Q6;
+        angle_z_q14 = (angle_q6 << 8) / 90;
+    }
+
+    static void anglesTail(int startAngle_q16, int angleInc_q16, int syncWindow_q16, const int* offset_q16, size_t pos, size_t count, int* angle_z_q14, int* syncBit)
+    {
+        for (; pos < count; ++pos) {
+            angleScalar(startAngle_q16 + (int)pos * angleInc_q16, angleInc_q16, syncWindow_q16, offset_q16[pos], angle_z_q14[pos], syncBit[pos]);
+        }
+    }
+
+    static inline bool startAnglesInRange(sl_u16 prevStartAngle_q6, sl_u16 currentStartAngle_q6)
+    {
+        // keeps every intermediate of the angle stage within the bounds the kernels rely on:
+        // raw + inc stays below three full circles and the q14 angle stays exact in single precision
+        return (prevStartAngle_q6 & 0x7FFF) < CIRCLE_Q6 && (currentStartAngle_q6 & 0x7FFF) < CIRCLE_Q6;
+    }
+
+    static inline int startAngleInc_q8(sl_u16 prevStartAngle_q6, sl_u16 currentStartAngle_q6)
+    {
+        int currentStartAngle_q8 = ((currentStartAngle_q6 & 0x7FFF) << 2);
+        int prevStartAngle_q8 = ((prevStartAngle_q6 & 0x7FFF) << 2);
+
+        int diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
+        if (prevStartAngle_q8 > currentStartAngle_q8) {
+            diffAngle_q8 += (360 << 8);
+        }
+        return diffAngle_q8;
+    }
+
+    static size_t packNodes(const int* angle_z_q14, const int* syncBit, const int* dist_q2, size_t count, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            sl_lidar_response_measurement_node_hq_t & node = nodebuffer[pos];
+            node.angle_z_q14 = sl_u16(angle_z_q14[pos]);
+            node.flag = (syncBit[pos] | ((!syncBit[pos]) << 1));
+            node.quality = dist_q2[pos] ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+            node.dist_mm_q2 = dist_q2[pos];
+        }
+        return count;
+    }
+
+    static size_t capsuleToNormalVector(const DecoderKernels& kernels, const sl_lidar_response_capsule_measurement_nodes_t& prev, const sl_lidar_response_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        int dist_q2[CAPSULE_SAMPLES];
+        int offset_q16[CAPSULE_SAMPLES];
+        int angle_z_q14[CAPSULE_SAMPLES];
+        int syncBit[CAPSULE_SAMPLES];
+
+        int angleInc_q16 = (startAngleInc_q8(prev.start_angle_sync_q6, capsule.start_angle_sync_q6) << 3);
+        int startAngle_q16 = ((prev.start_angle_sync_q6 & 0x7FFF) << 10);
+
+        for (size_t pos = 0; pos < _countof(prev.cabins); ++pos) {
+            const sl_lidar_response_cabin_nodes_t & cabin = prev.cabins[pos];
+            dist_q2[2 * pos] = (cabin.distance_angle_1 & 0xFFFC);
+            dist_q2[2 * pos + 1] = (cabin.distance_angle_2 & 0xFFFC);
+            offset_q16[2 * pos] = ((cabin.offset_angles_q3 & 0xF) | ((cabin.distance_angle_1 & 0x3) << 4)) << 13;
+            offset_q16[2 * pos + 1] = ((cabin.offset_angles_q3 >> 4) | ((cabin.distance_angle_2 & 0x3) << 4)) << 13;
+        }
+
+        kernels.angles(startAngle_q16, angleInc_q16, angleInc_q16, offset_q16, CAPSULE_SAMPLES, angle_z_q14, syncBit);
+        return packNodes(angle_z_q14, syncBit, dist_q2, CAPSULE_SAMPLES, nodebuffer);
+    }
+
+    static size_t denseCapsuleToNormalVector(const DecoderKernels& kernels, const sl_lidar_response_dense_capsule_measurement_nodes_t& prev, const sl_lidar_response_dense_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer, int& lastNodeSyncBit, bool& synced)
+    {
+        static const int zero_offset_q16[DENSE_CAPSULE_SAMPLES] = { 0 };
+        int angle_z_q14[DENSE_CAPSULE_SAMPLES];
+        int syncBit[DENSE_CAPSULE_SAMPLES];
+
+        int angleInc_q16 = (startAngleInc_q8(prev.start_angle_sync_q6, capsule.start_angle_sync_q6) << 8) / 40;
+        int startAngle_q16 = ((prev.start_angle_sync_q6 & 0x7FFF) << 10);
+
+        kernels.angles(startAngle_q16, angleInc_q16, angleInc_q16 << 1, zero_offset_q16, DENSE_CAPSULE_SAMPLES, angle_z_q14, syncBit);
+
+        // a sync is only taken on its first sample, which chains the samples and stays scalar
+        size_t nodeCount = 0;
+        for (size_t pos = 0; pos < DENSE_CAPSULE_SAMPLES; ++pos) {
+            int sync = (syncBit[pos] ^ lastNodeSyncBit) & syncBit[pos];
+            if (sync) {
+                synced = true;
+            }
+            if (synced) {
+                int dist_q2 = static_cast<int>(prev.cabins[pos].distance) << 2;
+                sl_lidar_response_measurement_node_hq_t & node = nodebuffer[nodeCount++];
+                node.angle_z_q14 = sl_u16(angle_z_q14[pos]);
+                node.flag = (sync | ((!sync) << 1));
+                node.quality = dist_q2 ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+                node.dist_mm_q2 = dist_q2;
+            }
+            lastNodeSyncBit = sync;
+        }
+        return nodeCount;
+    }
+
+    static size_t ultraCapsuleToNormalVector(const DecoderKernels& kernels, const sl_lidar_response_ultra_capsule_measurement_nodes_t& prev, const sl_lidar_response_ultra_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        // room for the vector loads reading one cabin ahead
+        sl_u32 combined[ULTRA_CABINS + 4];
+        int planar_dist_q2[3][ULTRA_CABINS];
+        int planar_slot[3][ULTRA_CABINS];
+        int dist_q2[ULTRA_CAPSULE_SAMPLES];
+        int offset_q16[ULTRA_CAPSULE_SAMPLES];
+        int angle_z_q14[ULTRA_CAPSULE_SAMPLES];
+        int syncBit[ULTRA_CAPSULE_SAMPLES];
+
+        for (size_t pos = 0; pos < ULTRA_CABINS; ++pos) {
+            combined[pos] = prev.ultra_cabins[pos].combined_x3;
+        }
+        combined[ULTRA_CABINS] = capsule.ultra_cabins[0].combined_x3;
+        combined[ULTRA_CABINS + 1] = combined[ULTRA_CABINS + 2] = combined[ULTRA_CABINS + 3] = 0;
+
+        kernels.ultra(combined, planar_dist_q2, planar_slot);
+
+        for (size_t pos = 0; pos < ULTRA_CABINS; ++pos) {
+            for (size_t cpos = 0; cpos < 3; ++cpos) {
+                dist_q2[pos * 3 + cpos] = planar_dist_q2[cpos][pos];
+                offset_q16[pos * 3 + cpos] = g_ultraOffsets.offset_q16[planar_slot[cpos][pos]];
+            }
+        }
+
+        int angleInc_q16 = (startAngleInc_q8(prev.start_angle_sync_q6, capsule.start_angle_sync_q6) << 3) / 3;
+        int startAngle_q16 = ((prev.start_angle_sync_q6 & 0x7FFF) << 10);
+
+        kernels.angles(startAngle_q16, angleInc_q16, angleInc_q16, offset_q16, ULTRA_CAPSULE_SAMPLES, angle_z_q14, syncBit);
+        return packNodes(angle_z_q14, syncBit, dist_q2, ULTRA_CAPSULE_SAMPLES, nodebuffer);
+    }
+
+#ifdef SL_DECODER_X86
+    //
+    // SSE4.1
+    //
+
+    __attribute__((target("sse4.1")))
+    static void anglesSse41(int startAngle_q16, int angleInc_q16, int syncWindow_q16, const int* offset_q16, size_t count, int* angle_z_q14, int* syncBit)
+    {
+        const __m128i circle_q16 = _mm_set1_epi32(CIRCLE_Q16);
+        const __m128i circle_q16_max = _mm_set1_epi32(CIRCLE_Q16 - 1);
+        const __m128i circle_q6 = _mm_set1_epi32(CIRCLE_Q6);
+        const __m128i circle_q6_max = _mm_set1_epi32(CIRCLE_Q6 - 1);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i inc = _mm_set1_epi32(angleInc_q16);
+        const __m128i window = _mm_set1_epi32(syncWindow_q16);
+        const __m128i step = _mm_set1_epi32(angleInc_q16 * 4);
+        const __m128 divisor = _mm_set1_ps(90.f);
+
+        __m128i raw = _mm_add_epi32(_mm_set1_epi32(startAngle_q16), _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), inc));
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            __m128i wrapped = _mm_add_epi32(raw, inc);
+            for (int i = 0; i < 3; ++i) {
+                wrapped = _mm_sub_epi32(wrapped, _mm_and_si128(_mm_cmpgt_epi32(wrapped, circle_q16_max), circle_q16));
+            }
+            __m128i sync = _mm_and_si128(_mm_cmplt_epi32(wrapped, window), one);
+
+            __m128i angle_q6 = _mm_srai_epi32(_mm_sub_epi32(raw, _mm_loadu_si128((const __m128i*)(offset_q16 + pos))), 10);
+            angle_q6 = _mm_add_epi32(angle_q6, _mm_and_si128(_mm_cmplt_epi32(angle_q6, zero), circle_q6));
+            angle_q6 = _mm_sub_epi32(angle_q6, _mm_and_si128(_mm_cmpgt_epi32(angle_q6, circle_q6_max), circle_q6));
+
+            __m128i angle_z = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_slli_epi32(angle_q6, 8)), divisor));
+
+            _mm_storeu_si128((__m128i*)(angle_z_q14 + pos), angle_z);
+            _mm_storeu_si128((__m128i*)(syncBit + pos), sync);
+            raw = _mm_add_epi32(raw, step);
+        }
+        anglesTail(startAngle_q16, angleInc_q16, syncWindow_q16, offset_q16, pos, count, angle_z_q14, syncBit);
+    }
+
+    __attribute__((target("sse4.1")))
+    static inline __m128i varbitscaleDecodeSse41(__m128i scaled, __m128i& scale)
+    {
+        const __m128i x2 = _mm_cmpgt_epi32(scaled, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL - 1));
+        const __m128i x4 = _mm_cmpgt_epi32(scaled, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL - 1));
+        const __m128i x8 = _mm_cmpgt_epi32(scaled, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL - 1));
+        const __m128i x16 = _mm_cmpgt_epi32(scaled, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL - 1));
+
+        __m128i base = _mm_and_si128(x2, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL));
+        base = _mm_add_epi32(base, _mm_and_si128(x4, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL - SL_LIDAR_VARBITSCALE_X2_DEST_VAL)));
+        base = _mm_add_epi32(base, _mm_and_si128(x8, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL - SL_LIDAR_VARBITSCALE_X4_DEST_VAL)));
+        base = _mm_add_epi32(base, _mm_and_si128(x16, _mm_set1_epi32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL - SL_LIDAR_VARBITSCALE_X8_DEST_VAL)));
+
+        __m128i target = _mm_and_si128(x2, _mm_set1_epi32(0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT));
+        target = _mm_add_epi32(target, _mm_and_si128(x4, _mm_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT))));
+        target = _mm_add_epi32(target, _mm_and_si128(x8, _mm_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT))));
+        target = _mm_add_epi32(target, _mm_and_si128(x16, _mm_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT))));
+
+        // 1 << scale level, kept as a factor as SSE has no per-lane shift
+        scale = _mm_set1_epi32(1);
+        scale = _mm_add_epi32(scale, _mm_and_si128(x2, _mm_set1_epi32(1)));
+        scale = _mm_add_epi32(scale, _mm_and_si128(x4, _mm_set1_epi32(2)));
+        scale = _mm_add_epi32(scale, _mm_and_si128(x8, _mm_set1_epi32(4)));
+        scale = _mm_add_epi32(scale, _mm_and_si128(x16, _mm_set1_epi32(8)));
+
+        return _mm_add_epi32(target, _mm_mullo_epi32(_mm_sub_epi32(scaled, base), scale));
+    }
+
+    __attribute__((target("sse4.1")))
+    static inline __m128i ultraOffsetSlotSse41(__m128i dist_q2)
+    {
+        const __m128i valid = _mm_cmpgt_epi32(dist_q2, _mm_set1_epi32(50 * 4 - 1));
+        const __m128i k2 = _mm_cvttps_epi32(_mm_div_ps(_mm_set1_ps(98361.f), _mm_cvtepi32_ps(dist_q2)));
+        return _mm_blendv_epi8(_mm_set1_epi32(ULTRA_OFFSET_DEFAULT_SLOT), k2, valid);
+    }
+
+    __attribute__((target("sse4.1")))
+    static void ultraSse41(const sl_u32* combined, int dist_q2[3][ULTRA_CABINS], int offsetSlot[3][ULTRA_CABINS])
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i major_mask = _mm_set1_epi32(0xFFF);
+        const __m128i predict_min = _mm_set1_epi32(-512);
+        const __m128i predict_max = _mm_set1_epi32(0x1FF);
+
+        for (size_t pos = 0; pos < ULTRA_CABINS; pos += 4) {
+            const __m128i combined_x3 = _mm_loadu_si128((const __m128i*)(combined + pos));
+            const __m128i next_x3 = _mm_loadu_si128((const __m128i*)(combined + pos + 1));
+
+            __m128i predict1 = _mm_srai_epi32(_mm_slli_epi32(combined_x3, 10), 22);
+            __m128i predict2 = _mm_srai_epi32(combined_x3, 22);
+
+            __m128i scale1, scale2;
+            __m128i major = varbitscaleDecodeSse41(_mm_and_si128(combined_x3, major_mask), scale1);
+            __m128i major2 = varbitscaleDecodeSse41(_mm_and_si128(next_x3, major_mask), scale2);
+
+            // a missing major distance is predicted from the next cabin
+            __m128i use_next = _mm_andnot_si128(_mm_cmpeq_epi32(major2, zero), _mm_cmpeq_epi32(major, zero));
+            __m128i base1 = _mm_blendv_epi8(major, major2, use_next);
+            scale1 = _mm_blendv_epi8(scale1, scale2, use_next);
+
+            __m128i invalid1 = _mm_or_si128(_mm_cmpeq_epi32(predict1, predict_min), _mm_cmpeq_epi32(predict1, predict_max));
+            __m128i invalid2 = _mm_or_si128(_mm_cmpeq_epi32(predict2, predict_min), _mm_cmpeq_epi32(predict2, predict_max));
+
+            __m128i dist0 = _mm_slli_epi32(major, 2);
+            __m128i dist1 = _mm_andnot_si128(invalid1, _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(predict1, scale1), base1), 2));
+            __m128i dist2 = _mm_andnot_si128(invalid2, _mm_slli_epi32(_mm_add_epi32(_mm_mullo_epi32(predict2, scale2), major2), 2));
+
+            _mm_storeu_si128((__m128i*)(dist_q2[0] + pos), dist0);
+            _mm_storeu_si128((__m128i*)(dist_q2[1] + pos), dist1);
+            _mm_storeu_si128((__m128i*)(dist_q2[2] + pos), dist2);
+            _mm_storeu_si128((__m128i*)(offsetSlot[0] + pos), ultraOffsetSlotSse41(dist0));
+            _mm_storeu_si128((__m128i*)(offsetSlot[1] + pos), ultraOffsetSlotSse41(dist1));
+            _mm_storeu_si128((__m128i*)(offsetSlot[2] + pos), ultraOffsetSlotSse41(dist2));
+        }
+    }
+
+    //
+    // AVX2
+    //
+
+    __attribute__((target("avx2")))
+    static void anglesAvx2(int startAngle_q16, int angleInc_q16, int syncWindow_q16, const int* offset_q16, size_t count, int* angle_z_q14, int* syncBit)
+    {
+        const __m256i circle_q16 = _mm256_set1_epi32(CIRCLE_Q16);
+        const __m256i circle_q16_max = _mm256_set1_epi32(CIRCLE_Q16 - 1);
+        const __m256i circle_q6 = _mm256_set1_epi32(CIRCLE_Q6);
+        const __m256i circle_q6_max = _mm256_set1_epi32(CIRCLE_Q6 - 1);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i inc = _mm256_set1_epi32(angleInc_q16);
+        const __m256i window = _mm256_set1_epi32(syncWindow_q16);
+        const __m256i step = _mm256_set1_epi32(angleInc_q16 * 8);
+        const __m256 divisor = _mm256_set1_ps(90.f);
+
+        __m256i raw = _mm256_add_epi32(_mm256_set1_epi32(startAngle_q16), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), inc));
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            __m256i wrapped = _mm256_add_epi32(raw, inc);
+            for (int i = 0; i < 3; ++i) {
+                wrapped = _mm256_sub_epi32(wrapped, _mm256_and_si256(_mm256_cmpgt_epi32(wrapped, circle_q16_max), circle_q16));
+            }
+            __m256i sync = _mm256_and_si256(_mm256_cmpgt_epi32(window, wrapped), one);
+
+            __m256i angle_q6 = _mm256_srai_epi32(_mm256_sub_epi32(raw, _mm256_loadu_si256((const __m256i*)(offset_q16 + pos))), 10);
+            angle_q6 = _mm256_add_epi32(angle_q6, _mm256_and_si256(_mm256_cmpgt_epi32(zero, angle_q6), circle_q6));
+            angle_q6 = _mm256_sub_epi32(angle_q6, _mm256_and_si256(_mm256_cmpgt_epi32(angle_q6, circle_q6_max), circle_q6));
+
+            __m256i angle_z = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_slli_epi32(angle_q6, 8)), divisor));
+
+            _mm256_storeu_si256((__m256i*)(angle_z_q14 + pos), angle_z);
+            _mm256_storeu_si256((__m256i*)(syncBit + pos), sync);
+            raw = _mm256_add_epi32(raw, step);
+        }
+        anglesTail(startAngle_q16, angleInc_q16, syncWindow_q16, offset_q16, pos, count, angle_z_q14, syncBit);
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i varbitscaleDecodeAvx2(__m256i scaled, __m256i& scaleLevel)
+    {
+        const __m256i x2 = _mm256_cmpgt_epi32(scaled, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL - 1));
+        const __m256i x4 = _mm256_cmpgt_epi32(scaled, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL - 1));
+        const __m256i x8 = _mm256_cmpgt_epi32(scaled, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL - 1));
+        const __m256i x16 = _mm256_cmpgt_epi32(scaled, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL - 1));
+
+        __m256i base = _mm256_and_si256(x2, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL));
+        base = _mm256_add_epi32(base, _mm256_and_si256(x4, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL - SL_LIDAR_VARBITSCALE_X2_DEST_VAL)));
+        base = _mm256_add_epi32(base, _mm256_and_si256(x8, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL - SL_LIDAR_VARBITSCALE_X4_DEST_VAL)));
+        base = _mm256_add_epi32(base, _mm256_and_si256(x16, _mm256_set1_epi32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL - SL_LIDAR_VARBITSCALE_X8_DEST_VAL)));
+
+        __m256i target = _mm256_and_si256(x2, _mm256_set1_epi32(0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT));
+        target = _mm256_add_epi32(target, _mm256_and_si256(x4, _mm256_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT))));
+        target = _mm256_add_epi32(target, _mm256_and_si256(x8, _mm256_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT))));
+        target = _mm256_add_epi32(target, _mm256_and_si256(x16, _mm256_set1_epi32((0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT))));
+
+        // each passed threshold adds one scale level, the masks are -1
+        scaleLevel = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_add_epi32(_mm256_add_epi32(x2, x4), _mm256_add_epi32(x8, x16)));
+
+        return _mm256_add_epi32(target, _mm256_sllv_epi32(_mm256_sub_epi32(scaled, base), scaleLevel));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i ultraOffsetSlotAvx2(__m256i dist_q2)
+    {
+        const __m256i valid = _mm256_cmpgt_epi32(dist_q2, _mm256_set1_epi32(50 * 4 - 1));
+        const __m256i k2 = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_set1_ps(98361.f), _mm256_cvtepi32_ps(dist_q2)));
+        return _mm256_blendv_epi8(_mm256_set1_epi32(ULTRA_OFFSET_DEFAULT_SLOT), k2, valid);
+    }
+
+    __attribute__((target("avx2")))
+    static void ultraAvx2(const sl_u32* combined, int dist_q2[3][ULTRA_CABINS], int offsetSlot[3][ULTRA_CABINS])
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i major_mask = _mm256_set1_epi32(0xFFF);
+        const __m256i predict_min = _mm256_set1_epi32(-512);
+        const __m256i predict_max = _mm256_set1_epi32(0x1FF);
+
+        for (size_t pos = 0; pos < ULTRA_CABINS; pos += 8) {
+            const __m256i combined_x3 = _mm256_loadu_si256((const __m256i*)(combined + pos));
+            const __m256i next_x3 = _mm256_loadu_si256((const __m256i*)(combined + pos + 1));
+
+            __m256i predict1 = _mm256_srai_epi32(_mm256_slli_epi32(combined_x3, 10), 22);
+            __m256i predict2 = _mm256_srai_epi32(combined_x3, 22);
+
+            __m256i scalelvl1, scalelvl2;
+            __m256i major = varbitscaleDecodeAvx2(_mm256_and_si256(combined_x3, major_mask), scalelvl1);
+            __m256i major2 = varbitscaleDecodeAvx2(_mm256_and_si256(next_x3, major_mask), scalelvl2);
+
+            // a missing major distance is predicted from the next cabin
+            __m256i use_next = _mm256_andnot_si256(_mm256_cmpeq_epi32(major2, zero), _mm256_cmpeq_epi32(major, zero));
+            __m256i base1 = _mm256_blendv_epi8(major, major2, use_next);
+            scalelvl1 = _mm256_blendv_epi8(scalelvl1, scalelvl2, use_next);
+
+            __m256i invalid1 = _mm256_or_si256(_mm256_cmpeq_epi32(predict1, predict_min), _mm256_cmpeq_epi32(predict1, predict_max));
+            __m256i invalid2 = _mm256_or_si256(_mm256_cmpeq_epi32(predict2, predict_min), _mm256_cmpeq_epi32(predict2, predict_max));
+
+            __m256i dist0 = _mm256_slli_epi32(major, 2);
+            __m256i dist1 = _mm256_andnot_si256(invalid1, _mm256_slli_epi32(_mm256_add_epi32(_mm256_sllv_epi32(predict1, scalelvl1), base1), 2));
+            __m256i dist2 = _mm256_andnot_si256(invalid2, _mm256_slli_epi32(_mm256_add_epi32(_mm256_sllv_epi32(predict2, scalelvl2), major2), 2));
+
+            _mm256_storeu_si256((__m256i*)(dist_q2[0] + pos), dist0);
+            _mm256_storeu_si256((__m256i*)(dist_q2[1] + pos), dist1);
+            _mm256_storeu_si256((__m256i*)(dist_q2[2] + pos), dist2);
+            _mm256_storeu_si256((__m256i*)(offsetSlot[0] + pos), ultraOffsetSlotAvx2(dist0));
+            _mm256_storeu_si256((__m256i*)(offsetSlot[1] + pos), ultraOffsetSlotAvx2(dist1));
+            _mm256_storeu_si256((__m256i*)(offsetSlot[2] + pos), ultraOffsetSlotAvx2(dist2));
+        }
+    }
+#endif
+
+#ifdef SL_DECODER_NEON
+    //
+    // NEON (aarch64 only, ARMv7 NEON has no vector division)
+    //
+
+    static void anglesNeon(int startAngle_q16, int angleInc_q16, int syncWindow_q16, const int* offset_q16, size_t count, int* angle_z_q14, int* syncBit)
+    {
+        static const int32_t lane_index[4] = { 0, 1, 2, 3 };
+        const int32x4_t circle_q16 = vdupq_n_s32(CIRCLE_Q16);
+        const int32x4_t circle_q6 = vdupq_n_s32(CIRCLE_Q6);
+        const int32x4_t zero = vdupq_n_s32(0);
+        const int32x4_t one = vdupq_n_s32(1);
+        const int32x4_t inc = vdupq_n_s32(angleInc_q16);
+        const int32x4_t window = vdupq_n_s32(syncWindow_q16);
+        const int32x4_t step = vdupq_n_s32(angleInc_q16 * 4);
+        const float32x4_t divisor = vdupq_n_f32(90.f);
+
+        int32x4_t raw = vmlaq_s32(vdupq_n_s32(startAngle_q16), vld1q_s32(lane_index), inc);
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            int32x4_t wrapped = vaddq_s32(raw, inc);
+            for (int i = 0; i < 3; ++i) {
+                wrapped = vsubq_s32(wrapped, vandq_s32(vreinterpretq_s32_u32(vcgeq_s32(wrapped, circle_q16)), circle_q16));
+            }
+            int32x4_t sync = vandq_s32(vreinterpretq_s32_u32(vcltq_s32(wrapped, window)), one);
+
+            int32x4_t angle_q6 = vshrq_n_s32(vsubq_s32(raw, vld1q_s32(offset_q16 + pos)), 10);
+            angle_q6 = vaddq_s32(angle_q6, vandq_s32(vreinterpretq_s32_u32(vcltq_s32(angle_q6, zero)), circle_q6));
+            angle_q6 = vsubq_s32(angle_q6, vandq_s32(vreinterpretq_s32_u32(vcgeq_s32(angle_q6, circle_q6)), circle_q6));
+
+            int32x4_t angle_z = vcvtq_s32_f32(vdivq_f32(vcvtq_f32_s32(vshlq_n_s32(angle_q6, 8)), divisor));
+
+            vst1q_s32(angle_z_q14 + pos, angle_z);
+            vst1q_s32(syncBit + pos, sync);
+            raw = vaddq_s32(raw, step);
+        }
+        anglesTail(startAngle_q16, angleInc_q16, syncWindow_q16, offset_q16, pos, count, angle_z_q14, syncBit);
+    }
+
+    static inline int32x4_t varbitscaleDecodeNeon(int32x4_t scaled, int32x4_t& scaleLevel)
+    {
+        const int32x4_t x2 = vreinterpretq_s32_u32(vcgeq_s32(scaled, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL)));
+        const int32x4_t x4 = vreinterpretq_s32_u32(vcgeq_s32(scaled, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL)));
+        const int32x4_t x8 = vreinterpretq_s32_u32(vcgeq_s32(scaled, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL)));
+        const int32x4_t x16 = vreinterpretq_s32_u32(vcgeq_s32(scaled, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL)));
+
+        int32x4_t base = vandq_s32(x2, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X2_DEST_VAL));
+        base = vaddq_s32(base, vandq_s32(x4, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X4_DEST_VAL - SL_LIDAR_VARBITSCALE_X2_DEST_VAL)));
+        base = vaddq_s32(base, vandq_s32(x8, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X8_DEST_VAL - SL_LIDAR_VARBITSCALE_X4_DEST_VAL)));
+        base = vaddq_s32(base, vandq_s32(x16, vdupq_n_s32(SL_LIDAR_VARBITSCALE_X16_DEST_VAL - SL_LIDAR_VARBITSCALE_X8_DEST_VAL)));
+
+        int32x4_t target = vandq_s32(x2, vdupq_n_s32(0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT));
+        target = vaddq_s32(target, vandq_s32(x4, vdupq_n_s32((0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT))));
+        target = vaddq_s32(target, vandq_s32(x8, vdupq_n_s32((0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT))));
+        target = vaddq_s32(target, vandq_s32(x16, vdupq_n_s32((0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT) - (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT))));
+
+        // each passed threshold adds one scale level, the masks are -1
+        scaleLevel = vnegq_s32(vaddq_s32(vaddq_s32(x2, x4), vaddq_s32(x8, x16)));
+
+        return vaddq_s32(target, vshlq_s32(vsubq_s32(scaled, base), scaleLevel));
+    }
+
+    static inline int32x4_t ultraOffsetSlotNeon(int32x4_t dist_q2)
+    {
+        const uint32x4_t valid = vcgeq_s32(dist_q2, vdupq_n_s32(50 * 4));
+        const int32x4_t k2 = vcvtq_s32_f32(vdivq_f32(vdupq_n_f32(98361.f), vcvtq_f32_s32(dist_q2)));
+        return vbslq_s32(valid, k2, vdupq_n_s32(ULTRA_OFFSET_DEFAULT_SLOT));
+    }
+
+    static void ultraNeon(const sl_u32* combined, int dist_q2[3][ULTRA_CABINS], int offsetSlot[3][ULTRA_CABINS])
+    {
+        const int32x4_t zero = vdupq_n_s32(0);
+        const int32x4_t major_mask = vdupq_n_s32(0xFFF);
+        const int32x4_t predict_min = vdupq_n_s32(-512);
+        const int32x4_t predict_max = vdupq_n_s32(0x1FF);
+
+        for (size_t pos = 0; pos < ULTRA_CABINS; pos += 4) {
+            const int32x4_t combined_x3 = vreinterpretq_s32_u32(vld1q_u32(combined + pos));
+            const int32x4_t next_x3 = vreinterpretq_s32_u32(vld1q_u32(combined + pos + 1));
+
+            int32x4_t predict1 = vshrq_n_s32(vshlq_n_s32(combined_x3, 10), 22);
+            int32x4_t predict2 = vshrq_n_s32(combined_x3, 22);
+
+            int32x4_t scalelvl1, scalelvl2;
+            int32x4_t major = varbitscaleDecodeNeon(vandq_s32(combined_x3, major_mask), scalelvl1);
+            int32x4_t major2 = varbitscaleDecodeNeon(vandq_s32(next_x3, major_mask), scalelvl2);
+
+            // a missing major distance is predicted from the next cabin
+            uint32x4_t use_next = vbicq_u32(vceqq_s32(major, zero), vceqq_s32(major2, zero));
+            int32x4_t base1 = vbslq_s32(use_next, major2, major);
+            scalelvl1 = vbslq_s32(use_next, scalelvl2, scalelvl1);
+
+            int32x4_t invalid1 = vreinterpretq_s32_u32(vorrq_u32(vceqq_s32(predict1, predict_min), vceqq_s32(predict1, predict_max)));
+            int32x4_t invalid2 = vreinterpretq_s32_u32(vorrq_u32(vceqq_s32(predict2, predict_min), vceqq_s32(predict2, predict_max)));
+
+            int32x4_t dist0 = vshlq_n_s32(major, 2);
+            int32x4_t dist1 = vbicq_s32(vshlq_n_s32(vaddq_s32(vshlq_s32(predict1, scalelvl1), base1), 2), invalid1);
+            int32x4_t dist2 = vbicq_s32(vshlq_n_s32(vaddq_s32(vshlq_s32(predict2, scalelvl2), major2), 2), invalid2);
+
+            vst1q_s32(dist_q2[0] + pos, dist0);
+            vst1q_s32(dist_q2[1] + pos, dist1);
+            vst1q_s32(dist_q2[2] + pos, dist2);
+            vst1q_s32(offsetSlot[0] + pos, ultraOffsetSlotNeon(dist0));
+            vst1q_s32(offsetSlot[1] + pos, ultraOffsetSlotNeon(dist1));
+            vst1q_s32(offsetSlot[2] + pos, ultraOffsetSlotNeon(dist2));
+        }
+    }
+#endif
+
+    //
+    // Path selection
+    //
+
+    static bool getPathKernels(DecoderPath path, DecoderKernels& kernels)
+    {
+        switch (path) {
+#ifdef SL_DECODER_X86
+        case DECODER_PATH_SSE41:
+            if (!__builtin_cpu_supports("sse4.1")) return false;
+            kernels.angles = anglesSse41;
+            kernels.ultra = ultraSse41;
+            return true;
+        case DECODER_PATH_AVX2:
+            if (!__builtin_cpu_supports("avx2")) return false;
+            kernels.angles = anglesAvx2;
+            kernels.ultra = ultraAvx2;
+            return true;
+#endif
+#ifdef SL_DECODER_NEON
+        case DECODER_PATH_NEON:
+            kernels.angles = anglesNeon;
+            kernels.ultra = ultraNeon;
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    static sl_u32 nextRandom(sl_u32& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return seed;
+    }
+
+    template <class TCapsule>
+    static void randomCapsule(TCapsule& capsule, sl_u32& seed, sl_u16 startAngle_q6)
+    {
+        sl_u8* bytes = reinterpret_cast<sl_u8*>(&capsule);
+        for (size_t pos = 0; pos < sizeof(capsule); ++pos) {
+            bytes[pos] = (sl_u8)(nextRandom(seed) >> 24);
+        }
+        capsule.start_angle_sync_q6 = (startAngle_q6 & 0x7FFF) | (nextRandom(seed) & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT);
+    }
+
+    static bool verifyPath(const DecoderKernels& kernels)
+    {
+        sl_lidar_response_measurement_node_hq_t expected[ULTRA_CAPSULE_SAMPLES];
+        sl_lidar_response_measurement_node_hq_t actual[ULTRA_CAPSULE_SAMPLES];
+        sl_lidar_response_capsule_measurement_nodes_t capsule[2];
+        sl_lidar_response_dense_capsule_measurement_nodes_t dense[2];
+        sl_lidar_response_ultra_capsule_measurement_nodes_t ultra[2];
+        sl_u32 seed = 0x51A7EC;
+
+        int expectedSyncBit = 0, actualSyncBit = 0;
+        bool expectedSynced = false, actualSynced = false;
+
+        for (int round = 0; round < 512; ++round) {
+            // start angles all over the circle: standing still, small and large steps, wrapping around 360 degrees
+            sl_u16 prevStart = (sl_u16)(nextRandom(seed) % CIRCLE_Q6);
+            sl_u16 currentStart;
+            switch (round & 3) {
+            case 0:
+                currentStart = prevStart;
+                break;
+            case 1:
+                currentStart = (sl_u16)((prevStart + (nextRandom(seed) % 256)) % CIRCLE_Q6);
+                break;
+            default:
+                currentStart = (sl_u16)(nextRandom(seed) % CIRCLE_Q6);
+                break;
+            }
+
+            randomCapsule(capsule[0], seed, prevStart);
+            randomCapsule(capsule[1], seed, currentStart);
+            randomCapsule(dense[0], seed, prevStart);
+            randomCapsule(dense[1], seed, currentStart);
+            randomCapsule(ultra[0], seed, prevStart);
+            randomCapsule(ultra[1], seed, currentStart);
+
+            if (round & 8) {
+                // plenty of empty and short samples, which take the special cases of the ultra decoder
+                for (size_t pos = 0; pos < ULTRA_CABINS; ++pos) {
+                    if (nextRandom(seed) & 1) ultra[0].ultra_cabins[pos].combined_x3 &= ~0xFFFu;
+                    if (nextRandom(seed) & 1) ultra[0].ultra_cabins[pos].combined_x3 &= 0xFFFFF0FFu;
+                }
+            }
+
+            size_t expectedCount = capsuleToNormalScalar(capsule[0], capsule[1], expected);
+            size_t actualCount = capsuleToNormalVector(kernels, capsule[0], capsule[1], actual);
+            if (expectedCount != actualCount || memcmp(expected, actual, expectedCount * sizeof(expected[0]))) return false;
+
+            if (!(round & 31)) expectedSynced = actualSynced = false;
+            expectedCount = denseCapsuleToNormalScalar(dense[0], dense[1], expected, expectedSyncBit, expectedSynced);
+            actualCount = denseCapsuleToNormalVector(kernels, dense[0], dense[1], actual, actualSyncBit, actualSynced);
+            if (expectedCount != actualCount || memcmp(expected, actual, expectedCount * sizeof(expected[0]))) return false;
+            if (expectedSyncBit != actualSyncBit || expectedSynced != actualSynced) return false;
+
+            expectedCount = ultraCapsuleToNormalScalar(ultra[0], ultra[1], expected);
+            actualCount = ultraCapsuleToNormalVector(kernels, ultra[0], ultra[1], actual);
+            if (expectedCount != actualCount || memcmp(expected, actual, expectedCount * sizeof(expected[0]))) return false;
+        }
+        return true;
+    }
+
+    struct DecoderPathTable
+    {
+        bool            available[DECODER_PATH_COUNT];
+        DecoderKernels  kernels[DECODER_PATH_COUNT];
+        DecoderPath     best;
+
+        DecoderPathTable()
+            : best(DECODER_PATH_SCALAR)
+        {
+            static const DecoderPath preference[] = { DECODER_PATH_SCALAR, DECODER_PATH_SSE41, DECODER_PATH_NEON, DECODER_PATH_AVX2 };
+
+            memset(kernels, 0, sizeof(kernels));
+            for (size_t i = 0; i < _countof(preference); ++i) {
+                DecoderPath path = preference[i];
+                if (path == DECODER_PATH_SCALAR) {
+                    available[path] = true;
+                    continue;
+                }
+                available[path] = getPathKernels(path, kernels[path]) && verifyPath(kernels[path]);
+                if (available[path]) best = path;
+            }
+        }
+    };
+
+    static const DecoderPathTable& pathTable()
+    {
+        static const DecoderPathTable table;
+        return table;
+    }
+
+    static std::atomic<int> g_selectedPath(-1);
+
+    DecoderPath activePath()
+    {
+        int path = g_selectedPath.load(std::memory_order_relaxed);
+        return path < 0 ? pathTable().best : (DecoderPath)path;
+    }
+
+    bool selectPath(DecoderPath path)
+    {
+        if (!isPathAvailable(path)) return false;
+        g_selectedPath.store(path, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool isPathAvailable(DecoderPath path)
+    {
+        if (path < 0 || path >= DECODER_PATH_COUNT) return false;
+        return pathTable().available[path];
+    }
+
+    const char* pathName(DecoderPath path)
+    {
+        switch (path) {
+        case DECODER_PATH_SCALAR:
+            return "scalar";
+        case DECODER_PATH_SSE41:
+            return "sse4.1";
+        case DECODER_PATH_AVX2:
+            return "avx2";
+        case DECODER_PATH_NEON:
+            return "neon";
+        default:
+            return "unknown";
+        }
+    }
+
+    //
+    // Entry points
+    //
+
+    size_t capsuleToNormal(const sl_lidar_response_capsule_measurement_nodes_t& prev, const sl_lidar_response_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        DecoderPath path = activePath();
+        if (path == DECODER_PATH_SCALAR || !startAnglesInRange(prev.start_angle_sync_q6, capsule.start_angle_sync_q6)) {
+            return capsuleToNormalScalar(prev, capsule, nodebuffer);
+        }
+        return capsuleToNormalVector(pathTable().kernels[path], prev, capsule, nodebuffer);
+    }
+
+    size_t denseCapsuleToNormal(const sl_lidar_response_dense_capsule_measurement_nodes_t& prev, const sl_lidar_response_dense_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer, int& lastSyncBit, bool& synced)
+    {
+        DecoderPath path = activePath();
+        if (path == DECODER_PATH_SCALAR || !startAnglesInRange(prev.start_angle_sync_q6, capsule.start_angle_sync_q6)) {
+            return denseCapsuleToNormalScalar(prev, capsule, nodebuffer, lastSyncBit, synced);
+        }
+        return denseCapsuleToNormalVector(pathTable().kernels[path], prev, capsule, nodebuffer, lastSyncBit, synced);
+    }
+
+    size_t ultraCapsuleToNormal(const sl_lidar_response_ultra_capsule_measurement_nodes_t& prev, const sl_lidar_response_ultra_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer)
+    {
+        DecoderPath path = activePath();
+        if (path == DECODER_PATH_SCALAR || !startAnglesInRange(prev.start_angle_sync_q6, capsule.start_angle_sync_q6)) {
+            return ultraCapsuleToNormalScalar(prev, capsule, nodebuffer);
+        }
+        return ultraCapsuleToNormalVector(pathTable().kernels[path], prev, capsule, nodebuffer);
+    }
+
+    sl_u32 varbitscaleDecode(sl_u32 scaled, sl_u32& scaleLevel)
+    {
+        return varbitscaleDecodeScalar(scaled, scaleLevel);
+    }
+}}
@@ -0,0 +1,80 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+
+namespace sl { namespace decoder {
+
+    /**
+    * Decoders turning express scan capsules into HQ nodes
+    *
+    * Each capsule only carries the start angle of its own samples, so the samples of the previous
+    * capsule are decoded once the next capsule arrives. The heavy per-sample work runs through a
+    * vectorized path (NEON on aarch64, SSE4.1 / AVX2 on x86) picked at runtime. A path is only used
+    * after it produced bit-exactly the same nodes as the scalar reference on a set of test capsules.
+    */
+    enum DecoderPath
+    {
+        DECODER_PATH_SCALAR = 0,
+        DECODER_PATH_SSE41,
+        DECODER_PATH_AVX2,
+        DECODER_PATH_NEON,
+        DECODER_PATH_COUNT,
+    };
+
+    /// Decode the samples of prev, returns the number of nodes stored to nodebuffer (64 at most)
+    size_t capsuleToNormal(const sl_lidar_response_capsule_measurement_nodes_t& prev, const sl_lidar_response_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer);
+
+    /// Decode the samples of prev, returns the number of nodes stored to nodebuffer (40 at most)
+    /// Nodes are only stored once a sync node has been seen, lastSyncBit and synced carry that state between capsules.
+    size_t denseCapsuleToNormal(const sl_lidar_response_dense_capsule_measurement_nodes_t& prev, const sl_lidar_response_dense_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer, int& lastSyncBit, bool& synced);
+
+    /// Decode the samples of prev, returns the number of nodes stored to nodebuffer (96 at most)
+    size_t ultraCapsuleToNormal(const sl_lidar_response_ultra_capsule_measurement_nodes_t& prev, const sl_lidar_response_ultra_capsule_measurement_nodes_t& capsule, sl_lidar_response_measurement_node_hq_t* nodebuffer);
+
+    /// Expand the 12 bit major distance of an ultra cabin, scaleLevel receives the left shift of its range
+    /// Scalar on every path, the vectorized decoders inline their own version.
+    sl_u32 varbitscaleDecode(sl_u32 scaled, sl_u32& scaleLevel);
+
+    /// Path used by the decoders, the fastest verified one unless another one has been selected
+    DecoderPath activePath();
+
+    /// Force a path, e.g. to compare them. Fails if the CPU lacks it or it does not match the scalar decoder.
+    bool selectPath(DecoderPath path);
+
+    bool isPathAvailable(DecoderPath path);
+
+    const char* pathName(DecoderPath path);
+}}
@@ -30,11 +30,170 @@
   *
   */
 
-#include "sl_crc.h"  
+#include "sl_crc.h"
+#include <assert.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(__aarch64__) && defined(__linux__)
+#define SL_CRC32_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
 
 namespace sl {namespace crc32 {
-    
-    static sl_u32 table[256];//crc32_table
+
+    // 0x04C11DB7 bit-reversed, the SDK uses the reflected (LSB first) form of the CRC
+    static const sl_u32 REFLECTED_POLY = 0xEDB88320;
+
+    template <sl_u32... I> struct IndexList {};
+    template <sl_u32 N, sl_u32... I> struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+    template <sl_u32... I> struct MakeIndexList<0, I...> { typedef IndexList<I...> type; };
+
+    static constexpr sl_u32 tableBit(sl_u32 c, int bits)
+    {
+        return bits == 0 ? c : tableBit((c & 1) ? (REFLECTED_POLY ^ (c >> 1)) : (c >> 1), bits - 1);
+    }
+
+    // entry of table k: the CRC of byte i followed by k zero bytes
+    static constexpr sl_u32 tableEntry(sl_u32 i, int k)
+    {
+        return k == 0 ? tableBit(i, 8) : ((tableEntry(i, k - 1) >> 8) ^ tableBit(tableEntry(i, k - 1) & 0xFF, 8));
+    }
+
+    struct SliceTable
+    {
+        sl_u32 value[8][256];
+    };
+
+    template <sl_u32... I>
+    static constexpr SliceTable makeSliceTable(IndexList<I...>)
+    {
+        return SliceTable{ {
+            { tableEntry(I, 0)... }, { tableEntry(I, 1)... }, { tableEntry(I, 2)... }, { tableEntry(I, 3)... },
+            { tableEntry(I, 4)... }, { tableEntry(I, 5)... }, { tableEntry(I, 6)... }, { tableEntry(I, 7)... },
+        } };
+    }
+
+    static constexpr SliceTable table = makeSliceTable(MakeIndexList<256>::type());
+
+    static sl_u32 calBytewise(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+        for (size_t i = 0; i < len; i++) {
+            crc = (crc >> 8) ^ table.value[0][(crc ^ pch[i]) & 0xFF];
+        }
+        return crc;
+    }
+
+    static sl_u32 calSlicingBy8(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        for (; len >= 8; len -= 8, pch += 8) {
+            sl_u32 one, two;
+            memcpy(&one, pch, 4);
+            memcpy(&two, pch + 4, 4);
+            one ^= crc;
+            crc = table.value[7][one & 0xFF] ^ table.value[6][(one >> 8) & 0xFF] ^ table.value[5][(one >> 16) & 0xFF] ^ table.value[4][one >> 24]
+                ^ table.value[3][two & 0xFF] ^ table.value[2][(two >> 8) & 0xFF] ^ table.value[1][(two >> 16) & 0xFF] ^ table.value[0][two >> 24];
+        }
+#endif
+        return calBytewise(crc, pch, len);
+    }
+
+#ifdef SL_CRC32_ARMV8
+    // the ARMv8 CRC32 instructions use the same reflected 0x04C11DB7 polynomial, without the final inversion
+    __attribute__((target("+crc")))
+    static sl_u32 calArmv8(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+        for (; len >= 8; len -= 8, pch += 8) {
+            sl_u64 value;
+            memcpy(&value, pch, 8);
+            crc = __crc32d(crc, value);
+        }
+        if (len >= 4) {
+            sl_u32 value;
+            memcpy(&value, pch, 4);
+            crc = __crc32w(crc, value);
+            pch += 4;
+            len -= 4;
+        }
+        for (; len; --len, ++pch) {
+            crc = __crc32b(crc, *pch);
+        }
+        return crc;
+    }
+#endif
+
+    typedef sl_u32 (*CalFunc)(sl_u32 crc, const sl_u8* pch, size_t len);
+
+    static CalFunc pathFunc(Crc32Path path)
+    {
+        switch (path) {
+        case CRC32_PATH_BYTEWISE:
+            return calBytewise;
+        case CRC32_PATH_SLICING_BY_8:
+            return calSlicingBy8;
+#ifdef SL_CRC32_ARMV8
+        case CRC32_PATH_ARMV8:
+            return calArmv8;
+#endif
+        default:
+            return NULL;
+        }
+    }
+
+    static bool hasArmv8Crc()
+    {
+#ifdef SL_CRC32_ARMV8
+        // function statics are initialized once and thread safe, concurrent drivers never race on them
+        static const bool supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    static Crc32Path bestPath()
+    {
+        return hasArmv8Crc() ? CRC32_PATH_ARMV8 : CRC32_PATH_SLICING_BY_8;
+    }
+
+    static std::atomic<int> g_selectedPath(-1);
+
+    Crc32Path activePath()
+    {
+        int path = g_selectedPath.load(std::memory_order_relaxed);
+        return path < 0 ? bestPath() : (Crc32Path)path;
+    }
+
+    bool selectPath(Crc32Path path)
+    {
+        if (!isPathAvailable(path)) return false;
+        g_selectedPath.store(path, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool isPathAvailable(Crc32Path path)
+    {
+        if (path == CRC32_PATH_ARMV8) return hasArmv8Crc();
+        return pathFunc(path) != NULL;
+    }
+
+    const char* pathName(Crc32Path path)
+    {
+        switch (path) {
+        case CRC32_PATH_BYTEWISE:
+            return "bytewise";
+        case CRC32_PATH_SLICING_BY_8:
+            return "slicing-by-8";
+        case CRC32_PATH_ARMV8:
+            return "armv8";
+        default:
+            return "unknown";
+        }
+    }
+
     sl_u32 bitrev(sl_u32 input, sl_u16 bw)
     {
         sl_u16 i;
@@ -51,52 +210,23 @@ namespace sl {namespace crc32 {
 
     void init(sl_u32 poly)
     {
-        sl_u16 i;
-        sl_u16 j;
-        sl_u32 c;
-
-        poly = bitrev(poly, 32);
-        for (i = 0; i < 256; i++) {
-            c = i;
-            for (j = 0; j < 8; j++) {
-                if (c & 1)
-                    c = poly ^ (c >> 1);
-                else
-                    c = c >> 1;
-            }
-            table[i] = c;
-        }
+        // the tables are generated at compile time, only the 0x04C11DB7 polynomial is supported
+        assert(bitrev(poly, 32) == REFLECTED_POLY);
     }
 
     sl_u32 cal(sl_u32 crc, void* input, sl_u16 len)
     {
-        sl_u16 i;
-        sl_u8 index;
-        sl_u8* pch;
-        pch = (unsigned char*)input;
+        static const sl_u8 zeros[4] = { 0 };
         sl_u8 leftBytes = 4 - len & 0x3;
+        CalFunc func = pathFunc(activePath());
 
-        for (i = 0; i < len; i++) {
-            index = (unsigned char)(crc^*pch);
-            crc = (crc >> 8) ^ table[index];
-            pch++;
-        }
-
-        for (i = 0; i < leftBytes; i++) {//zero padding
-            index = (unsigned char)(crc ^ 0);
-            crc = (crc >> 8) ^ table[index];
-        }
+        crc = func(crc, (const sl_u8*)input, len);
+        crc = func(crc, zeros, leftBytes); //zero padding
         return crc ^ 0xffffffff;
     }
 
     sl_result getResult(sl_u8 *ptr, sl_u32 len) 
     {
-        static sl_u8 tmp;
-        if (tmp != 1) {
-            init(0x4C11DB7);
-            tmp = 1;
-        }
-
         return cal(0xFFFFFFFF, ptr, len);
     }
-}}
\ No newline at end of file
+}}
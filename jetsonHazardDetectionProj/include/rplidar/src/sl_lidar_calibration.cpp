@@ -0,0 +1,190 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+
+#include "sdkcommon.h"
+#include "sl_lidar_calibration.h"
+#include <algorithm>
+#include <functional>
+
+namespace sl {
+
+    enum
+    {
+        // largest mismatch between the requested baudrate and the one measured by the lidar
+        BAUDRATE_TOLERANCE_PERCENT = 3,
+        // time given to a lidar to come back from a reset
+        RESET_DELAY = 1000,
+        GRAB_TIMEOUT = 1000,
+    };
+
+    static bool baudRateMatches(sl_u32 required, sl_u32 actual)
+    {
+        sl_u64 diff = required > actual ? required - actual : actual - required;
+        return diff * 100 <= (sl_u64)required * BAUDRATE_TOLERANCE_PERCENT;
+    }
+
+    static bool switchBaudRate(ILidarDriver* driver, ISerialPortChannel* channel, sl_u32 baudRate)
+    {
+        if (!channel->setBaudRate((int)baudRate)) return false;
+
+        sl_u32 detected = 0;
+        if (SL_IS_FAIL(driver->negotiateSerialBaudRate(baudRate, &detected))) return false;
+        if (!baudRateMatches(baudRate, detected)) return false;
+
+        // the lidar may have confirmed a rate it cannot keep up with, talk to it to make sure
+        sl_lidar_response_device_info_t info;
+        if (SL_IS_OK(driver->getDeviceInfo(info))) return true;
+
+        // it is stuck at a rate it cannot use, a reset brings it back to its default one
+        driver->reset();
+        delay(RESET_DELAY);
+        return false;
+    }
+
+    static sl_u32 probeBaudRate(ILidarDriver* driver, ISerialPortChannel* channel, const std::vector<sl_u32>& candidates)
+    {
+        sl_u32 current = (sl_u32)channel->getBaudRate();
+        std::vector<sl_u32> rates(candidates);
+        std::sort(rates.begin(), rates.end(), std::greater<sl_u32>());
+
+        for (size_t pos = 0; pos < rates.size() && rates[pos] > current; ++pos) {
+            if (switchBaudRate(driver, channel, rates[pos])) return (sl_u32)channel->getBaudRate();
+
+            // the lidar drops an unconfirmed rate by itself
+            channel->setBaudRate((int)current);
+        }
+        return current;
+    }
+
+    static void measureScanMode(ILidarDriver* driver, const LidarScanMode& mode, const LidarCalibrationTarget& target, LidarScanModeReport& report)
+    {
+        report.mode = mode;
+        report.points_per_second = 0;
+        report.nominal_points_per_second = mode.us_per_sample > 0 ? 1000000.f / mode.us_per_sample : 0;
+        report.points_per_degree = 0;
+        report.revolution_ms = 0;
+        report.meets_target = false;
+
+        report.result = driver->startScanExpress(false, mode.id);
+        if (SL_IS_FAIL(report.result)) return;
+
+        LidarScanLease lease;
+        sl_u64 nodes = 0;
+        sl_u64 revolutions = 0;
+        sl_u64 first_ns = 0;
+        sl_u64 last_ns = 0;
+
+        // the first revolution after the start may be partial, it is skipped
+        report.result = driver->grabScanLease(lease, GRAB_TIMEOUT);
+
+        sl_u32 startTs = getms();
+        while (SL_IS_OK(report.result) && getms() - startTs < target.measure_ms) {
+            report.result = driver->grabScanLease(lease, GRAB_TIMEOUT);
+            if (SL_IS_FAIL(report.result)) break;
+
+            if (!revolutions) first_ns = lease.start_ns();
+            last_ns = lease.end_ns();
+            nodes += lease.count();
+            ++revolutions;
+        }
+        lease.release();
+        driver->stop();
+
+        if (revolutions < 2 || last_ns <= first_ns) {
+            if (SL_IS_OK(report.result)) report.result = SL_RESULT_OPERATION_TIMEOUT;
+            return;
+        }
+        report.result = SL_RESULT_OK;
+
+        float seconds = (last_ns - first_ns) / 1e9f;
+        report.points_per_second = nodes / seconds;
+        report.points_per_degree = nodes / (revolutions * 360.f);
+        report.revolution_ms = seconds * 1000.f / revolutions;
+        report.meets_target = report.points_per_degree >= target.min_points_per_degree
+            && report.revolution_ms <= target.max_revolution_ms;
+    }
+
+    // how close a mode comes to the target, 1 or more once it meets it
+    static float targetRatio(const LidarScanModeReport& report, const LidarCalibrationTarget& target)
+    {
+        if (SL_IS_FAIL(report.result)) return 0;
+        float density = target.min_points_per_degree > 0 ? report.points_per_degree / target.min_points_per_degree : 1.f;
+        float latency = report.revolution_ms > 0 ? target.max_revolution_ms / report.revolution_ms : 0;
+        return std::min(density, latency);
+    }
+
+    sl_result calibrateLidar(ILidarDriver* driver, ISerialPortChannel* channel, const LidarCalibrationTarget& target, LidarCalibrationResult& result)
+    {
+        result.modes.clear();
+        result.target_met = false;
+        if (!driver || !channel) return SL_RESULT_OPERATION_FAIL;
+
+        driver->stop();
+        result.baud_rate = probeBaudRate(driver, channel, target.baud_rates);
+
+        std::vector<LidarScanMode> modes;
+        sl_result ans = driver->getAllSupportedScanModes(modes);
+        if (SL_IS_FAIL(ans)) return SL_RESULT_OPERATION_NOT_SUPPORT;
+        if (modes.empty()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+        result.modes.resize(modes.size());
+        int best = -1;
+        for (size_t pos = 0; pos < modes.size(); ++pos) {
+            LidarScanModeReport& report = result.modes[pos];
+            measureScanMode(driver, modes[pos], target, report);
+
+            if (best < 0) {
+                best = (int)pos;
+                continue;
+            }
+            const LidarScanModeReport& chosen = result.modes[best];
+            if (report.meets_target != chosen.meets_target) {
+                if (report.meets_target) best = (int)pos;
+            }
+            else if (report.meets_target) {
+                if (report.points_per_second > chosen.points_per_second) best = (int)pos;
+            }
+            else if (targetRatio(report, target) > targetRatio(chosen, target)) {
+                best = (int)pos;
+            }
+        }
+
+        const LidarScanModeReport& selected = result.modes[best];
+        if (SL_IS_FAIL(selected.result)) return selected.result;
+
+        result.selected_mode = selected.mode.id;
+        result.target_met = selected.meets_target;
+        return SL_RESULT_OK;
+    }
+}
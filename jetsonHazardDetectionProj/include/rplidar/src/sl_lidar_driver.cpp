@@ -38,8 +38,16 @@
 #include "hal/locker.h"
 #include "hal/socket.h"
 #include "hal/event.h"
+#include "hal/lease_pool.h"
+#include "hal/spsc_ring.h"
+#include "hal/arena.h"
 #include "sl_lidar_driver.h"
 #include "sl_crc.h" 
+#include "sl_rx_ring.h"
+#include "sl_capsule_decoder.h"
+#include "sl_scan_order.h"
+#include "sl_scan_soa.h"
+#include "sl_scan_view.h"
 #include <algorithm>
 
 #ifdef _WIN32
@@ -76,137 +84,7 @@ namespace sl {
         to.distance_q2 = from.dist_mm_q2 > sl_u16(-1) ? sl_u16(0) : sl_u16(from.dist_mm_q2);
     }
 
-    static sl_u32 _varbitscale_decode(sl_u32 scaled, sl_u32 & scaleLevel)
-    {
-        static const sl_u32 VBS_SCALED_BASE[] = {
-            SL_LIDAR_VARBITSCALE_X16_DEST_VAL,
-            SL_LIDAR_VARBITSCALE_X8_DEST_VAL,
-            SL_LIDAR_VARBITSCALE_X4_DEST_VAL,
-            SL_LIDAR_VARBITSCALE_X2_DEST_VAL,
-            0,
-        };
-
-        static const sl_u32 VBS_SCALED_LVL[] = {
-            4,
-            3,
-            2,
-            1,
-            0,
-        };
-
-        static const sl_u32 VBS_TARGET_BASE[] = {
-            (0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT),
-            (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT),
-            (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT),
-            (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT),
-            0,
-        };
-
-        for (size_t i = 0; i < _countof(VBS_SCALED_BASE); ++i) {
-            int remain = ((int)scaled - (int)VBS_SCALED_BASE[i]);
-            if (remain >= 0) {
-                scaleLevel = VBS_SCALED_LVL[i];
-                return VBS_TARGET_BASE[i] + (remain << scaleLevel);
-            }
-        }
-        return 0;
-    }
-
-    static inline float getAngle(const sl_lidar_response_measurement_node_t& node)
-    {
-        return (node.angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) / 64.f;
-    }
-
-    static inline void setAngle(sl_lidar_response_measurement_node_t& node, float v)
-    {
-        sl_u16 checkbit = node.angle_q6_checkbit & SL_LIDAR_RESP_MEASUREMENT_CHECKBIT;
-        node.angle_q6_checkbit = (((sl_u16)(v * 64.0f)) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | checkbit;
-    }
-
-    static inline float getAngle(const sl_lidar_response_measurement_node_hq_t& node)
-    {
-        return node.angle_z_q14 * 90.f / 16384.f;
-    }
-
-    static inline void setAngle(sl_lidar_response_measurement_node_hq_t& node, float v)
-    {
-        node.angle_z_q14 = sl_u32(v * 16384.f / 90.f);
-    }
-
-    static inline sl_u16 getDistanceQ2(const sl_lidar_response_measurement_node_t& node)
-    {
-        return node.distance_q2;
-    }
-
-    static inline sl_u32 getDistanceQ2(const sl_lidar_response_measurement_node_hq_t& node)
-    {
-        return node.dist_mm_q2;
-    }
-   
-    template <class TNode>
-    static bool angleLessThan(const TNode& a, const TNode& b)
-    {
-        return getAngle(a) < getAngle(b);
-    }
-
-    template < class TNode >
-    static sl_result ascendScanData_(TNode * nodebuffer, size_t count)
-    {
-        float inc_origin_angle = 360.f / count;
-        size_t i = 0;
-
-        //Tune head
-        for (i = 0; i < count; i++) {
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                continue;
-            }
-            else {
-                while (i != 0) {
-                    i--;
-                    float expect_angle = getAngle(nodebuffer[i + 1]) - inc_origin_angle;
-                    if (expect_angle < 0.0f) expect_angle = 0.0f;
-                    setAngle(nodebuffer[i], expect_angle);
-                }
-                break;
-            }
-        }
-
-        // all the data is invalid
-        if (i == count) return SL_RESULT_OPERATION_FAIL;
-
-        //Tune tail
-        for (i = count - 1; i >= 0; i--) {
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                continue;
-            }
-            else {
-                while (i != (count - 1)) {
-                    i++;
-                    float expect_angle = getAngle(nodebuffer[i - 1]) + inc_origin_angle;
-                    if (expect_angle > 360.0f) expect_angle -= 360.0f;
-                    setAngle(nodebuffer[i], expect_angle);
-                }
-                break;
-            }
-        }
-
-        //Fill invalid angle in the scan
-        float frontAngle = getAngle(nodebuffer[0]);
-        for (i = 1; i < count; i++) {
-            if (getDistanceQ2(nodebuffer[i]) == 0) {
-                float expect_angle = frontAngle + i * inc_origin_angle;
-                if (expect_angle > 360.0f) expect_angle -= 360.0f;
-                setAngle(nodebuffer[i], expect_angle);
-            }
-        }
-
-        // Reorder the scan according to the angle value
-        std::sort(nodebuffer, nodebuffer + count, &angleLessThan<TNode>);
-
-        return SL_RESULT_OK;
-    }
-
-    class SlamtecLidarDriver :public ILidarDriver
+    class SlamtecLidarDriver :public ILidarDriver, public IScanBufferOwner
     {
     public:
         enum {
@@ -223,6 +101,66 @@ namespace sl {
             TOF_LIDAR_MINUM_MAJOR_ID = 6,
         };
 
+        enum {
+            DEFAULT_SCAN_BUFFER_LIMIT = 8192,
+            LEGACY_INTERVAL_RETRIEVE_NODES = 8192,
+            DECODE_BUFFER_NODES = 256,
+            // scan slots hold one revolution at this rotation speed or faster
+            MIN_SCAN_FREQUENCY = 4,
+            // the HQ clock offset may grow this much per capsule to follow a drift of the device clock
+            HQ_CLOCK_DRIFT_NS = 1000,
+            // a larger jump of the offset means the device clock has been reset
+            HQ_CLOCK_RESYNC_NS = 1000000000,
+        };
+
+        // writable side of the SoA arrays published through LidarScanBuffer
+        struct ScanSlotArrays {
+            sl_u16* angle_q14;
+            sl_u32* dist_q2;
+            sl_u8*  quality;
+            float*  x;
+            float*  y;
+            sl_lidar_response_measurement_node_hq_t* view_nodes[LIDAR_MAX_SCAN_VIEWS];
+            sl_u64* view_ts[LIDAR_MAX_SCAN_VIEWS];
+        };
+
+        // counters behind getStatistics, only the thread decoding the data updates them
+        struct StatCounters {
+            StatCounters()
+                : frames_decoded(0)
+                , checksum_errors(0)
+                , crc_errors(0)
+                , sync_losses(0)
+                , resync_bytes(0)
+                , revolutions(0)
+                , revolutions_dropped(0)
+                , points_per_revolution(0)
+                , revolution_period_ns(0)
+            {
+                for (int bucket = 0; bucket < LIDAR_LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+                    publish_latency[bucket].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            std::atomic<sl_u64> frames_decoded;
+            std::atomic<sl_u64> checksum_errors;
+            std::atomic<sl_u64> crc_errors;
+            std::atomic<sl_u64> sync_losses;
+            std::atomic<sl_u64> resync_bytes;
+            std::atomic<sl_u64> revolutions;
+            std::atomic<sl_u64> revolutions_dropped;
+            std::atomic<sl_u64> points_per_revolution;
+            std::atomic<sl_u64> revolution_period_ns;
+            std::atomic<sl_u64> publish_latency[LIDAR_LATENCY_HISTOGRAM_BUCKETS];
+        };
+
+        // capsule the next one is decoded against, only the running scan mode uses it
+        union CapsuleHistory {
+            sl_lidar_response_capsule_measurement_nodes_t       capsule;
+            sl_lidar_response_dense_capsule_measurement_nodes_t dense_capsule;
+            sl_lidar_response_ultra_capsule_measurement_nodes_t ultra_capsule;
+        };
+
     public:
         SlamtecLidarDriver()
             : _channel(NULL)
@@ -231,9 +169,70 @@ namespace sl {
             , _isSupportingMotorCtrl(MotorCtrlSupportNone)
             , _cached_sampleduration_std(LEGACY_SAMPLE_DURATION)
             , _cached_sampleduration_express(LEGACY_SAMPLE_DURATION)
-            , _cached_scan_node_hq_count(0)
-            , _cached_scan_node_hq_count_for_interval_retrieve(0)
-        {}
+            , _scan_sequence(0)
+            , _grabbed_sequence(0)
+            , _scan_buffer_limit(DEFAULT_SCAN_BUFFER_LIMIT)
+            , _max_scan_nodes(0)
+            , _interval_buffer_nodes(0)
+            , _array_flags(0)
+            , _view_count(0)
+            , _layout_view_count(0)
+            , _view_bins(NULL)
+            , _decode_buf(NULL)
+            , _decode_buf_std(NULL)
+            , _capsule_history(NULL)
+            , _decode_ts(NULL)
+            , _sample_duration_ns(LEGACY_SAMPLE_DURATION * 1000)
+            , _hq_clock_offset_ns(0)
+            , _hq_clock_synced(false)
+            , _last_node_ns(0)
+            , _sort_scratch_buf(NULL)
+            , _sort_scratch_ts(NULL)
+            , _interval_waiting(false)
+            , _external_pump(false)
+            , _scan_frame_type(LIDAR_FRAME_MEASUREMENT_NODE)
+            , _pump_scan_count(0)
+            , _sector_listener(NULL)
+            , _sector_degrees(0)
+            , _sector_width_q14(0)
+            , _sector_begin(0)
+            , _sector_index(0)
+            , _publish_flags(0)
+            , _frame_synced(false)
+            , _frame_arrival_ns(0)
+            , _revolution_start_ns(0)
+            , _cached_dense_last_sync_bit(0)
+        {
+            for (int i = 0; i < rp::hal::LeasePoolIndex::SLOT_COUNT; ++i) {
+                _scan_slot_buf[i] = NULL;
+                _scan_slot_ts[i] = NULL;
+                _scan_slot_info[i].nodes = NULL;
+                _scan_slot_info[i].count = 0;
+                _scan_slot_info[i].sequence = 0;
+                _scan_slot_info[i].timestamp_us = 0;
+                _scan_slot_info[i].timestamps_ns = NULL;
+                _scan_slot_info[i].start_ns = 0;
+                _scan_slot_info[i].end_ns = 0;
+                _scan_slot_info[i].publish_flags = 0;
+                _scan_slot_info[i].angle_q14 = NULL;
+                _scan_slot_info[i].dist_q2 = NULL;
+                _scan_slot_info[i].quality = NULL;
+                _scan_slot_info[i].x = NULL;
+                _scan_slot_info[i].y = NULL;
+                _scan_slot_arrays[i].angle_q14 = NULL;
+                _scan_slot_arrays[i].dist_q2 = NULL;
+                _scan_slot_arrays[i].quality = NULL;
+                _scan_slot_arrays[i].x = NULL;
+                _scan_slot_arrays[i].y = NULL;
+                _scan_slot_info[i].views = _scan_slot_views[i];
+                _scan_slot_info[i].view_count = 0;
+                for (int view = 0; view < LIDAR_MAX_SCAN_VIEWS; ++view) {
+                    _scan_slot_arrays[i].view_nodes[view] = NULL;
+                    _scan_slot_arrays[i].view_ts[view] = NULL;
+                }
+            }
+            _scan_write_slot = _scan_pool.claim();
+        }
 
         sl_result connect(IChannel* channel)
         {
@@ -250,6 +249,7 @@ namespace sl {
                     return SL_RESULT_OPERATION_FAIL;
 
                 _channel->flush();
+                _rxRing.clear();
             }
      
             _isConnected = true;
@@ -261,8 +261,11 @@ namespace sl {
 
         void disconnect()
         {
-            if (_isConnected)
+            if (_isConnected) {
+                _disableDataGrabbing();
                 _channel->close();
+                _isConnected = false;
+            }
         }
 
         bool isConnected()
@@ -386,8 +389,12 @@ namespace sl {
 
             stop(); //force the previous operation to stop
             setMotorSpeed();
+            float sample_duration = _getScanSampleDuration(SL_LIDAR_CONF_SCAN_COMMAND_STD);
             {
                 rp::hal::AutoLocker l(_lock);
+                ans = _prepareScanBuffers(sample_duration);
+                if (!ans) return ans;
+
                 ans = _sendCommand(force ? SL_LIDAR_CMD_FORCE_SCAN : SL_LIDAR_CMD_SCAN);
                 if (!ans) return ans;
                 // waiting for confirmation
@@ -404,11 +411,8 @@ namespace sl {
                 if (header_size < sizeof(sl_lidar_response_measurement_node_t)) {
                     return SL_RESULT_INVALID_DATA;
                 }
-                _isScanning = true;
-                _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheScanData);
-                if (_cachethread.getHandle() == 0) {
-                    return SL_RESULT_OPERATION_FAIL;
-                }
+                ans = _startScanDecoding(LIDAR_FRAME_MEASUREMENT_NODE);
+                if (!ans) return ans;
             }
             return SL_RESULT_OK;
         }
@@ -458,8 +462,11 @@ namespace sl {
                     return startScan(force, false, 0, outUsedScanMode);
                 }
             }
+            float sample_duration = _getScanSampleDuration(scanMode);
             {
                 rp::hal::AutoLocker l(_lock);
+                ans = _prepareScanBuffers(sample_duration);
+                if (!ans) return ans;
 
                 startMotor();
                 sl_lidar_payload_express_scan_t scanReq;
@@ -497,35 +504,28 @@ namespace sl {
                         return SL_RESULT_INVALID_DATA;
                     }
                     _cached_capsule_flag = NORMAL_CAPSULE;
-                    _isScanning = true;
-                    _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheCapsuledScanData);
+                    ans = _startScanDecoding(LIDAR_FRAME_CAPSULE);
                 }
                 else if (scanAnsType == SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED) {
                     if (header_size < sizeof(sl_lidar_response_capsule_measurement_nodes_t)) {
                         return SL_RESULT_INVALID_DATA;
                     }
                     _cached_capsule_flag = DENSE_CAPSULE;
-                    _isScanning = true;
-                    _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheCapsuledScanData);
+                    ans = _startScanDecoding(LIDAR_FRAME_CAPSULE);
                 }
                 else if (scanAnsType == SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ) {
                     if (header_size < sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t)) {
                         return SL_RESULT_INVALID_DATA;
                     }
-                    _isScanning = true;
-                    _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheHqScanData);
+                    ans = _startScanDecoding(LIDAR_FRAME_HQ_CAPSULE);
                 }
                 else {
                     if (header_size < sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t)) {
                         return SL_RESULT_INVALID_DATA;
                     }
-                    _isScanning = true;
-                    _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheUltraCapsuledScanData);
-                }
-
-                if (_cachethread.getHandle() == 0) {
-                    return SL_RESULT_OPERATION_FAIL;
+                    ans = _startScanDecoding(LIDAR_FRAME_ULTRA_CAPSULE);
                 }
+                if (!ans) return ans;
             }
             return SL_RESULT_OK;
 
@@ -551,29 +551,49 @@ namespace sl {
        
         sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
-            switch (_dataEvt.wait(timeout))
-            {
-            case rp::hal::Event::EVENT_TIMEOUT:
+            return grabScanDataHqWithTimestamps(nodebuffer, NULL, count, timeout);
+        }
+
+        sl_result grabScanDataHqWithTimestamps(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slot;
+            sl_result ans = _waitScanSlot(_grabbed_sequence, slot, timeout);
+            if (!SL_IS_OK(ans)) {
                 count = 0;
-                return SL_RESULT_OPERATION_TIMEOUT;
-            case rp::hal::Event::EVENT_OK:
-            {
-                if (_cached_scan_node_hq_count == 0) return SL_RESULT_OPERATION_TIMEOUT; //consider as timeout
+                return ans;
+            }
 
-                rp::hal::AutoLocker l(_lock);
+            const LidarScanBuffer & scan = _scan_slot_info[slot];
+            size_t size_to_copy = std::min(count, scan.count);
+            memcpy(nodebuffer, scan.nodes, size_to_copy * sizeof(sl_lidar_response_measurement_node_hq_t));
+            if (timestamps) memcpy(timestamps, scan.timestamps_ns, size_to_copy * sizeof(sl_u64));
+            _grabbed_sequence = scan.sequence;
+            _scan_pool.release(slot);
 
-                size_t size_to_copy = std::min(count, _cached_scan_node_hq_count);
-                memcpy(nodebuffer, _cached_scan_node_hq_buf, size_to_copy * sizeof(sl_lidar_response_measurement_node_hq_t));
+            count = size_to_copy;
+            return SL_RESULT_OK;
+        }
 
-                count = size_to_copy;
-                _cached_scan_node_hq_count = 0;
-            }
+        sl_result grabScanLease(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slot;
+            sl_result ans = _waitScanSlot(lease.valid() ? lease.sequence() : 0, slot, timeout);
+            if (!SL_IS_OK(ans)) return ans;
+
+            // the temporary lease adopts the slot reference taken by _waitScanSlot and drops it
+            // once the assignment has taken a reference of its own
+            lease = LidarScanLease(this, slot, _scan_slot_info[slot]);
             return SL_RESULT_OK;
+        }
 
-            default:
-                count = 0;
-                return SL_RESULT_OPERATION_FAIL;
-            }
+        void retainScanBuffer(int slot)
+        {
+            _scan_pool.retain(slot);
+        }
+
+        void releaseScanBuffer(int slot)
+        {
+            _scan_pool.release(slot);
         }
 
         sl_result getDeviceInfo(sl_lidar_response_device_info_t& info, sl_u32 timeout = DEFAULT_TIMEOUT)
@@ -674,26 +694,199 @@ namespace sl {
 
         sl_result ascendScanData(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t count)
         {
-            return ascendScanData_<sl_lidar_response_measurement_node_hq_t>(nodebuffer, count);
+            return scan_order::ascendQ14(nodebuffer, NULL, count);
         }
 
-        sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
+        sl_result setExternalPump(bool enable)
         {
-            size_t size_to_copy = 0;
-            {
-                rp::hal::AutoLocker l(_lock);
-                if (_cached_scan_node_hq_count_for_interval_retrieve == 0) {
-                    return SL_RESULT_OPERATION_TIMEOUT;
+            rp::hal::AutoLocker l(_lock);
+            if (_isScanning) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _external_pump = enable;
+            return SL_RESULT_OK;
+        }
+
+        sl_result pumpScanData(size_t & publishedScans)
+        {
+            publishedScans = 0;
+            if (!_external_pump) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            rp::hal::AutoLocker l(_lock);
+            if (!_isScanning) return SL_RESULT_OPERATION_STOP;
+
+            sl_u64 sequence = _scan_sequence;
+            if (!_rxRing.pull(_channel)) {
+                _isScanning = false;
+                return SL_RESULT_OPERATION_FAIL;
+            }
+
+            for (;;) {
+                const sl_u8 * frame;
+                size_t skipped;
+                int status = _nextFrame(_scan_frame_type, frame, skipped);
+                if (status == LidarRxRing::FRAME_NEED_MORE) break;
+
+                // any byte lost between two capsules breaks the angle interpolation with the previous one
+                if (skipped || status == LidarRxRing::FRAME_CORRUPTED) {
+                    _is_previous_capsuledataRdy = false;
+                    if (status == LidarRxRing::FRAME_CORRUPTED) continue;
+                }
+
+                size_t count = _decodeScanFrame(frame);
+                _stampDecodedNodes(frame, count);
+                for (size_t pos = 0; pos < count; ++pos) {
+                    _cacheScanNode(_decode_buf[pos], _decode_ts[pos], _pump_scan_count);
                 }
-                //copy all the nodes(_cached_scan_node_count_for_interval_retrieve nodes) in _cached_scan_node_buf_for_interval_retrieve
-                size_to_copy = _cached_scan_node_hq_count_for_interval_retrieve;
-                memcpy(nodebuffer, _cached_scan_node_hq_buf_for_interval_retrieve, size_to_copy * sizeof(sl_lidar_response_measurement_node_hq_t));
-                _cached_scan_node_hq_count_for_interval_retrieve = 0;
             }
-            count = size_to_copy;
+            _notifyIntervalConsumer();
+
+            publishedScans = (size_t)(_scan_sequence - sequence);
+            return SL_RESULT_OK;
+        }
+
+        int getPollHandle()
+        {
+            return _channel ? _channel->getPollHandle() : -1;
+        }
+
+        sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
+        {
+            // legacy callers do not pass their buffer size, they were given at most the size of the old fixed buffer
+            count = LEGACY_INTERVAL_RETRIEVE_NODES;
+            return drainScanDataWithIntervalHq(nodebuffer, count);
+        }
+
+        sl_result drainScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
+        {
+            count = _intervalRing.pop(nodebuffer, count);
+            return count ? SL_RESULT_OK : SL_RESULT_OPERATION_TIMEOUT;
+        }
+
+        sl_result waitScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            size_t max_count = count;
+            sl_u32 startTs = getms();
+
+            for (;;) {
+                count = _intervalRing.pop(nodebuffer, max_count);
+                if (count) return SL_RESULT_OK;
+
+                sl_u32 waitTime = getms() - startTs;
+                if (waitTime >= timeout) return SL_RESULT_OPERATION_TIMEOUT;
+
+                // the cache thread only signals when someone is waiting, check again once announced
+                _interval_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (_intervalRing.size()) continue;
+
+                unsigned long ans = _intervalEvt.wait(timeout - waitTime);
+                if (ans == (unsigned long)rp::hal::Event::EVENT_FAILED) return SL_RESULT_OPERATION_FAIL;
+            }
+        }
+
+        sl_result setScanIntervalBufferSize(size_t nodeCount)
+        {
+            rp::hal::AutoLocker l(_lock);
+            _interval_buffer_nodes = nodeCount;
+            return SL_RESULT_OK;
+        }
 
+        sl_result setScanSectorListener(ILidarSectorListener* listener, float sectorDegrees)
+        {
+            if (listener && !(sectorDegrees > 0 && sectorDegrees <= 360)) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_lock);
+            if (_isScanning) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _sector_listener = listener;
+            _sector_degrees = sectorDegrees;
+            // angle_z_q14 counts 16384 per 90 degrees
+            _sector_width_q14 = std::max<sl_u32>(1, (sl_u32)(sectorDegrees * 16384.f / 90.f));
             return SL_RESULT_OK;
         }
+
+        sl_result setScanPublishOptions(sl_u32 flags)
+        {
+            if (flags & ~(sl_u32)(SCAN_PUBLISH_SORTED | SCAN_PUBLISH_SOA | SCAN_PUBLISH_CARTESIAN)) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_lock);
+            if (_isScanning) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _publish_flags = flags;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanThreadPolicy(const LidarThreadPolicy& policy)
+        {
+            if (policy.priority > LIDAR_THREAD_PRIORITY_REALTIME) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_lock);
+            _thread_policy = policy;
+            if (!_isScanning || !_cachethread.getHandle()) return SL_RESULT_OK;
+            return _applyThreadPolicy();
+        }
+
+        sl_result addScanView(const LidarScanViewDesc& desc, int& viewId)
+        {
+            scan_view::ViewFilter filter;
+            if (!scan_view::makeFilter(desc, filter)) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_lock);
+            if (_isScanning) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            if (_view_count == LIDAR_MAX_SCAN_VIEWS) return SL_RESULT_INSUFFICIENT_MEMORY;
+            _view_filters[_view_count] = filter;
+            viewId = (int)_view_count++;
+            return SL_RESULT_OK;
+        }
+
+        sl_result clearScanViews()
+        {
+            rp::hal::AutoLocker l(_lock);
+            if (_isScanning) return SL_RESULT_OPERATION_NOT_SUPPORT;
+            _view_count = 0;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setScanBufferLimit(size_t maxNodes)
+        {
+            if (!maxNodes) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_lock);
+            _scan_buffer_limit = maxNodes;
+            return SL_RESULT_OK;
+        }
+
+        size_t getMaxScanNodes()
+        {
+            return _max_scan_nodes;
+        }
+
+        void getStatistics(LidarStatistics & stats)
+        {
+            stats.timestamp_ns = getns();
+            stats.bytes_received = _rxRing.bytesReceived();
+            stats.frames_decoded = _stats.frames_decoded.load(std::memory_order_relaxed);
+            stats.checksum_errors = _stats.checksum_errors.load(std::memory_order_relaxed);
+            stats.crc_errors = _stats.crc_errors.load(std::memory_order_relaxed);
+            stats.sync_losses = _stats.sync_losses.load(std::memory_order_relaxed);
+            stats.resync_bytes = _stats.resync_bytes.load(std::memory_order_relaxed);
+            stats.revolutions = _stats.revolutions.load(std::memory_order_relaxed);
+            stats.revolutions_dropped = _stats.revolutions_dropped.load(std::memory_order_relaxed);
+            stats.points_per_revolution = (size_t)_stats.points_per_revolution.load(std::memory_order_relaxed);
+
+            sl_u64 period_ns = _stats.revolution_period_ns.load(std::memory_order_relaxed);
+            stats.rotation_frequency_hz = period_ns ? (float)(1e9 / period_ns) : 0.f;
+
+            for (int bucket = 0; bucket < LIDAR_LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+                stats.publish_latency_histogram[bucket] = _stats.publish_latency[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+        void getScanIntervalBufferStats(LidarIntervalBufferStats & stats)
+        {
+            stats.capacity = _intervalRing.capacity();
+            stats.buffered = _intervalRing.size();
+            stats.dropped_nodes = _intervalRing.droppedCount();
+            stats.overflow_count = _intervalRing.overflowCount();
+        }
+
         sl_result setMotorSpeed(sl_u16 speed = DEFAULT_MOTOR_SPEED)
         {
             Result<nullptr_t> ans = SL_RESULT_OK;
@@ -840,7 +1033,7 @@ namespace sl {
 				if (header_size < sizeof(type)) {
 					return SL_RESULT_INVALID_DATA;
 				}
-				if (!_channel->waitForData(header_size, timeout)) {
+				if (!_rxRing.fill(_channel, header_size, timeout)) {
 					return SL_RESULT_OPERATION_TIMEOUT;
 				}
 				delay(100);
@@ -849,7 +1042,7 @@ namespace sl {
 					sl_u32 result;
 				} answer;
 
-				_channel->read(reinterpret_cast<sl_u8*>(&answer), header_size);
+				_rxRing.read(reinterpret_cast<sl_u8*>(&answer), std::min<size_t>(header_size, sizeof(answer)));
 				return answer.result;
     
 			}
@@ -889,13 +1082,13 @@ namespace sl {
                     return SL_RESULT_INVALID_DATA;
                 }
 				//delay(100);
-                if (!_channel->waitForData(header_size, timeout)) {
+                if (!_rxRing.fill(_channel, header_size, timeout)) {
                     return SL_RESULT_OPERATION_TIMEOUT;
                 }
 
                 std::vector<sl_u8> dataBuf;
                 dataBuf.resize(header_size);
-                _channel->read(reinterpret_cast<sl_u8 *>(&dataBuf[0]), header_size);
+                _rxRing.read(reinterpret_cast<sl_u8 *>(&dataBuf[0]), header_size);
 
                 //check if returned type is same as asked type
                 sl_u32 replyType = -1;
@@ -1000,6 +1193,7 @@ namespace sl {
             // wait for a while
             delay(10);
             _channel->clearReadCache();
+            _rxRing.clear();
 
             // sending magic byte to let the target LIDAR start baudrate measurement
             // More than 100 bytes per second datarate is required to trigger the measurements
@@ -1065,6 +1259,8 @@ namespace sl {
                 cmd |= SL_LIDAR_CMDFLAG_HAS_PAYLOAD;
             }
 			_channel->flush();
+            // the cache thread owns the receive buffer while scanning, commands sent meanwhile expect no answer
+            if (!_isScanning) _rxRing.clear();
             cmd_packet.push_back(SL_LIDAR_CMD_SYNC_BYTE);
             cmd_packet.push_back(cmd);
 			
@@ -1094,52 +1290,62 @@ namespace sl {
             return SL_RESULT_OK;
         }
 
-        sl_result _waitResponseHeader(sl_lidar_ans_header_t * header, sl_u32 timeout = DEFAULT_TIMEOUT)
+        // LidarRxRing::nextFrame, keeping the protocol counters up to date
+        int _nextFrame(LidarFrameType type, const sl_u8 *& frame, size_t & skipped)
+        {
+            int status = _rxRing.nextFrame(type, frame, skipped);
+            if (skipped) {
+                _countStat(_stats.resync_bytes, skipped);
+                if (_frame_synced) _countStat(_stats.sync_losses);
+                _frame_synced = false;
+            }
+
+            if (status == LidarRxRing::FRAME_FOUND) {
+                _frame_synced = true;
+                _frame_arrival_ns = _rxRing.arrivalTime(frame);
+                _countStat(_stats.frames_decoded);
+            }
+            else if (status == LidarRxRing::FRAME_CORRUPTED) {
+                _countStat(type == LIDAR_FRAME_HQ_CAPSULE ? _stats.crc_errors : _stats.checksum_errors);
+            }
+            return status;
+        }
+
+        sl_result _waitFrame(LidarFrameType type, const sl_u8 *& frame, size_t & skipped, sl_u32 timeout)
         {
-            int  recvPos = 0;
             sl_u32 startTs = getms();
-            sl_u8  recvBuffer[sizeof(sl_lidar_ans_header_t)];
-            sl_u8  *headerBuffer = reinterpret_cast<sl_u8 *>(header);
             sl_u32 waitTime;
+            size_t dropped;
 
+            skipped = 0;
             while ((waitTime = getms() - startTs) <= timeout) {
-                size_t remainSize = sizeof(sl_lidar_ans_header_t) - recvPos;
-                size_t recvSize;
-
-                bool ans = _channel->waitForData(remainSize, timeout - waitTime, &recvSize);
-                if (!ans) return SL_RESULT_OPERATION_TIMEOUT;
+                int status = _nextFrame(type, frame, dropped);
+                skipped += dropped;
 
-                if (recvSize > remainSize) recvSize = remainSize;
-
-                recvSize = _channel->read(recvBuffer, recvSize);
-
-                for (size_t pos = 0; pos < recvSize; ++pos) {
-                    sl_u8 currentByte = recvBuffer[pos];
-                    switch (recvPos) {
-                    case 0:
-                        if (currentByte != SL_LIDAR_ANS_SYNC_BYTE1) {
-                            continue;
-                        }
-
-                        break;
-                    case 1:
-                        if (currentByte != SL_LIDAR_ANS_SYNC_BYTE2) {
-                            recvPos = 0;
-                            continue;
-                        }
-                        break;
-                    }
-                    headerBuffer[recvPos++] = currentByte;
-
-                    if (recvPos == sizeof(sl_lidar_ans_header_t)) {
-                        return SL_RESULT_OK;
-                    }
+                switch (status) {
+                case LidarRxRing::FRAME_FOUND:
+                    return SL_RESULT_OK;
+                case LidarRxRing::FRAME_CORRUPTED:
+                    return SL_RESULT_INVALID_DATA;
                 }
+
+                if (!_rxRing.fill(_channel, LidarRxRing::frameSize(type), timeout - waitTime)) return SL_RESULT_OPERATION_TIMEOUT;
             }
 
             return SL_RESULT_OPERATION_TIMEOUT;
         }
 
+        sl_result _waitResponseHeader(sl_lidar_ans_header_t * header, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            const sl_u8 * frame;
+            size_t skipped;
+            sl_result ans = _waitFrame(LIDAR_FRAME_ANS_HEADER, frame, skipped, timeout);
+            if (SL_IS_FAIL(ans)) return ans;
+
+            memcpy(header, frame, sizeof(sl_lidar_ans_header_t));
+            return SL_RESULT_OK;
+        }
+
         template <typename T>
         sl_result _waitResponse(T &payload ,sl_u8 ansType, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
@@ -1158,13 +1364,56 @@ namespace sl {
             if (header_size < sizeof(T)) {
                 return SL_RESULT_INVALID_DATA;
             }
-            if (!_channel->waitForData(header_size, timeout)) {
+            if (!_rxRing.fill(_channel, header_size, timeout)) {
                 return SL_RESULT_OPERATION_TIMEOUT;
             }
-            _channel->read(reinterpret_cast<sl_u8 *>(&payload), sizeof(T));
+            _rxRing.read(reinterpret_cast<sl_u8 *>(&payload), sizeof(T));
             return SL_RESULT_OK;
         }
 
+        sl_result _startScanDecoding(LidarFrameType frameType)
+        {
+            _scan_frame_type = frameType;
+            _pump_scan_count = 0;
+            _isScanning = true;
+            if (_external_pump) return SL_RESULT_OK;
+
+            switch (frameType) {
+            case LIDAR_FRAME_CAPSULE:
+                _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheCapsuledScanData);
+                break;
+            case LIDAR_FRAME_HQ_CAPSULE:
+                _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheHqScanData);
+                break;
+            case LIDAR_FRAME_ULTRA_CAPSULE:
+                _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheUltraCapsuledScanData);
+                break;
+            default:
+                _cachethread = CLASS_THREAD(SlamtecLidarDriver, _cacheScanData);
+                break;
+            }
+            if (_cachethread.getHandle() == 0) {
+                return SL_RESULT_OPERATION_FAIL;
+            }
+            _cachethread.setName("sl-lidar-decode");
+            _applyThreadPolicy();
+            return SL_RESULT_OK;
+        }
+
+        sl_result _applyThreadPolicy()
+        {
+            sl_result ans = SL_RESULT_OK;
+            if (_thread_policy.priority != LIDAR_THREAD_PRIORITY_DEFAULT) {
+                ans = _cachethread.setPriority(_thread_policy.priority == LIDAR_THREAD_PRIORITY_REALTIME
+                    ? rp::hal::Thread::PRIORITY_REALTIME : rp::hal::Thread::PRIORITY_HIGH);
+            }
+            if (_thread_policy.cpu_mask) {
+                sl_result affinity = _cachethread.setAffinity(_thread_policy.cpu_mask);
+                if (SL_IS_OK(ans)) ans = affinity;
+            }
+            return ans;
+        }
+
         void _disableDataGrabbing()
         {
             //_clearRxDataCache();
@@ -1172,65 +1421,130 @@ namespace sl {
             _cachethread.join();
         }
         
-#define  MAX_SCAN_NODES  (8192)
-        sl_result _waitNode(sl_lidar_response_measurement_node_t * node, sl_u32 timeout = DEFAULT_TIMEOUT)
+        float _getScanSampleDuration(sl_u16 scanMode)
         {
-            int  recvPos = 0;
-            sl_u32 startTs = getms();
-            sl_u8  recvBuffer[sizeof(sl_lidar_response_measurement_node_t)];
-            sl_u8 *nodeBuffer = (sl_u8*)node;
-            sl_u32 waitTime;
-
-            while ((waitTime = getms() - startTs) <= timeout) {
-                size_t remainSize = sizeof(sl_lidar_response_measurement_node_t) - recvPos;
-                size_t recvSize;
-
-                bool ans = _channel->waitForData(remainSize, timeout - waitTime, &recvSize);
-                if (!ans) return SL_RESULT_OPERATION_FAIL;
+            bool ifSupportLidarConf = false;
+            float sample_duration = 0;
+            if (SL_IS_OK(checkSupportConfigCommands(ifSupportLidarConf)) && ifSupportLidarConf
+                && SL_IS_OK(getLidarSampleDuration(sample_duration, scanMode))) {
+                return sample_duration;
+            }
+            return scanMode == SL_LIDAR_CONF_SCAN_COMMAND_STD ? _cached_sampleduration_std : _cached_sampleduration_express;
+        }
 
-                if (recvSize > remainSize) recvSize = remainSize;
+        sl_result _prepareScanBuffers(float sample_duration)
+        {
+            typedef sl_lidar_response_measurement_node_hq_t node_hq_t;
+            typedef rp::hal::Arena Arena;
 
-                recvSize = _channel->read(recvBuffer, recvSize);
+            size_t scan_nodes = _scan_buffer_limit;
+            if (sample_duration > 0) {
+                scan_nodes = std::min(scan_nodes, (size_t)(1000000.f / (sample_duration * MIN_SCAN_FREQUENCY)) + 1);
+            }
+            size_t interval_nodes = rp::hal::SpscRing<node_hq_t>::roundCapacity(_interval_buffer_nodes ? _interval_buffer_nodes : scan_nodes * 2);
 
-                for (size_t pos = 0; pos < recvSize; ++pos) {
-                    sl_u8 currentByte = recvBuffer[pos];
-                    switch (recvPos) {
-                    case 0: // expect the sync bit and its reverse in this byte
-                    {
-                        sl_u8 tmp = (currentByte >> 1);
-                        if ((tmp ^ currentByte) & 0x1) {
-                            // pass
-                        }
-                        else {
-                            continue;
-                        }
+            // the previous capsules belong to the last session, whatever mode it was running
+            _is_previous_capsuledataRdy = false;
+            _is_previous_HqdataRdy = false;
+            _hq_clock_synced = false;
+            _last_node_ns = 0;
+            _revolution_start_ns = 0;
+            _sample_duration_ns = (sl_u64)((sample_duration > 0 ? sample_duration : (float)LEGACY_SAMPLE_DURATION) * 1000);
+
+            // the Cartesian coordinates are computed from the SoA arrays
+            sl_u32 array_flags = _publish_flags & (SCAN_PUBLISH_SOA | SCAN_PUBLISH_CARTESIAN);
+            if (array_flags & SCAN_PUBLISH_CARTESIAN) array_flags |= SCAN_PUBLISH_SOA;
+
+            if (scan_nodes == _max_scan_nodes && interval_nodes == _intervalRing.capacity() && array_flags == _array_flags
+                && _view_count == _layout_view_count) {
+                return SL_RESULT_OK;
+            }
+            if (!_scan_pool.reset(_scan_write_slot)) {
+                // a consumer still holds a scan lease, keep the current layout if it is large enough
+                if (scan_nodes <= _max_scan_nodes && interval_nodes == _intervalRing.capacity() && !(array_flags & ~_array_flags)
+                    && _view_count <= _layout_view_count) return SL_RESULT_OK;
+                return SL_RESULT_OPERATION_FAIL;
+            }
 
-                    }
-                    break;
-                    case 1: // expect the highest bit to be 1
-                    {
-                        if (currentByte & SL_LIDAR_RESP_MEASUREMENT_CHECKBIT) {
-                            // pass
-                        }
-                        else {
-                            recvPos = 0;
-                            continue;
-                        }
-                    }
-                    break;
-                    }
-                    nodeBuffer[recvPos++] = currentByte;
+            size_t slot_arrays_size = 0;
+            if (array_flags & SCAN_PUBLISH_SOA) {
+                slot_arrays_size += Arena::sectionSize(sizeof(sl_u16) * scan_nodes)
+                    + Arena::sectionSize(sizeof(sl_u32) * scan_nodes)
+                    + Arena::sectionSize(sizeof(sl_u8) * scan_nodes);
+            }
+            if (array_flags & SCAN_PUBLISH_CARTESIAN) {
+                slot_arrays_size += Arena::sectionSize(sizeof(float) * scan_nodes) * 2;
+            }
+            slot_arrays_size += (Arena::sectionSize(sizeof(node_hq_t) * scan_nodes) + Arena::sectionSize(sizeof(sl_u64) * scan_nodes)) * _view_count;
+
+            size_t arena_size = Arena::sectionSize(sizeof(node_hq_t) * scan_nodes) * rp::hal::LeasePoolIndex::SLOT_COUNT
+                + Arena::sectionSize(sizeof(sl_u64) * scan_nodes) * rp::hal::LeasePoolIndex::SLOT_COUNT
+                + slot_arrays_size * rp::hal::LeasePoolIndex::SLOT_COUNT
+                + Arena::sectionSize(sizeof(node_hq_t) * scan_nodes)
+                + Arena::sectionSize(sizeof(sl_u64) * scan_nodes)
+                + Arena::sectionSize(sizeof(node_hq_t) * interval_nodes)
+                + Arena::sectionSize(sizeof(node_hq_t) * DECODE_BUFFER_NODES)
+                + Arena::sectionSize(sizeof(sl_u64) * DECODE_BUFFER_NODES)
+                + Arena::sectionSize(sizeof(sl_lidar_response_measurement_node_t) * DECODE_BUFFER_NODES)
+                + Arena::sectionSize(sizeof(CapsuleHistory))
+                + (_view_count ? Arena::sectionSize(sizeof(sl_u32) * scan_view::MAX_BINS) : 0);
+
+            _intervalRing.attach(NULL, 0);
+            _max_scan_nodes = 0;
+            _array_flags = 0;
+            _layout_view_count = 0;
+            if (!_scan_arena.reset(arena_size)) {
+                return SL_RESULT_INSUFFICIENT_MEMORY;
+            }
 
-                    if (recvPos == sizeof(sl_lidar_response_measurement_node_t)) {
-                        return SL_RESULT_OK;
-                    }
+            for (int i = 0; i < rp::hal::LeasePoolIndex::SLOT_COUNT; ++i) {
+                _scan_slot_buf[i] = _scan_arena.allocate<node_hq_t>(scan_nodes);
+                _scan_slot_ts[i] = _scan_arena.allocate<sl_u64>(scan_nodes);
+                _scan_slot_info[i].nodes = _scan_slot_buf[i];
+                _scan_slot_info[i].timestamps_ns = _scan_slot_ts[i];
+                _scan_slot_info[i].count = 0;
+
+                ScanSlotArrays & arrays = _scan_slot_arrays[i];
+                bool soa = (array_flags & SCAN_PUBLISH_SOA) != 0;
+                bool cartesian = (array_flags & SCAN_PUBLISH_CARTESIAN) != 0;
+                arrays.angle_q14 = soa ? _scan_arena.allocate<sl_u16>(scan_nodes) : NULL;
+                arrays.dist_q2 = soa ? _scan_arena.allocate<sl_u32>(scan_nodes) : NULL;
+                arrays.quality = soa ? _scan_arena.allocate<sl_u8>(scan_nodes) : NULL;
+                arrays.x = cartesian ? _scan_arena.allocate<float>(scan_nodes) : NULL;
+                arrays.y = cartesian ? _scan_arena.allocate<float>(scan_nodes) : NULL;
+                for (size_t view = 0; view < LIDAR_MAX_SCAN_VIEWS; ++view) {
+                    arrays.view_nodes[view] = view < _view_count ? _scan_arena.allocate<node_hq_t>(scan_nodes) : NULL;
+                    arrays.view_ts[view] = view < _view_count ? _scan_arena.allocate<sl_u64>(scan_nodes) : NULL;
                 }
             }
+            _intervalRing.attach(_scan_arena.allocate<node_hq_t>(interval_nodes), interval_nodes);
+            _decode_buf = _scan_arena.allocate<node_hq_t>(DECODE_BUFFER_NODES);
+            _decode_ts = _scan_arena.allocate<sl_u64>(DECODE_BUFFER_NODES);
+            _decode_buf_std = _scan_arena.allocate<sl_lidar_response_measurement_node_t>(DECODE_BUFFER_NODES);
+            _capsule_history = _scan_arena.allocate<CapsuleHistory>(1);
+            _sort_scratch_buf = _scan_arena.allocate<node_hq_t>(scan_nodes);
+            _sort_scratch_ts = _scan_arena.allocate<sl_u64>(scan_nodes);
+            _max_scan_nodes = scan_nodes;
+            _array_flags = array_flags;
+            _view_bins = _view_count ? _scan_arena.allocate<sl_u32>(scan_view::MAX_BINS) : NULL;
+            _layout_view_count = _view_count;
+            return SL_RESULT_OK;
+        }
 
-            return SL_RESULT_OPERATION_TIMEOUT;
+        sl_result _waitNode(sl_lidar_response_measurement_node_t * node, sl_u64 & timestamp, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            const sl_u8 * frame;
+            size_t skipped;
+            sl_result ans = _waitFrame(LIDAR_FRAME_MEASUREMENT_NODE, frame, skipped, timeout);
+            if (ans == SL_RESULT_OPERATION_TIMEOUT) return SL_RESULT_OPERATION_FAIL;
+            if (SL_IS_FAIL(ans)) return ans;
+
+            memcpy(node, frame, sizeof(sl_lidar_response_measurement_node_t));
+            timestamp = _frameSampleTime(frame, LIDAR_FRAME_MEASUREMENT_NODE, 1);
+            return SL_RESULT_OK;
         }
 
-        sl_result _waitScanData(sl_lidar_response_measurement_node_t * nodebuffer, size_t & count, sl_u32 timeout = DEFAULT_TIMEOUT)
+        sl_result _waitScanData(sl_lidar_response_measurement_node_t * nodebuffer, sl_u64 * timestamps, size_t & count, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             if (!_isConnected) {
                 count = 0;
@@ -1244,380 +1558,393 @@ namespace sl {
 
             while ((waitTime = getms() - startTs) <= timeout && recvNodeCount < count) {
                 sl_lidar_response_measurement_node_t node;
-                ans = _waitNode(&node, timeout - waitTime);
+                ans = _waitNode(&node, timestamps[recvNodeCount], timeout - waitTime);
                 if (!ans) return ans;
 
                 nodebuffer[recvNodeCount++] = node;
 
                 if (recvNodeCount == count) return SL_RESULT_OK;
+
+                // hand over what the channel delivered so far rather than waiting for a full buffer
+                if (_rxRing.size() < LidarRxRing::frameSize(LIDAR_FRAME_MEASUREMENT_NODE)) {
+                    count = recvNodeCount;
+                    return SL_RESULT_OK;
+                }
             }
             count = recvNodeCount;
             return SL_RESULT_OPERATION_TIMEOUT;
         }
 
-        sl_result _cacheScanData()
+        sl_result _waitScanSlot(sl_u64 after_sequence, int & slot, sl_u32 timeout)
         {
+            sl_u32 startTs = getms();
+            sl_u32 waitTime;
 
-            sl_lidar_response_measurement_node_t      local_buf[256];
-            size_t                                   count = 256;
-            sl_lidar_response_measurement_node_hq_t   local_scan[MAX_SCAN_NODES];
-            size_t                                   scan_count = 0;
-            Result<nullptr_t>                        ans = SL_RESULT_OK;
-            memset(local_scan, 0, sizeof(local_scan));
-
-            _waitScanData(local_buf, count); // // always discard the first data since it may be incomplete
-
-            while (_isScanning) {
-                ans = _waitScanData(local_buf, count);
-   
-                if (!ans) {
-                    if ((sl_result)ans != SL_RESULT_OPERATION_TIMEOUT) {
-                        _isScanning = false;
-                        return SL_RESULT_OPERATION_FAIL;
-                    }
+            for (;;) {
+                slot = _scan_pool.acquireLatest();
+                if (slot != rp::hal::LeasePoolIndex::INVALID_SLOT) {
+                    if (_scan_slot_info[slot].sequence > after_sequence) return SL_RESULT_OK;
+                    _scan_pool.release(slot);
                 }
 
-                for (size_t pos = 0; pos < count; ++pos) {
-                    if (local_buf[pos].sync_quality & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) {
-                        // only publish the data when it contains a full 360 degree scan 
-
-                        if ((local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                            _lock.lock();
-                            memcpy(_cached_scan_node_hq_buf, local_scan, scan_count * sizeof(sl_lidar_response_measurement_node_hq_t));
-                            _cached_scan_node_hq_count = scan_count;
-                            _dataEvt.set();
-                            _lock.unlock();
-                        }
-                        scan_count = 0;
-                    }
+                waitTime = getms() - startTs;
+                if (waitTime >= timeout) return SL_RESULT_OPERATION_TIMEOUT;
 
-                    sl_lidar_response_measurement_node_hq_t nodeHq;
-                    convert(local_buf[pos], nodeHq);
-                    local_scan[scan_count++] = nodeHq;
-                    if (scan_count == _countof(local_scan)) scan_count -= 1; // prevent overflow
+                unsigned long ans = _dataEvt.wait(timeout - waitTime);
+                if (ans == (unsigned long)rp::hal::Event::EVENT_TIMEOUT) return SL_RESULT_OPERATION_TIMEOUT;
+                if (ans != (unsigned long)rp::hal::Event::EVENT_OK) return SL_RESULT_OPERATION_FAIL;
+            }
+        }
 
-                    //for interval retrieve
-                    {
-                        rp::hal::AutoLocker l(_lock);
-                        _cached_scan_node_hq_buf_for_interval_retrieve[_cached_scan_node_hq_count_for_interval_retrieve++] = nodeHq;
-                        if (_cached_scan_node_hq_count_for_interval_retrieve == _countof(_cached_scan_node_hq_buf_for_interval_retrieve)) _cached_scan_node_hq_count_for_interval_retrieve -= 1; // prevent overflow
+        void _cacheScanNode(const sl_lidar_response_measurement_node_hq_t & node, sl_u64 timestamp, size_t & scan_count)
+        {
+            sl_lidar_response_measurement_node_hq_t * local_scan = _scan_slot_buf[_scan_write_slot];
+            sl_u64 * local_ts = _scan_slot_ts[_scan_write_slot];
+
+            if (node.flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) {
+                // only publish the data when it contains a full 360 degree scan
+                if (scan_count && (local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                    _emitScanSector(scan_count);
+                    _countRevolution(local_ts[0], scan_count);
+
+                    // the scan has been written in place, publishing it is just a slot swap.
+                    // If every other slot is still leased the scan is dropped and the slot gets refilled.
+                    int next_slot = _scan_pool.claim();
+                    if (next_slot != rp::hal::LeasePoolIndex::INVALID_SLOT) {
+                        LidarScanBuffer & scan = _scan_slot_info[_scan_write_slot];
+                        scan.count = scan_count;
+                        scan.sequence = ++_scan_sequence;
+                        scan.timestamp_us = getus();
+                        scan.start_ns = local_ts[0];
+                        scan.end_ns = local_ts[scan_count - 1];
+                        _applyPublishOptions(_scan_write_slot);
+                        _scan_pool.publish(_scan_write_slot);
+                        _scan_write_slot = next_slot;
+                        _dataEvt.set();
+                        _countPublishLatency();
+                        local_scan = _scan_slot_buf[_scan_write_slot];
+                        local_ts = _scan_slot_ts[_scan_write_slot];
+                    }
+                    else {
+                        _countStat(_stats.revolutions_dropped);
                     }
                 }
+                scan_count = 0;
+                _sector_begin = 0;
+                _sector_index = 0;
             }
-            _isScanning = false;
-            return SL_RESULT_OK;
+            else if (_sector_listener && scan_count && (local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+                // the angles may step back a little, a sector is only closed once a node lies past it
+                int index = (int)(node.angle_z_q14 / _sector_width_q14);
+                if (index > _sector_index) {
+                    _emitScanSector(scan_count);
+                    _sector_begin = scan_count;
+                    _sector_index = index;
+                }
+            }
+            // the estimate of a chunk may reach back before the previous one, keep the times ascending
+            if (timestamp < _last_node_ns) timestamp = _last_node_ns;
+            _last_node_ns = timestamp;
+
+            local_ts[scan_count] = timestamp;
+            local_scan[scan_count++] = node;
+            if (scan_count == _max_scan_nodes) scan_count -= 1; // prevent overflow
+
+            //for interval retrieve, the node is dropped and counted if the consumer falls behind
+            _intervalRing.push(node);
         }
 
-        void _ultraCapsuleToNormal(const sl_lidar_response_ultra_capsule_measurement_nodes_t & capsule, sl_lidar_response_measurement_node_hq_t *nodebuffer, size_t &nodeCount)
+        static void _countStat(std::atomic<sl_u64> & counter, sl_u64 value = 1)
         {
-            nodeCount = 0;
-            if (_is_previous_capsuledataRdy) {
-                int diffAngle_q8;
-                int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
-                int prevStartAngle_q8 = ((_cached_previous_ultracapsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
 
-                diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
-                if (prevStartAngle_q8 > currentStartAngle_q8) {
-                    diffAngle_q8 += (360 << 8);
-                }
+        void _countRevolution(sl_u64 start_ns, size_t count)
+        {
+            _countStat(_stats.revolutions);
+            _stats.points_per_revolution.store(count, std::memory_order_relaxed);
+            if (_revolution_start_ns && start_ns > _revolution_start_ns) {
+                _stats.revolution_period_ns.store(start_ns - _revolution_start_ns, std::memory_order_relaxed);
+            }
+            _revolution_start_ns = start_ns;
+        }
 
-                int angleInc_q16 = (diffAngle_q8 << 3) / 3;
-                int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
-                for (size_t pos = 0; pos < _countof(_cached_previous_ultracapsuledata.ultra_cabins); ++pos) {
-                    int dist_q2[3];
-                    int angle_q6[3];
-                    int syncBit[3];
+        // from the arrival of the frame which completed the scan to now
+        void _countPublishLatency()
+        {
+            sl_u64 latency_us = (getns() - _frame_arrival_ns) / 1000;
+            int bucket = 0;
+            while (bucket < LIDAR_LATENCY_HISTOGRAM_BUCKETS - 1 && latency_us >= ((sl_u64)64 << bucket)) ++bucket;
+            _countStat(_stats.publish_latency[bucket]);
+        }
 
+        // sort and convert a completed scan according to _publish_flags, before it is published
+        void _applyPublishOptions(int slot)
+        {
+            LidarScanBuffer & scan = _scan_slot_info[slot];
+            ScanSlotArrays & arrays = _scan_slot_arrays[slot];
 
-                    sl_u32 combined_x3 = _cached_previous_ultracapsuledata.ultra_cabins[pos].combined_x3;
+            scan.publish_flags = 0;
+            if ((_publish_flags & SCAN_PUBLISH_SORTED)
+                && SL_IS_OK(scan_order::ascendQ14(_scan_slot_buf[slot], _scan_slot_ts[slot], scan.count, _sort_scratch_buf, _sort_scratch_ts))) {
+                scan.publish_flags |= SCAN_PUBLISH_SORTED;
+            }
 
-                    // unpack ...
-                    int dist_major = (combined_x3 & 0xFFF);
+            // the views are filtered from the sorted scan, they keep its order
+            for (size_t view = 0; view < _view_count; ++view) {
+                LidarScanView & result = _scan_slot_views[slot][view];
+                result.nodes = arrays.view_nodes[view];
+                result.timestamps_ns = arrays.view_ts[view];
+                result.count = scan_view::apply(_view_filters[view], scan.nodes, scan.timestamps_ns, scan.count,
+                    arrays.view_nodes[view], arrays.view_ts[view], _view_bins);
+            }
+            scan.view_count = _view_count;
+
+            scan.angle_q14 = NULL;
+            scan.dist_q2 = NULL;
+            scan.quality = NULL;
+            scan.x = NULL;
+            scan.y = NULL;
+            if (!(_publish_flags & (SCAN_PUBLISH_SOA | SCAN_PUBLISH_CARTESIAN))) return;
+
+            scan_soa::splitNodes(scan.nodes, scan.count, arrays.angle_q14, arrays.dist_q2, arrays.quality);
+            scan.angle_q14 = arrays.angle_q14;
+            scan.dist_q2 = arrays.dist_q2;
+            scan.quality = arrays.quality;
+            scan.publish_flags |= SCAN_PUBLISH_SOA;
+
+            if (_publish_flags & SCAN_PUBLISH_CARTESIAN) {
+                scan_soa::toCartesian(arrays.angle_q14, arrays.dist_q2, scan.count, arrays.x, arrays.y);
+                scan.x = arrays.x;
+                scan.y = arrays.y;
+                scan.publish_flags |= SCAN_PUBLISH_CARTESIAN;
+            }
+        }
 
-                    // signed partical integer, using the magic shift here
-                    // DO NOT TOUCH
+        // hand the nodes of the current sector, [_sector_begin, end) of the scan being written, to the listener
+        void _emitScanSector(size_t end)
+        {
+            if (!_sector_listener || end <= _sector_begin) return;
+
+            LidarScanSector sector;
+            sector.nodes = _scan_slot_buf[_scan_write_slot] + _sector_begin;
+            sector.timestamps_ns = _scan_slot_ts[_scan_write_slot] + _sector_begin;
+            sector.count = end - _sector_begin;
+            sector.scan_sequence = _scan_sequence + 1;
+            sector.index = _sector_index;
+            sector.start_angle = _sector_index * _sector_degrees;
+            sector.end_angle = std::min(360.f, sector.start_angle + _sector_degrees);
+            sector.start_ns = sector.timestamps_ns[0];
+            sector.end_ns = sector.timestamps_ns[sector.count - 1];
+            _sector_listener->onScanSector(sector);
+        }
 
-                    int dist_predict1 = (((int)(combined_x3 << 10)) >> 22);
-                    int dist_predict2 = (((int)combined_x3) >> 22);
+        void _notifyIntervalConsumer()
+        {
+            // called once per decoded batch rather than per node
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_interval_waiting.load(std::memory_order_relaxed) && _interval_waiting.exchange(false)) {
+                _intervalEvt.set();
+            }
+        }
 
-                    int dist_major2;
+        // sampling time of the last sample carried by a frame, estimated from the arrival time of its chunk:
+        // the frames received after it in the same chunk have been sampled later
+        sl_u64 _frameSampleTime(const sl_u8 * frame, LidarFrameType type, size_t samples)
+        {
+            size_t trailing;
+            sl_u64 arrival = _rxRing.arrivalTime(frame, &trailing);
+            size_t frame_size = LidarRxRing::frameSize(type);
+            size_t later_frames = trailing > frame_size ? (trailing - frame_size) / frame_size : 0;
+            return arrival - (sl_u64)later_frames * samples * _sample_duration_ns;
+        }
 
-                    sl_u32 scalelvl1, scalelvl2;
+        // map the device clock of a HQ capsule (in microseconds) onto the host clock
+        // The offset between both clocks is the smallest transfer delay seen so far. It may grow a little
+        // with every capsule to follow a drift of the device clock, and it is reset when the device clock jumps.
+        bool _stampHqNodes(const sl_lidar_response_hq_capsule_measurement_nodes_t & capsule, sl_u64 host_last, size_t count)
+        {
+            if (!capsule.time_stamp) return false; // the device does not report its clock
 
-                    // prefetch next ...
-                    if (pos == _countof(_cached_previous_ultracapsuledata.ultra_cabins) - 1) {
-                        dist_major2 = (capsule.ultra_cabins[0].combined_x3 & 0xFFF);
-                    }
-                    else {
-                        dist_major2 = (_cached_previous_ultracapsuledata.ultra_cabins[pos + 1].combined_x3 & 0xFFF);
-                    }
+            sl_s64 device_first = (sl_s64)(capsule.time_stamp * 1000);
+            sl_s64 offset = (sl_s64)host_last - (device_first + (sl_s64)((count - 1) * _sample_duration_ns));
+            if (!_hq_clock_synced || offset > _hq_clock_offset_ns + HQ_CLOCK_RESYNC_NS) {
+                _hq_clock_offset_ns = offset;
+                _hq_clock_synced = true;
+            }
+            else {
+                _hq_clock_offset_ns = std::min<sl_s64>(_hq_clock_offset_ns + HQ_CLOCK_DRIFT_NS, offset);
+            }
 
-                    // decode with the var bit scale ...
-                    dist_major = _varbitscale_decode(dist_major, scalelvl1);
-                    dist_major2 = _varbitscale_decode(dist_major2, scalelvl2);
+            for (size_t pos = 0; pos < count; ++pos) {
+                _decode_ts[pos] = (sl_u64)(device_first + _hq_clock_offset_ns) + pos * _sample_duration_ns;
+            }
+            return true;
+        }
 
+        // fill _decode_ts for the count nodes decoded from frame in the running scan mode
+        void _stampDecodedNodes(const sl_u8 * frame, size_t count)
+        {
+            if (!count) return;
+
+            sl_u64 last = _frameSampleTime(frame, _scan_frame_type, count);
+            switch (_scan_frame_type) {
+            case LIDAR_FRAME_CAPSULE:
+            case LIDAR_FRAME_ULTRA_CAPSULE:
+                // express capsules are decoded against the next one, the nodes have been sampled one frame earlier
+                last -= count * _sample_duration_ns;
+                break;
+            case LIDAR_FRAME_HQ_CAPSULE:
+                if (_stampHqNodes(*reinterpret_cast<const sl_lidar_response_hq_capsule_measurement_nodes_t *>(frame), last, count)) return;
+                break;
+            default:
+                break;
+            }
 
-                    int dist_base1 = dist_major;
-                    int dist_base2 = dist_major2;
+            for (size_t pos = 0; pos < count; ++pos) {
+                _decode_ts[pos] = last - (count - 1 - pos) * _sample_duration_ns;
+            }
+        }
 
-                    if ((!dist_major) && dist_major2) {
-                        dist_base1 = dist_major2;
-                        scalelvl1 = scalelvl2;
+        // decode one frame of the running scan mode into _decode_buf, used by the external pump
+        size_t _decodeScanFrame(const sl_u8 * frame)
+        {
+            size_t count = 0;
+            switch (_scan_frame_type) {
+            case LIDAR_FRAME_MEASUREMENT_NODE:
+                convert(*reinterpret_cast<const sl_lidar_response_measurement_node_t *>(frame), _decode_buf[0]);
+                count = 1;
+                break;
+            case LIDAR_FRAME_CAPSULE:
+                {
+                    const sl_lidar_response_capsule_measurement_nodes_t * capsule = reinterpret_cast<const sl_lidar_response_capsule_measurement_nodes_t *>(frame);
+                    if (capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
+                        _scan_node_synced = false;
+                        _is_previous_capsuledataRdy = false;
                     }
-
-
-                    dist_q2[0] = (dist_major << 2);
-                    if ((dist_predict1 == 0xFFFFFE00) || (dist_predict1 == 0x1FF)) {
-                        dist_q2[1] = 0;
+                    if (_cached_capsule_flag == DENSE_CAPSULE) {
+                        _dense_capsuleToNormal(*capsule, _decode_buf, count);
                     }
                     else {
-                        dist_predict1 = (dist_predict1 << scalelvl1);
-                        dist_q2[1] = (dist_predict1 + dist_base1) << 2;
-
-                    }
-
-                    if ((dist_predict2 == 0xFFFFFE00) || (dist_predict2 == 0x1FF)) {
-                        dist_q2[2] = 0;
+                        _capsuleToNormal(*capsule, _decode_buf, count);
                     }
-                    else {
-                        dist_predict2 = (dist_predict2 << scalelvl2);
-                        dist_q2[2] = (dist_predict2 + dist_base2) << 2;
+                }
+                break;
+            case LIDAR_FRAME_ULTRA_CAPSULE:
+                {
+                    const sl_lidar_response_ultra_capsule_measurement_nodes_t * capsule = reinterpret_cast<const sl_lidar_response_ultra_capsule_measurement_nodes_t *>(frame);
+                    if (capsule->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
+                        _is_previous_capsuledataRdy = false;
                     }
+                    _ultraCapsuleToNormal(*capsule, _decode_buf, count);
+                }
+                break;
+            case LIDAR_FRAME_HQ_CAPSULE:
+                _is_previous_HqdataRdy = true;
+                _HqToNormal(*reinterpret_cast<const sl_lidar_response_hq_capsule_measurement_nodes_t *>(frame), _decode_buf, count);
+                break;
+            default:
+                break;
+            }
+            return count;
+        }
 
+        sl_result _cacheScanData()
+        {
 
-                    for (int cpos = 0; cpos < 3; ++cpos) {
-                        syncBit[cpos] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
-
-                        int offsetAngleMean_q16 = (int)(7.5 * 3.1415926535 * (1 << 16) / 180.0);
-
-                        if (dist_q2[cpos] >= (50 * 4))
-                        {
-                            const int k1 = 98361;
-                            const int k2 = int(k1 / dist_q2[cpos]);
-
-                            offsetAngleMean_q16 = (int)(8 * 3.1415926535 * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
-                        }
-
-                        angle_q6[cpos] = ((currentAngle_raw_q16 - int(offsetAngleMean_q16 * 180 / 3.14159265)) >> 10);
-                        currentAngle_raw_q16 += angleInc_q16;
-
-                        if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
-                        if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
-
-                        sl_lidar_response_measurement_node_hq_t node;
+            sl_lidar_response_measurement_node_t    * local_buf = _decode_buf_std;
+            size_t                                   count = DECODE_BUFFER_NODES;
+            size_t                                   scan_count = 0;
+            Result<nullptr_t>                        ans = SL_RESULT_OK;
 
-                        node.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
-                        node.quality = dist_q2[cpos] ? (0x2F << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
-                        node.angle_z_q14 = sl_u16((angle_q6[cpos] << 8) / 90);
-                        node.dist_mm_q2 = dist_q2[cpos];
+            _waitScanData(local_buf, _decode_ts, count); // // always discard the first data since it may be incomplete
 
-                        nodebuffer[nodeCount++] = node;
+            while (_isScanning) {
+                count = DECODE_BUFFER_NODES;
+                ans = _waitScanData(local_buf, _decode_ts, count);
+   
+                if (!ans) {
+                    if ((sl_result)ans != SL_RESULT_OPERATION_TIMEOUT) {
+                        _isScanning = false;
+                        return SL_RESULT_OPERATION_FAIL;
                     }
+                }
 
+                for (size_t pos = 0; pos < count; ++pos) {
+                    sl_lidar_response_measurement_node_hq_t nodeHq;
+                    convert(local_buf[pos], nodeHq);
+                    _cacheScanNode(nodeHq, _decode_ts[pos], scan_count);
                 }
+                _notifyIntervalConsumer();
             }
-
-            _cached_previous_ultracapsuledata = capsule;
-            _is_previous_capsuledataRdy = true;
+            _isScanning = false;
+            return SL_RESULT_OK;
         }
 
-        sl_result _waitCapsuledNode(sl_lidar_response_capsule_measurement_nodes_t & node, sl_u32 timeout = DEFAULT_TIMEOUT)
+        void _ultraCapsuleToNormal(const sl_lidar_response_ultra_capsule_measurement_nodes_t & capsule, sl_lidar_response_measurement_node_hq_t *nodebuffer, size_t &nodeCount)
         {
-            int  recvPos = 0;
-            sl_u32 startTs = getms();
-            sl_u8  recvBuffer[sizeof(sl_lidar_response_capsule_measurement_nodes_t)];
-            sl_u8 *nodeBuffer = (sl_u8*)&node;
-            sl_u32 waitTime;
-            while ((waitTime = getms() - startTs) <= timeout) {
-                size_t remainSize = sizeof(sl_lidar_response_capsule_measurement_nodes_t) - recvPos;
-                size_t recvSize;
-                bool ans = _channel->waitForData(remainSize, timeout - waitTime, &recvSize);
-                if (!ans) return SL_RESULT_OPERATION_TIMEOUT;
-
-                if (recvSize > remainSize) recvSize = remainSize;
-                recvSize = _channel->read(recvBuffer, recvSize);
+            nodeCount = 0;
+            if (_is_previous_capsuledataRdy) {
+                nodeCount = decoder::ultraCapsuleToNormal(_capsule_history->ultra_capsule, capsule, nodebuffer);
+            }
 
-                for (size_t pos = 0; pos < recvSize; ++pos) {
-                    sl_u8 currentByte = recvBuffer[pos];
+            _capsule_history->ultra_capsule = capsule;
+            _is_previous_capsuledataRdy = true;
+        }
 
-                    switch (recvPos) {
-                    case 0: // expect the sync bit 1
-                    {
-                        sl_u8 tmp = (currentByte >> 4);
-                        if (tmp == SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
-                            // pass
-                        }
-                        else {
-                            _is_previous_capsuledataRdy = false;
-                            continue;
-                        }
+        sl_result _waitCapsuledNode(const sl_lidar_response_capsule_measurement_nodes_t *& node, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            const sl_u8 * frame;
+            size_t skipped;
+            sl_result ans = _waitFrame(LIDAR_FRAME_CAPSULE, frame, skipped, timeout);
+
+            // any byte lost between two capsules breaks the angle interpolation with the previous one
+            if (skipped || SL_IS_FAIL(ans)) {
+                _is_previous_capsuledataRdy = false;
+                if (SL_IS_FAIL(ans)) return ans;
+            }
 
-                    }
-                    break;
-                    case 1: // expect the sync bit 2
-                    {
-                        sl_u8 tmp = (currentByte >> 4);
-                        if (tmp == SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
-                            // pass
-                        }
-                        else {
-                            recvPos = 0;
-                            _is_previous_capsuledataRdy = false;
-                            continue;
-                        }
-                    }
-                    break;
-                    }
-                    nodeBuffer[recvPos++] = currentByte;
-                    if (recvPos == sizeof(sl_lidar_response_capsule_measurement_nodes_t)) {
-                        // calc the checksum ...
-                        sl_u8 checksum = 0;
-                        sl_u8 recvChecksum = ((node.s_checksum_1 & 0xF) | (node.s_checksum_2 << 4));
-                        for (size_t cpos = offsetof(sl_lidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
-                            cpos < sizeof(sl_lidar_response_capsule_measurement_nodes_t); ++cpos)
-                        {
-                            checksum ^= nodeBuffer[cpos];
-                        }
-                        if (recvChecksum == checksum) {
-                            // only consider vaild if the checksum matches...
-                            if (node.start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
-                                // this is the first capsule frame in logic, discard the previous cached data...
-                                _scan_node_synced = false;
-                                _is_previous_capsuledataRdy = false;
-                                return SL_RESULT_OK;
-                            }
-                            return SL_RESULT_OK;
-                        }
-                        _is_previous_capsuledataRdy = false;
-                        return SL_RESULT_INVALID_DATA;
-                    }
-                }
+            node = reinterpret_cast<const sl_lidar_response_capsule_measurement_nodes_t *>(frame);
+            if (node->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
+                // this is the first capsule frame in logic, discard the previous cached data...
+                _scan_node_synced = false;
+                _is_previous_capsuledataRdy = false;
             }
-            _is_previous_capsuledataRdy = false;
-            return SL_RESULT_OPERATION_TIMEOUT;
+            return SL_RESULT_OK;
         }
         void _capsuleToNormal(const sl_lidar_response_capsule_measurement_nodes_t & capsule, sl_lidar_response_measurement_node_hq_t *nodebuffer, size_t &nodeCount)
         {
             nodeCount = 0;
             if (_is_previous_capsuledataRdy) {
-                int diffAngle_q8;
-                int currentStartAngle_q8 = ((capsule.start_angle_sync_q6 & 0x7FFF) << 2);
-                int prevStartAngle_q8 = ((_cached_previous_capsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
-
-                diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
-                if (prevStartAngle_q8 > currentStartAngle_q8) {
-                    diffAngle_q8 += (360 << 8);
-                }
-
-                int angleInc_q16 = (diffAngle_q8 << 3);
-                int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
-                for (size_t pos = 0; pos < _countof(_cached_previous_capsuledata.cabins); ++pos) {
-                    int dist_q2[2];
-                    int angle_q6[2];
-                    int syncBit[2];
-
-                    dist_q2[0] = (_cached_previous_capsuledata.cabins[pos].distance_angle_1 & 0xFFFC);
-                    dist_q2[1] = (_cached_previous_capsuledata.cabins[pos].distance_angle_2 & 0xFFFC);
-
-                    int angle_offset1_q3 = ((_cached_previous_capsuledata.cabins[pos].offset_angles_q3 & 0xF) | ((_cached_previous_capsuledata.cabins[pos].distance_angle_1 & 0x3) << 4));
-                    int angle_offset2_q3 = ((_cached_previous_capsuledata.cabins[pos].offset_angles_q3 >> 4) | ((_cached_previous_capsuledata.cabins[pos].distance_angle_2 & 0x3) << 4));
-
-                    angle_q6[0] = ((currentAngle_raw_q16 - (angle_offset1_q3 << 13)) >> 10);
-                    syncBit[0] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
-                    currentAngle_raw_q16 += angleInc_q16;
-
-
-                    angle_q6[1] = ((currentAngle_raw_q16 - (angle_offset2_q3 << 13)) >> 10);
-                    syncBit[1] = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < angleInc_q16) ? 1 : 0;
-                    currentAngle_raw_q16 += angleInc_q16;
-
-                    for (int cpos = 0; cpos < 2; ++cpos) {
-
-                        if (angle_q6[cpos] < 0) angle_q6[cpos] += (360 << 6);
-                        if (angle_q6[cpos] >= (360 << 6)) angle_q6[cpos] -= (360 << 6);
-
-                        sl_lidar_response_measurement_node_hq_t node;
-
-                        node.angle_z_q14 = sl_u16((angle_q6[cpos] << 8) / 90);
-                        node.flag = (syncBit[cpos] | ((!syncBit[cpos]) << 1));
-                        node.quality = dist_q2[cpos] ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
-                        node.dist_mm_q2 = dist_q2[cpos];
-
-                        nodebuffer[nodeCount++] = node;
-                    }
-
-                }
+                nodeCount = decoder::capsuleToNormal(_capsule_history->capsule, capsule, nodebuffer);
             }
 
-            _cached_previous_capsuledata = capsule;
+            _capsule_history->capsule = capsule;
             _is_previous_capsuledataRdy = true;
         }
 
         void _dense_capsuleToNormal(const sl_lidar_response_capsule_measurement_nodes_t & capsule, sl_lidar_response_measurement_node_hq_t *nodebuffer, size_t &nodeCount)
         {
-            static int lastNodeSyncBit = 0;
             const sl_lidar_response_dense_capsule_measurement_nodes_t *dense_capsule = reinterpret_cast<const sl_lidar_response_dense_capsule_measurement_nodes_t*>(&capsule);
             nodeCount = 0;
             if (_is_previous_capsuledataRdy) {
-                int diffAngle_q8;
-                int currentStartAngle_q8 = ((dense_capsule->start_angle_sync_q6 & 0x7FFF) << 2);
-                int prevStartAngle_q8 = ((_cached_previous_dense_capsuledata.start_angle_sync_q6 & 0x7FFF) << 2);
-
-                diffAngle_q8 = (currentStartAngle_q8)-(prevStartAngle_q8);
-                if (prevStartAngle_q8 > currentStartAngle_q8) {
-                    diffAngle_q8 += (360 << 8);
-                }
-
-                int angleInc_q16 = (diffAngle_q8 << 8) / 40;
-                int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
-                for (size_t pos = 0; pos < _countof(_cached_previous_dense_capsuledata.cabins); ++pos) {
-                    int dist_q2;
-                    int angle_q6;
-                    int syncBit;
-                    const int dist = static_cast<const int>(_cached_previous_dense_capsuledata.cabins[pos].distance);
-                    dist_q2 = dist << 2;
-                    angle_q6 = (currentAngle_raw_q16 >> 10);
-
-                    syncBit = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < (angleInc_q16<<1)) ? 1 : 0;
-                    syncBit = (syncBit^ lastNodeSyncBit)&syncBit;//Ensure that syncBit is exactly detected
-                    if (syncBit) {
-                        _scan_node_synced = true;
-                    }
-
-                    currentAngle_raw_q16 += angleInc_q16;
-
-                    if (angle_q6 < 0) angle_q6 += (360 << 6);
-                    if (angle_q6 >= (360 << 6)) angle_q6 -= (360 << 6);
-
-                    
-                    sl_lidar_response_measurement_node_hq_t node;
-
-                    node.angle_z_q14 = sl_u16((angle_q6 << 8) / 90);
-                    node.flag = (syncBit | ((!syncBit) << 1));
-                    node.quality = dist_q2 ? (0x2f << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
-                    node.dist_mm_q2 = dist_q2;
-                    if(_scan_node_synced)
-                        nodebuffer[nodeCount++] = node;
-                    lastNodeSyncBit = syncBit;
-                }
+                nodeCount = decoder::denseCapsuleToNormal(_capsule_history->dense_capsule, *dense_capsule, nodebuffer, _cached_dense_last_sync_bit, _scan_node_synced);
             }
             else {
                 _scan_node_synced = false;
             }
 
-            _cached_previous_dense_capsuledata = *dense_capsule;
+            _capsule_history->dense_capsule = *dense_capsule;
             _is_previous_capsuledataRdy = true;
         }
 
         sl_result _cacheCapsuledScanData()
         {
-            sl_lidar_response_capsule_measurement_nodes_t    capsule_node;
-            sl_lidar_response_measurement_node_hq_t          local_buf[256];
-            size_t                                           count = 256;
-            sl_lidar_response_measurement_node_hq_t          local_scan[MAX_SCAN_NODES];
+            const sl_lidar_response_capsule_measurement_nodes_t * capsule_node;
+            sl_lidar_response_measurement_node_hq_t        * local_buf = _decode_buf;
+            size_t                                           count = DECODE_BUFFER_NODES;
             size_t                                           scan_count = 0;
             Result<nullptr_t>                                ans = SL_RESULT_OK;  
-            memset(local_scan, 0, sizeof(local_scan));
 
             _waitCapsuledNode(capsule_node); // // always discard the first data since it may be incomplete
 
@@ -1635,136 +1962,62 @@ namespace sl {
                 }
                 switch (_cached_capsule_flag) {
                 case NORMAL_CAPSULE:
-                    _capsuleToNormal(capsule_node, local_buf, count);
+                    _capsuleToNormal(*capsule_node, local_buf, count);
                     break;
                 case DENSE_CAPSULE:
-                    _dense_capsuleToNormal(capsule_node, local_buf, count);
+                    _dense_capsuleToNormal(*capsule_node, local_buf, count);
                     break;
                 }
-                //
+                _stampDecodedNodes(reinterpret_cast<const sl_u8 *>(capsule_node), count);
 
                 for (size_t pos = 0; pos < count; ++pos) {
-                    if (local_buf[pos].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) {
-                        // only publish the data when it contains a full 360 degree scan 
-
-                        if ((local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                            _lock.lock();
-                            memcpy(_cached_scan_node_hq_buf, local_scan, scan_count * sizeof(sl_lidar_response_measurement_node_hq_t));
-                            _cached_scan_node_hq_count = scan_count;
-                            _dataEvt.set();
-                            _lock.unlock();
-                        }
-                        scan_count = 0;
-                    }
-                    local_scan[scan_count++] = local_buf[pos];
-                    if (scan_count == _countof(local_scan)) scan_count -= 1; // prevent overflow
-
-                    //for interval retrieve
-                    {
-                        rp::hal::AutoLocker l(_lock);
-                        _cached_scan_node_hq_buf_for_interval_retrieve[_cached_scan_node_hq_count_for_interval_retrieve++] = local_buf[pos];
-                        if (_cached_scan_node_hq_count_for_interval_retrieve == _countof(_cached_scan_node_hq_buf_for_interval_retrieve)) _cached_scan_node_hq_count_for_interval_retrieve -= 1; // prevent overflow
-                    }
+                    _cacheScanNode(local_buf[pos], _decode_ts[pos], scan_count);
                 }
+                _notifyIntervalConsumer();
             }
             _isScanning = false;
 
             return SL_RESULT_OK;
         }
 
-        sl_result _waitHqNode(sl_lidar_response_hq_capsule_measurement_nodes_t & node, sl_u32 timeout = DEFAULT_TIMEOUT)
+        sl_result _waitHqNode(const sl_lidar_response_hq_capsule_measurement_nodes_t *& node, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             if (!_isConnected) {
                 return SL_RESULT_OPERATION_FAIL;
             }
 
-            int  recvPos = 0;
-            sl_u32 startTs = getms();
-            sl_u8  recvBuffer[sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t)];
-            sl_u8 *nodeBuffer = (sl_u8*)&node;
-            sl_u32 waitTime;
-
-            while ((waitTime = getms() - startTs) <= timeout) {
-                size_t remainSize = sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - recvPos;
-                size_t recvSize;
-
-                bool ans = _channel->waitForData(remainSize, timeout - waitTime, &recvSize);
-                if (!ans){
-                    return SL_RESULT_OPERATION_TIMEOUT;
-                }
-                if (recvSize > remainSize) recvSize = remainSize;
-
-                recvSize = _channel->read(recvBuffer, recvSize);
-
-                for (size_t pos = 0; pos < recvSize; ++pos) {
-                    sl_u8 currentByte = recvBuffer[pos];
-                    switch (recvPos) {
-                    case 0: // expect the sync byte
-                    {
-                        sl_u8 tmp = (currentByte);
-                        if (tmp == SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC) {
-                            // pass
-                        }
-                        else {
-                            recvPos = 0;
-                            _is_previous_HqdataRdy = false;
-                            continue;
-                        }
-                    }
-                    break;
-                    case sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 1 - 4:
-                    {
-
-                    }
-                    break;
-                    case sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 1:
-                    {
-
-                    }
-                    break;
-                    }
-                    nodeBuffer[recvPos++] = currentByte;
-                    if (recvPos == sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t)) {
-                        sl_u32 crcCalc2 = crc32::getResult(nodeBuffer, sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 4);
-
-                        if (crcCalc2 == node.crc32) {
-                            _is_previous_HqdataRdy = true;
-                            return SL_RESULT_OK;
-                        }
-                        else {
-                            _is_previous_HqdataRdy = false;
-                            return SL_RESULT_INVALID_DATA;
-                        }
-
-                    }
-                }
+            const sl_u8 * frame;
+            size_t skipped;
+            sl_result ans = _waitFrame(LIDAR_FRAME_HQ_CAPSULE, frame, skipped, timeout);
+            if (SL_IS_FAIL(ans)) {
+                _is_previous_HqdataRdy = false;
+                return ans;
             }
-            _is_previous_HqdataRdy = false;
-            return SL_RESULT_OPERATION_TIMEOUT;
+
+            node = reinterpret_cast<const sl_lidar_response_hq_capsule_measurement_nodes_t *>(frame);
+            _is_previous_HqdataRdy = true;
+            return SL_RESULT_OK;
         }
 
         void _HqToNormal(const sl_lidar_response_hq_capsule_measurement_nodes_t & node_hq, sl_lidar_response_measurement_node_hq_t *nodebuffer, size_t &nodeCount)
         {
             nodeCount = 0;
             if (_is_previous_HqdataRdy) {
-                for (size_t pos = 0; pos < _countof(_cached_previous_Hqdata.node_hq); ++pos) {
+                for (size_t pos = 0; pos < _countof(node_hq.node_hq); ++pos) {
                     nodebuffer[nodeCount++] = node_hq.node_hq[pos];
                 }
             }
-            _cached_previous_Hqdata = node_hq;
             _is_previous_HqdataRdy = true;
 
         }
 
         sl_result _cacheHqScanData()
         {
-            sl_lidar_response_hq_capsule_measurement_nodes_t    hq_node;
-            sl_lidar_response_measurement_node_hq_t   local_buf[256];
-            size_t                                   count = 256;
-            sl_lidar_response_measurement_node_hq_t   local_scan[MAX_SCAN_NODES];
+            const sl_lidar_response_hq_capsule_measurement_nodes_t * hq_node;
+            sl_lidar_response_measurement_node_hq_t * local_buf = _decode_buf;
+            size_t                                   count = DECODE_BUFFER_NODES;
             size_t                                   scan_count = 0;
             Result<nullptr_t>                             ans = SL_RESULT_OK;
-            memset(local_scan, 0, sizeof(local_scan));
             _waitHqNode(hq_node);
             while (_isScanning) {
                 ans = _waitHqNode(hq_node);
@@ -1779,125 +2032,47 @@ namespace sl {
                     }
                 }
 
-                _HqToNormal(hq_node, local_buf, count);
-                for (size_t pos = 0; pos < count; ++pos){
-                    if (local_buf[pos].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT){
-                        // only publish the data when it contains a full 360 degree scan 
-                        if ((local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                            _lock.lock();
-                            memcpy(_cached_scan_node_hq_buf, local_scan, scan_count * sizeof(sl_lidar_response_measurement_node_hq_t));
-                            _cached_scan_node_hq_count = scan_count;
-                            _dataEvt.set();
-                            _lock.unlock();
-                        }
-                        scan_count = 0;
-                    }
-                    local_scan[scan_count++] = local_buf[pos];
-                    if (scan_count == _countof(local_scan)) scan_count -= 1; // prevent overflow
-                                                                             //for interval retrieve
-                    {
-                        rp::hal::AutoLocker l(_lock);
-                        _cached_scan_node_hq_buf_for_interval_retrieve[_cached_scan_node_hq_count_for_interval_retrieve++] = local_buf[pos];
-                        if (_cached_scan_node_hq_count_for_interval_retrieve == _countof(_cached_scan_node_hq_buf_for_interval_retrieve)) _cached_scan_node_hq_count_for_interval_retrieve -= 1; // prevent overflow
-                    }
+                _HqToNormal(*hq_node, local_buf, count);
+                _stampDecodedNodes(reinterpret_cast<const sl_u8 *>(hq_node), count);
+                for (size_t pos = 0; pos < count; ++pos) {
+                    _cacheScanNode(local_buf[pos], _decode_ts[pos], scan_count);
                 }
+                _notifyIntervalConsumer();
 
             }
             return SL_RESULT_OK;
         }
 
-        sl_result _waitUltraCapsuledNode(sl_lidar_response_ultra_capsule_measurement_nodes_t & node, sl_u32 timeout = DEFAULT_TIMEOUT)
+        sl_result _waitUltraCapsuledNode(const sl_lidar_response_ultra_capsule_measurement_nodes_t *& node, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             if (!_isConnected) {
                 return SL_RESULT_OPERATION_FAIL;
             }
 
-            int  recvPos = 0;
-            sl_u32 startTs = getms();
-            sl_u8  recvBuffer[sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t)];
-            sl_u8 *nodeBuffer = (sl_u8*)&node;
-            sl_u32 waitTime;
-
-            while ((waitTime = getms() - startTs) <= timeout) {
-                size_t remainSize = sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t) - recvPos;
-                size_t recvSize;
-
-                bool ans = _channel->waitForData(remainSize, timeout - waitTime, &recvSize);
-                if (!ans) {
-                    return SL_RESULT_OPERATION_TIMEOUT;
-                }
-                if (recvSize > remainSize) recvSize = remainSize;
+            const sl_u8 * frame;
+            size_t skipped;
+            sl_result ans = _waitFrame(LIDAR_FRAME_ULTRA_CAPSULE, frame, skipped, timeout);
 
-                recvSize = _channel->read(recvBuffer, recvSize);
+            if (skipped || SL_IS_FAIL(ans)) {
+                _is_previous_capsuledataRdy = false;
+                if (SL_IS_FAIL(ans)) return ans;
+            }
 
-                for (size_t pos = 0; pos < recvSize; ++pos) {
-                    sl_u8 currentByte = recvBuffer[pos];
-                    switch (recvPos) {
-                    case 0: // expect the sync bit 1
-                    {
-                        sl_u8 tmp = (currentByte >> 4);
-                        if (tmp == SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1) {
-                            // pass
-                        }
-                        else {
-                            _is_previous_capsuledataRdy = false;
-                            continue;
-                        }
-                    }
-                    break;
-                    case 1: // expect the sync bit 2
-                    {
-                        sl_u8 tmp = (currentByte >> 4);
-                        if (tmp == SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2) {
-                            // pass
-                        }
-                        else {
-                            recvPos = 0;
-                            _is_previous_capsuledataRdy = false;
-                            continue;
-                        }
-                    }
-                    break;
-                    }
-                    nodeBuffer[recvPos++] = currentByte;
-                    if (recvPos == sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t)) {
-                        // calc the checksum ...
-                        sl_u8 checksum = 0;
-                        sl_u8 recvChecksum = ((node.s_checksum_1 & 0xF) | (node.s_checksum_2 << 4));
-
-                        for (size_t cpos = offsetof(sl_lidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6);
-                            cpos < sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t); ++cpos) 
-                        {
-                            checksum ^= nodeBuffer[cpos];
-                        }
-
-                        if (recvChecksum == checksum) {
-                            // only consider vaild if the checksum matches...
-                            if (node.start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
-                                // this is the first capsule frame in logic, discard the previous cached data...
-                                _is_previous_capsuledataRdy = false;
-                                return SL_RESULT_OK;
-                            }
-                            return SL_RESULT_OK;
-                        }
-                        _is_previous_capsuledataRdy = false;
-                        return SL_RESULT_INVALID_DATA;
-                    }
-                }
+            node = reinterpret_cast<const sl_lidar_response_ultra_capsule_measurement_nodes_t *>(frame);
+            if (node->start_angle_sync_q6 & SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) {
+                // this is the first capsule frame in logic, discard the previous cached data...
+                _is_previous_capsuledataRdy = false;
             }
-            _is_previous_capsuledataRdy = false;
-            return SL_RESULT_OPERATION_TIMEOUT;
+            return SL_RESULT_OK;
         }
 
         sl_result _cacheUltraCapsuledScanData()
         {
-            sl_lidar_response_ultra_capsule_measurement_nodes_t    ultra_capsule_node;
-            sl_lidar_response_measurement_node_hq_t   local_buf[256];
-            size_t                                   count = 256;
-            sl_lidar_response_measurement_node_hq_t   local_scan[MAX_SCAN_NODES];
+            const sl_lidar_response_ultra_capsule_measurement_nodes_t * ultra_capsule_node;
+            sl_lidar_response_measurement_node_hq_t * local_buf = _decode_buf;
+            size_t                                   count = DECODE_BUFFER_NODES;
             size_t                                   scan_count = 0;
             Result<nullptr_t>                        ans = SL_RESULT_OK;
-            memset(local_scan, 0, sizeof(local_scan));
 
             _waitUltraCapsuledNode(ultra_capsule_node);
 
@@ -1914,31 +2089,13 @@ namespace sl {
                     }
                 }
 
-                _ultraCapsuleToNormal(ultra_capsule_node, local_buf, count);
+                _ultraCapsuleToNormal(*ultra_capsule_node, local_buf, count);
+                _stampDecodedNodes(reinterpret_cast<const sl_u8 *>(ultra_capsule_node), count);
 
                 for (size_t pos = 0; pos < count; ++pos) {
-                    if (local_buf[pos].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT) {
-                        // only publish the data when it contains a full 360 degree scan 
-
-                        if ((local_scan[0].flag & SL_LIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                            _lock.lock();
-                            memcpy(_cached_scan_node_hq_buf, local_scan, scan_count * sizeof(sl_lidar_response_measurement_node_hq_t));
-                            _cached_scan_node_hq_count = scan_count;
-                            _dataEvt.set();
-                            _lock.unlock();
-                        }
-                        scan_count = 0;
-                    }
-                    local_scan[scan_count++] = local_buf[pos];
-                    if (scan_count == _countof(local_scan)) scan_count -= 1; // prevent overflow
-
-                    //for interval retrieve
-                    {
-                        rp::hal::AutoLocker l(_lock);
-                        _cached_scan_node_hq_buf_for_interval_retrieve[_cached_scan_node_hq_count_for_interval_retrieve++] = local_buf[pos];
-                        if (_cached_scan_node_hq_count_for_interval_retrieve == _countof(_cached_scan_node_hq_buf_for_interval_retrieve)) _cached_scan_node_hq_count_for_interval_retrieve -= 1; // prevent overflow
-                    }
+                    _cacheScanNode(local_buf[pos], _decode_ts[pos], scan_count);
                 }
+                _notifyIntervalConsumer();
             }
 
             _isScanning = false;
@@ -1950,6 +2107,7 @@ namespace sl {
             if (!isConnected())
                 return SL_RESULT_OPERATION_FAIL;
             _channel->flush();
+            _rxRing.clear();
             return SL_RESULT_OK;
         }
 
@@ -1961,21 +2119,73 @@ namespace sl {
         rp::hal::Locker         _lock;
         rp::hal::Event          _dataEvt;
         rp::hal::Thread         _cachethread;
+        LidarThreadPolicy       _thread_policy;
+        LidarRxRing             _rxRing;
         sl_u16                  _cached_sampleduration_std;
         sl_u16                  _cached_sampleduration_express;
         bool                    _scan_node_synced;
 
-        sl_lidar_response_measurement_node_hq_t   _cached_scan_node_hq_buf[8192];
-        size_t                                   _cached_scan_node_hq_count;
+        rp::hal::LeasePoolIndex                  _scan_pool;
+        sl_lidar_response_measurement_node_hq_t * _scan_slot_buf[rp::hal::LeasePoolIndex::SLOT_COUNT];
+        sl_u64                                  * _scan_slot_ts[rp::hal::LeasePoolIndex::SLOT_COUNT];
+        LidarScanBuffer                          _scan_slot_info[rp::hal::LeasePoolIndex::SLOT_COUNT];
+        ScanSlotArrays                           _scan_slot_arrays[rp::hal::LeasePoolIndex::SLOT_COUNT];
+        LidarScanView                            _scan_slot_views[rp::hal::LeasePoolIndex::SLOT_COUNT][LIDAR_MAX_SCAN_VIEWS];
+        int                                      _scan_write_slot;
+        sl_u64                                   _scan_sequence;
+        sl_u64                                   _grabbed_sequence;
         sl_u8                                    _cached_capsule_flag;
 
-        sl_lidar_response_measurement_node_hq_t   _cached_scan_node_hq_buf_for_interval_retrieve[8192];
-        size_t                                   _cached_scan_node_hq_count_for_interval_retrieve;
-
-        sl_lidar_response_capsule_measurement_nodes_t       _cached_previous_capsuledata;
-        sl_lidar_response_dense_capsule_measurement_nodes_t _cached_previous_dense_capsuledata;
-        sl_lidar_response_ultra_capsule_measurement_nodes_t _cached_previous_ultracapsuledata;
-        sl_lidar_response_hq_capsule_measurement_nodes_t _cached_previous_Hqdata;
+        // every buffer of the scan session lives in one block sized at startScan
+        rp::hal::Arena                           _scan_arena;
+        size_t                                   _scan_buffer_limit;
+        size_t                                   _max_scan_nodes;
+        size_t                                   _interval_buffer_nodes;
+        // SCAN_PUBLISH_SOA / SCAN_PUBLISH_CARTESIAN when the scan slots have the matching arrays
+        sl_u32                                   _array_flags;
+
+        // consumer views, the scan slots have storage for _layout_view_count of them
+        scan_view::ViewFilter                    _view_filters[LIDAR_MAX_SCAN_VIEWS];
+        size_t                                   _view_count;
+        size_t                                   _layout_view_count;
+        sl_u32                                 * _view_bins;
+        sl_lidar_response_measurement_node_hq_t * _decode_buf;
+        sl_lidar_response_measurement_node_t    * _decode_buf_std;
+        CapsuleHistory                         * _capsule_history;
+
+        // sampling time of the nodes in _decode_buf, see _stampDecodedNodes
+        sl_u64                                  * _decode_ts;
+        sl_u64                                   _sample_duration_ns;
+        sl_s64                                   _hq_clock_offset_ns;
+        bool                                     _hq_clock_synced;
+        sl_u64                                   _last_node_ns;
+
+        // fallback buffers of the sort done before publishing, see SCAN_PUBLISH_SORTED
+        sl_lidar_response_measurement_node_hq_t * _sort_scratch_buf;
+        sl_u64                                  * _sort_scratch_ts;
+
+        rp::hal::SpscRing<sl_lidar_response_measurement_node_hq_t> _intervalRing;
+        rp::hal::Event                           _intervalEvt;
+        std::atomic<bool>                        _interval_waiting;
+
+        bool                                     _external_pump;
+        LidarFrameType                           _scan_frame_type;
+        size_t                                   _pump_scan_count;
+
+        ILidarSectorListener                   * _sector_listener;
+        float                                    _sector_degrees;
+        sl_u32                                   _sector_width_q14;
+        size_t                                   _sector_begin;
+        int                                      _sector_index;
+
+        sl_u32                                   _publish_flags;
+
+        StatCounters                             _stats;
+        bool                                     _frame_synced;
+        sl_u64                                   _frame_arrival_ns;
+        sl_u64                                   _revolution_start_ns;
+
+        int                                          _cached_dense_last_sync_bit;
         bool                                         _is_previous_capsuledataRdy;
         bool                                         _is_previous_HqdataRdy;
     };
@@ -0,0 +1,355 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "sl_lidar_fleet.h"
+#include <atomic>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace sl {
+
+#ifdef __linux__
+
+    class LidarFleet : public ILidarFleet
+    {
+    public:
+        enum
+        {
+            MAX_EVENTS = 16,
+            // devices which stopped scanning or hung up are polled again at this interval (ms)
+            REARM_INTERVAL = 100,
+        };
+
+        LidarFleet()
+            : _epoll_fd(-1)
+            , _wakeup_fd(-1)
+            , _running(false)
+            , _idle_devices(0)
+            , _last_rearm_ts(0)
+            , _next_device(0)
+        {
+            _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            _wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (_epoll_fd != -1 && _wakeup_fd != -1) {
+                epoll_event event;
+                event.events = EPOLLIN;
+                event.data.u32 = WAKEUP_ID;
+                epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wakeup_fd, &event);
+            }
+        }
+
+        ~LidarFleet()
+        {
+            stop();
+            for (size_t id = 0; id < _devices.size(); ++id) {
+                if (!_devices[id]) continue;
+                _devices[id]->driver->setExternalPump(false);
+                delete _devices[id];
+            }
+            if (_wakeup_fd != -1) ::close(_wakeup_fd);
+            if (_epoll_fd != -1) ::close(_epoll_fd);
+        }
+
+        bool isValid() const
+        {
+            return _epoll_fd != -1 && _wakeup_fd != -1;
+        }
+
+        sl_result addDevice(ILidarDriver* driver, int& deviceId)
+        {
+            if (!driver) return SL_RESULT_INVALID_DATA;
+
+            int fd = driver->getPollHandle();
+            if (fd == -1) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            Result<nullptr_t> ans = driver->setExternalPump(true);
+            if (!ans) return ans;
+
+            rp::hal::AutoLocker l(_lock);
+            Device* device = new Device(driver, fd);
+            size_t id = 0;
+            while (id < _devices.size() && _devices[id]) ++id;
+            if (id == _devices.size()) _devices.push_back(NULL);
+
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u32 = (sl_u32)id;
+            if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+                delete device;
+                driver->setExternalPump(false);
+                return SL_RESULT_OPERATION_FAIL;
+            }
+
+            _devices[id] = device;
+            deviceId = (int)id;
+            return SL_RESULT_OK;
+        }
+
+        sl_result removeDevice(int deviceId)
+        {
+            rp::hal::AutoLocker l(_lock);
+            Device* device = _findDevice(deviceId);
+            if (!device) return SL_RESULT_INVALID_DATA;
+
+            Result<nullptr_t> ans = device->driver->setExternalPump(false);
+            if (!ans) return ans;
+
+            epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+            if (!device->armed) --_idle_devices;
+            _devices[deviceId] = NULL;
+            delete device;
+            return SL_RESULT_OK;
+        }
+
+        sl_result start()
+        {
+            if (!isValid()) return SL_RESULT_OPERATION_FAIL;
+            if (_running) return SL_RESULT_ALREADY_DONE;
+
+            _running = true;
+            _reactor = CLASS_THREAD(LidarFleet, _reactorProc);
+            if (_reactor.getHandle() == 0) {
+                _running = false;
+                return SL_RESULT_OPERATION_FAIL;
+            }
+            _reactor.setName("sl-lidar-fleet");
+            return SL_RESULT_OK;
+        }
+
+        void stop()
+        {
+            if (!_running) return;
+            _running = false;
+            _wakeup();
+            _reactor.join();
+        }
+
+        sl_result runOnce(sl_u32 timeout)
+        {
+            if (!isValid()) return SL_RESULT_OPERATION_FAIL;
+
+            // stopped devices are only looked at again when the rearm timer expires
+            int wait_ms = (timeout == (sl_u32)-1) ? -1 : (int)timeout;
+            if (_idle_devices.load(std::memory_order_relaxed) && (wait_ms == -1 || wait_ms > REARM_INTERVAL)) {
+                wait_ms = REARM_INTERVAL;
+            }
+
+            epoll_event events[MAX_EVENTS];
+            int count = epoll_wait(_epoll_fd, events, MAX_EVENTS, wait_ms);
+            if (count < 0) {
+                return errno == EINTR ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+            }
+
+            bool published = false;
+            {
+                rp::hal::AutoLocker l(_lock);
+                for (int i = 0; i < count; ++i) {
+                    if (events[i].data.u32 == WAKEUP_ID) {
+                        eventfd_t value;
+                        eventfd_read(_wakeup_fd, &value);
+                        continue;
+                    }
+
+                    int id = (int)events[i].data.u32;
+                    Device* device = _findDevice(id);
+                    if (!device) continue;
+
+                    size_t scans = 0;
+                    sl_result ans = device->driver->pumpScanData(scans);
+                    if (scans) {
+                        device->pending.store(true, std::memory_order_release);
+                        published = true;
+                    }
+                    if (SL_IS_FAIL(ans) || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                        _disarm(id);
+                    }
+                }
+                _rearmIdleDevices();
+            }
+
+            if (published) _scanEvt.set();
+            return SL_RESULT_OK;
+        }
+
+        sl_result waitAnyScan(LidarFleetScan& scan, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT)
+        {
+            sl_u32 startTs = getms();
+            scan.lease.release();
+
+            for (;;) {
+                {
+                    rp::hal::AutoLocker l(_lock);
+                    size_t device_count = _devices.size();
+                    for (size_t k = 0; k < device_count; ++k) {
+                        size_t id = (_next_device + k) % device_count;
+                        Device* device = _devices[id];
+                        if (!device || !device->pending.exchange(false, std::memory_order_acquire)) continue;
+
+                        LidarScanLease lease;
+                        if (SL_IS_FAIL(device->driver->grabScanLease(lease, 0))) continue;
+                        if (lease.sequence() <= device->delivered_sequence) continue;
+
+                        device->delivered_sequence = lease.sequence();
+                        scan.device_id = (int)id;
+                        scan.lease = lease;
+                        _next_device = id + 1;
+                        return SL_RESULT_OK;
+                    }
+                }
+
+                sl_u32 waitTime = getms() - startTs;
+                if (waitTime >= timeout) return SL_RESULT_OPERATION_TIMEOUT;
+
+                unsigned long ans = _scanEvt.wait(timeout - waitTime);
+                if (ans == (unsigned long)rp::hal::Event::EVENT_FAILED) return SL_RESULT_OPERATION_FAIL;
+            }
+        }
+
+    protected:
+        enum
+        {
+            WAKEUP_ID = 0xFFFFFFFF,
+        };
+
+        struct Device
+        {
+            Device(ILidarDriver* driver, int fd)
+                : driver(driver)
+                , fd(fd)
+                , armed(true)
+                , delivered_sequence(0)
+            {
+                pending.store(false, std::memory_order_relaxed);
+            }
+
+            ILidarDriver*       driver;
+            int                 fd;
+            bool                armed;
+            std::atomic<bool>   pending;
+            sl_u64              delivered_sequence;
+        };
+
+        Device* _findDevice(int deviceId)
+        {
+            if (deviceId < 0 || (size_t)deviceId >= _devices.size()) return NULL;
+            return _devices[deviceId];
+        }
+
+        void _disarm(int deviceId)
+        {
+            Device* device = _devices[deviceId];
+            if (!device->armed) return;
+
+            // a device which is not scanning may still receive command responses, do not spin on them
+            epoll_event event;
+            event.events = 0;
+            event.data.u32 = (sl_u32)deviceId;
+            epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, device->fd, &event);
+            device->armed = false;
+            ++_idle_devices;
+            _last_rearm_ts = getms();
+        }
+
+        void _rearmIdleDevices()
+        {
+            if (!_idle_devices.load(std::memory_order_relaxed)) return;
+            if (getms() - _last_rearm_ts < (sl_u32)REARM_INTERVAL) return;
+
+            for (size_t id = 0; id < _devices.size(); ++id) {
+                Device* device = _devices[id];
+                if (!device || device->armed) continue;
+
+                epoll_event event;
+                event.events = EPOLLIN;
+                event.data.u32 = (sl_u32)id;
+                epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, device->fd, &event);
+                device->armed = true;
+                --_idle_devices;
+            }
+            _last_rearm_ts = getms();
+        }
+
+        void _wakeup()
+        {
+            eventfd_write(_wakeup_fd, 1);
+        }
+
+        u_result _reactorProc()
+        {
+            while (_running) {
+                if (SL_IS_FAIL(runOnce((sl_u32)-1))) break;
+            }
+            return RESULT_OK;
+        }
+
+        int                     _epoll_fd;
+        int                     _wakeup_fd;
+        volatile bool           _running;
+        rp::hal::Thread         _reactor;
+        rp::hal::Locker         _lock;
+        rp::hal::Event          _scanEvt;
+        std::vector<Device*>    _devices;
+        std::atomic<int>        _idle_devices;
+        sl_u32                  _last_rearm_ts;
+        size_t                  _next_device;
+    };
+
+    Result<ILidarFleet*> createLidarFleet()
+    {
+        LidarFleet* fleet = new LidarFleet();
+        if (!fleet->isValid()) {
+            delete fleet;
+            return SL_RESULT_OPERATION_FAIL;
+        }
+        return fleet;
+    }
+
+#else
+
+    Result<ILidarFleet*> createLidarFleet()
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+}
@@ -0,0 +1,254 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "sl_lidar_supervisor.h"
+#include <atomic>
+#include <algorithm>
+
+namespace sl {
+
+    class LidarSupervisor : public ILidarSupervisor
+    {
+    public:
+        enum
+        {
+            // the revolution counter is sampled at this interval (ms), it bounds the detection and recovery latency
+            WATCH_INTERVAL = 20,
+        };
+
+        LidarSupervisor(ILidarDriver* driver, IChannel* channel, const LidarSupervisorConfig& config)
+            : _driver(driver)
+            , _channel(channel)
+            , _config(config)
+            , _running(false)
+            , _restart_needed(false)
+            , _seen_revolutions(0)
+            , _restart_ns(0)
+        {
+            _state.store(LIDAR_SUPERVISOR_STOPPED, std::memory_order_relaxed);
+            _resetStatus();
+            if (_config.backoff_min_ms == 0) _config.backoff_min_ms = 1;
+            if (_config.backoff_max_ms < _config.backoff_min_ms) _config.backoff_max_ms = _config.backoff_min_ms;
+        }
+
+        ~LidarSupervisor()
+        {
+            stop();
+        }
+
+        sl_result start()
+        {
+            if (_running) return SL_RESULT_ALREADY_DONE;
+
+            LidarStatistics stats;
+            _driver->getStatistics(stats);
+            _seen_revolutions = stats.revolutions;
+            _restart_ns = stats.timestamp_ns;
+            _resetStatus();
+            _restart_needed = true;
+            _setState(LIDAR_SUPERVISOR_STARTING);
+
+            _running = true;
+            _supervisor = CLASS_THREAD(LidarSupervisor, _supervisorProc);
+            if (_supervisor.getHandle() == 0) {
+                _running = false;
+                _setState(LIDAR_SUPERVISOR_STOPPED);
+                return SL_RESULT_OPERATION_FAIL;
+            }
+            _supervisor.setName("sl-lidar-watch");
+            return SL_RESULT_OK;
+        }
+
+        void stop()
+        {
+            if (!_running) return;
+            _running = false;
+            _stopEvt.set();
+            _supervisor.join();
+
+            rp::hal::AutoLocker l(_driver_lock);
+            _setState(LIDAR_SUPERVISOR_STOPPED);
+            _driver->stop();
+        }
+
+        sl_result grabScanLease(LidarScanLease& lease)
+        {
+            if (getState() != LIDAR_SUPERVISOR_RUNNING) return SL_RESULT_OPERATION_STOP;
+
+            // the supervisor thread holds the lock for a whole restart, never wait for it
+            if (_driver_lock.lock(0) != rp::hal::Locker::LOCK_OK) return SL_RESULT_OPERATION_STOP;
+            sl_result ans = _driver->grabScanLease(lease, 0);
+            _driver_lock.unlock();
+            return ans;
+        }
+
+        LidarSupervisorState getState()
+        {
+            return (LidarSupervisorState)_state.load(std::memory_order_acquire);
+        }
+
+        void getStatus(LidarSupervisorStatus& status)
+        {
+            rp::hal::AutoLocker l(_status_lock);
+            status = _status;
+            status.state = getState();
+        }
+
+    protected:
+        void _setState(LidarSupervisorState state)
+        {
+            _state.store(state, std::memory_order_release);
+        }
+
+        void _resetStatus()
+        {
+            rp::hal::AutoLocker l(_status_lock);
+            _status = LidarSupervisorStatus();
+            _status.state = LIDAR_SUPERVISOR_STOPPED;
+            _status.last_error = SL_RESULT_OK;
+        }
+
+        sl_result _restart()
+        {
+            // the first start keeps the connection the caller made (and the baudrate it negotiated)
+            if (getState() == LIDAR_SUPERVISOR_DEGRADED) {
+                _driver->stop();
+                _driver->disconnect();
+            }
+
+            sl_result ans = SL_RESULT_OK;
+            if (!_driver->isConnected()) {
+                ans = _driver->connect(_channel);
+                if (SL_IS_FAIL(ans)) return ans;
+            }
+
+            if (_config.use_typical_scan) {
+                ans = _driver->startScan(false, true);
+            } else {
+                ans = _driver->startScanExpress(false, _config.scan_mode);
+            }
+            // a lidar which does not answer may sit behind a USB adapter which went away, reopen it next time
+            if (SL_IS_FAIL(ans)) _driver->disconnect();
+            return ans;
+        }
+
+        void _watch()
+        {
+            LidarStatistics stats;
+            _driver->getStatistics(stats);
+            sl_u64 now = stats.timestamp_ns;
+
+            rp::hal::AutoLocker l(_status_lock);
+            if (stats.revolutions != _seen_revolutions) {
+                _status.revolutions += stats.revolutions - _seen_revolutions;
+                _seen_revolutions = stats.revolutions;
+                _status.last_revolution_ns = now;
+                if (_status.degraded_since_ns) {
+                    ++_status.recoveries;
+                    _status.last_recovery_ns = now - _status.degraded_since_ns;
+                    _status.degraded_since_ns = 0;
+                }
+                _status.failed_attempts = 0;
+                _setState(LIDAR_SUPERVISOR_RUNNING);
+                return;
+            }
+
+            // a restarted scan gets the full stall timeout to deliver its first revolution
+            sl_u64 since = std::max(_status.last_revolution_ns, _restart_ns);
+            if (now - since > (sl_u64)_config.stall_timeout_ms * 1000000) {
+                if (!_status.degraded_since_ns) _status.degraded_since_ns = now;
+                _setState(LIDAR_SUPERVISOR_DEGRADED);
+                _restart_needed = true;
+            }
+        }
+
+        u_result _supervisorProc()
+        {
+            sl_u32 backoff = _config.backoff_min_ms;
+            while (_running) {
+                sl_u32 wait = std::min((sl_u32)WATCH_INTERVAL, std::max(_config.stall_timeout_ms / 4, (sl_u32)1));
+                if (_restart_needed) {
+                    sl_result ans;
+                    {
+                        rp::hal::AutoLocker l(_driver_lock);
+                        ans = _restart();
+                    }
+                    if (SL_IS_OK(ans)) {
+                        _restart_needed = false;
+                        _restart_ns = getns();
+                        backoff = _config.backoff_min_ms;
+                    } else {
+                        rp::hal::AutoLocker l(_status_lock);
+                        ++_status.failed_attempts;
+                        _status.last_error = ans;
+                        wait = backoff;
+                        backoff = std::min(backoff * 2, _config.backoff_max_ms);
+                    }
+                } else {
+                    _watch();
+                }
+                _stopEvt.wait(wait);
+            }
+            return RESULT_OK;
+        }
+
+        ILidarDriver*           _driver;
+        IChannel*               _channel;
+        LidarSupervisorConfig   _config;
+
+        volatile bool           _running;
+        rp::hal::Thread         _supervisor;
+        rp::hal::Event          _stopEvt;
+
+        // held by the supervisor thread while it restarts the driver
+        rp::hal::Locker         _driver_lock;
+        std::atomic<int>        _state;
+
+        // only the supervisor thread uses these
+        bool                    _restart_needed;
+        sl_u64                  _seen_revolutions;
+        sl_u64                  _restart_ns;
+
+        rp::hal::Locker         _status_lock;
+        LidarSupervisorStatus   _status;
+    };
+
+    Result<ILidarSupervisor*> createLidarSupervisor(ILidarDriver* driver, IChannel* channel, const LidarSupervisorConfig& config)
+    {
+        if (!driver || !channel) return SL_RESULT_INVALID_DATA;
+        return new LidarSupervisor(driver, channel, config);
+    }
+}
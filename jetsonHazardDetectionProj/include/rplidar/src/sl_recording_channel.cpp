@@ -0,0 +1,479 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sdkcommon.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/thread.h"
+#include "sl_lidar_recording.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    class RecordingChannel : public ISerialPortChannel
+    {
+    public:
+        enum
+        {
+            // about 40 seconds of traffic at 1 Mbps
+            BUFFER_SIZE = 4 << 20,
+            // the writer thread wakes up at this interval (ms), or earlier once the buffer is half full
+            WRITE_INTERVAL = 100,
+        };
+
+        RecordingChannel(IChannel* channel, ChannelType type, FILE* file)
+            : _channel(channel)
+            , _serial(type == CHANNEL_TYPE_SERIALPORT)
+            , _file(file)
+            , _running(true)
+        {
+            _pending.reserve(BUFFER_SIZE);
+            _writing.reserve(BUFFER_SIZE);
+            _writer = CLASS_THREAD(RecordingChannel, _writerProc);
+            _writer.setName("sl-lidar-record");
+        }
+
+        ~RecordingChannel()
+        {
+            _running = false;
+            _wakeEvt.set();
+            _writer.join();
+            _writeOut();
+            fclose(_file);
+            delete _channel;
+        }
+
+        bool open()
+        {
+            return _channel->open();
+        }
+
+        void close()
+        {
+            _channel->close();
+            _wakeEvt.set();
+        }
+
+        void flush()
+        {
+            _channel->flush();
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            return _channel->waitForData(size, timeoutInMs, actualReady);
+        }
+
+        int write(const void* data, size_t size)
+        {
+            int ans = _channel->write(data, size);
+            if (ans > 0) _record(data, ans, LIDAR_RECORDING_BLOCK_TX);
+            return ans;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            int ans = _channel->read(buffer, size);
+            if (ans > 0) _record(buffer, ans, 0);
+            return ans;
+        }
+
+        int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+        {
+            int ans = _channel->waitAndRead(buffer, size, minSize, timeoutInMs);
+            if (ans > 0) _record(buffer, ans, 0);
+            return ans;
+        }
+
+        void clearReadCache()
+        {
+            _channel->clearReadCache();
+        }
+
+        int getPollHandle()
+        {
+            return _channel->getPollHandle();
+        }
+
+        void setDTR(bool dtr)
+        {
+            if (_serial) static_cast<ISerialPortChannel*>(_channel)->setDTR(dtr);
+        }
+
+        bool setBaudRate(int baudrate)
+        {
+            return _serial && static_cast<ISerialPortChannel*>(_channel)->setBaudRate(baudrate);
+        }
+
+        int getBaudRate()
+        {
+            return _serial ? static_cast<ISerialPortChannel*>(_channel)->getBaudRate() : 0;
+        }
+
+    protected:
+        void _record(const void* data, size_t size, sl_u32 flags)
+        {
+            RecordingBlockHeader header;
+            header.timestamp_ns = getns();
+            header.size = (sl_u32)size | flags;
+
+            bool wake;
+            {
+                rp::hal::AutoLocker l(_lock);
+                if (_pending.size() + sizeof(header) + size > BUFFER_SIZE) return;
+                // the capacity is reserved up front, appending never reallocates
+                const sl_u8* bytes = reinterpret_cast<const sl_u8*>(&header);
+                _pending.insert(_pending.end(), bytes, bytes + sizeof(header));
+                bytes = reinterpret_cast<const sl_u8*>(data);
+                _pending.insert(_pending.end(), bytes, bytes + size);
+                wake = _pending.size() > BUFFER_SIZE / 2;
+            }
+            if (wake) _wakeEvt.set();
+        }
+
+        // only the writer thread calls it, and the destructor once the thread is gone
+        void _writeOut()
+        {
+            {
+                rp::hal::AutoLocker l(_lock);
+                _pending.swap(_writing);
+            }
+            if (_writing.empty()) return;
+            fwrite(&_writing[0], 1, _writing.size(), _file);
+            fflush(_file);
+            _writing.clear();
+        }
+
+        sl_result _writerProc()
+        {
+            while (_running) {
+                _wakeEvt.wait(WRITE_INTERVAL);
+                _writeOut();
+            }
+            return SL_RESULT_OK;
+        }
+
+        IChannel*           _channel;
+        bool                _serial;
+        FILE*               _file;
+
+        volatile bool       _running;
+        rp::hal::Thread     _writer;
+        rp::hal::Event      _wakeEvt;
+
+        rp::hal::Locker     _lock;
+        std::vector<sl_u8>  _pending;
+
+        // owned by the writer thread
+        std::vector<sl_u8>  _writing;
+    };
+
+    class ReplayChannel : public IReplayChannel
+    {
+    public:
+        ReplayChannel(const std::string& path, bool realTime)
+            : _path(path)
+            , _realTime(realTime)
+            , _isOpen(false)
+            , _recordedBytes(0)
+        {
+            _rewind();
+        }
+
+        bool open()
+        {
+            if (!_load()) return false;
+            rp::hal::AutoLocker l(_lock);
+            _rewind();
+            _isOpen = true;
+            return true;
+        }
+
+        void close()
+        {
+            {
+                rp::hal::AutoLocker l(_lock);
+                _isOpen = false;
+            }
+            _dataEvt.set();
+        }
+
+        void flush()
+        {
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            size_t ready = _waitFor(size, timeoutInMs);
+            if (actualReady) *actualReady = ready;
+            return ready >= size;
+        }
+
+        int write(const void* data, size_t size)
+        {
+            {
+                rp::hal::AutoLocker l(_lock);
+                if (!_isOpen) return -1;
+                if (_writes < _txTimes.size()) {
+                    // the answers to this write are timed from it, not from the start of the replay
+                    sl_s64 offset = (sl_s64)getns() - (sl_s64)_txTimes[_writes];
+                    if (offset > _offsetNs) _offsetNs = offset;
+                }
+                ++_writes;
+            }
+            _dataEvt.set();
+            return (int)size;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            rp::hal::AutoLocker l(_lock);
+            if (!_isOpen) return -1;
+
+            sl_u64 now = getns();
+            sl_u8* dest = reinterpret_cast<sl_u8*>(buffer);
+            size_t copied = 0;
+            while (copied < size && _next < _rxBlocks.size() && _isReleased(_rxBlocks[_next], now)) {
+                const RxBlock& block = _rxBlocks[_next];
+                size_t count = std::min<size_t>(block.size - _nextOffset, size - copied);
+                memcpy(dest + copied, &_data[block.offset + _nextOffset], count);
+                copied += count;
+                _nextOffset += count;
+                if (_nextOffset == block.size) {
+                    ++_next;
+                    _nextOffset = 0;
+                }
+            }
+            _delivered += copied;
+            return (int)copied;
+        }
+
+        int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+        {
+            _waitFor(minSize, timeoutInMs);
+            return read(buffer, size);
+        }
+
+        void clearReadCache()
+        {
+        }
+
+        bool isFinished()
+        {
+            rp::hal::AutoLocker l(_lock);
+            return _next == _rxBlocks.size();
+        }
+
+        sl_u64 getDeliveredBytes()
+        {
+            rp::hal::AutoLocker l(_lock);
+            return _delivered;
+        }
+
+        sl_u64 getRecordedBytes()
+        {
+            rp::hal::AutoLocker l(_lock);
+            return _recordedBytes;
+        }
+
+    protected:
+        struct RxBlock
+        {
+            size_t  offset;
+            sl_u32  size;
+            sl_u64  timestamp_ns;
+            // writes made before the block has been received
+            size_t  writes;
+        };
+
+        void _rewind()
+        {
+            _next = 0;
+            _nextOffset = 0;
+            _writes = 0;
+            _delivered = 0;
+            _offsetNs = (sl_s64)getns() - (sl_s64)_firstNs();
+        }
+
+        sl_u64 _firstNs() const
+        {
+            sl_u64 first = _rxBlocks.empty() ? 0 : _rxBlocks[0].timestamp_ns;
+            if (!_txTimes.empty() && (_rxBlocks.empty() || _txTimes[0] < first)) first = _txTimes[0];
+            return first;
+        }
+
+        bool _isReleased(const RxBlock& block, sl_u64 now) const
+        {
+            if (_writes < block.writes) return false;
+            return !_realTime || (sl_s64)now - (sl_s64)block.timestamp_ns >= _offsetNs;
+        }
+
+        bool _load()
+        {
+            FILE* file = fopen(_path.c_str(), "rb");
+            if (!file) return false;
+
+            std::vector<sl_u8> data;
+            sl_u8 chunk[64 * 1024];
+            size_t count;
+            while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+                data.insert(data.end(), chunk, chunk + count);
+            }
+            fclose(file);
+
+            RecordingFileHeader fileHeader;
+            if (data.size() < sizeof(fileHeader)) return false;
+            memcpy(&fileHeader, &data[0], sizeof(fileHeader));
+            if (fileHeader.magic != LIDAR_RECORDING_MAGIC || fileHeader.version != LIDAR_RECORDING_VERSION) return false;
+
+            std::vector<RxBlock> rxBlocks;
+            std::vector<sl_u64> txTimes;
+            sl_u64 recordedBytes = 0;
+            size_t pos = sizeof(fileHeader);
+            RecordingBlockHeader header;
+            // a truncated last record, from a recorder killed while writing, is ignored
+            while (pos + sizeof(header) <= data.size()) {
+                memcpy(&header, &data[pos], sizeof(header));
+                pos += sizeof(header);
+                sl_u32 size = header.size & ~LIDAR_RECORDING_BLOCK_TX;
+                if (pos + size > data.size()) break;
+
+                if (header.size & LIDAR_RECORDING_BLOCK_TX) {
+                    txTimes.push_back(header.timestamp_ns);
+                } else {
+                    RxBlock block;
+                    block.offset = pos;
+                    block.size = size;
+                    block.timestamp_ns = header.timestamp_ns;
+                    block.writes = txTimes.size();
+                    rxBlocks.push_back(block);
+                    recordedBytes += size;
+                }
+                pos += size;
+            }
+
+            rp::hal::AutoLocker l(_lock);
+            _data.swap(data);
+            _rxBlocks.swap(rxBlocks);
+            _txTimes.swap(txTimes);
+            _recordedBytes = recordedBytes;
+            return true;
+        }
+
+        // wait for size bytes to be released, returns the bytes ready (counted up to size)
+        size_t _waitFor(size_t size, sl_u32 timeoutInMs)
+        {
+            sl_u64 startNs = getns();
+            sl_u64 timeoutNs = (sl_u64)timeoutInMs * 1000000;
+
+            for (;;) {
+                sl_u64 now = getns();
+                size_t ready = 0;
+                sl_u64 nextReleaseNs = 0;
+                {
+                    rp::hal::AutoLocker l(_lock);
+                    if (!_isOpen) return 0;
+
+                    size_t offset = _nextOffset;
+                    for (size_t i = _next; i < _rxBlocks.size() && ready < size; ++i) {
+                        if (!_isReleased(_rxBlocks[i], now)) {
+                            // a block held back by its time, a block held back by a write waits for the event
+                            if (_writes >= _rxBlocks[i].writes) nextReleaseNs = (sl_u64)((sl_s64)_rxBlocks[i].timestamp_ns + _offsetNs);
+                            break;
+                        }
+                        ready += _rxBlocks[i].size - offset;
+                        offset = 0;
+                    }
+                }
+                if (ready >= size) return ready;
+
+                sl_u64 elapsed = now - startNs;
+                if (elapsed >= timeoutNs) return ready;
+
+                sl_u64 waitNs = timeoutNs - elapsed;
+                if (nextReleaseNs && nextReleaseNs - now < waitNs) waitNs = nextReleaseNs - now;
+                _dataEvt.wait((unsigned long)((waitNs + 999999) / 1000000));
+            }
+        }
+
+        std::string             _path;
+        bool                    _realTime;
+
+        rp::hal::Locker         _lock;
+        rp::hal::Event          _dataEvt;
+        bool                    _isOpen;
+
+        std::vector<sl_u8>      _data;
+        std::vector<RxBlock>    _rxBlocks;
+        std::vector<sl_u64>     _txTimes;
+        sl_u64                  _recordedBytes;
+
+        // replay position
+        size_t                  _next;
+        size_t                  _nextOffset;
+        size_t                  _writes;
+        sl_u64                  _delivered;
+        // host time minus recorded time the blocks are released at in real time
+        sl_s64                  _offsetNs;
+    };
+
+    Result<IChannel*> createRecordingChannel(IChannel* channel, ChannelType type, const std::string& path)
+    {
+        if (!channel) return SL_RESULT_INVALID_DATA;
+
+        FILE* file = fopen(path.c_str(), "ab");
+        if (!file) return SL_RESULT_OPERATION_FAIL;
+
+        fseek(file, 0, SEEK_END);
+        if (ftell(file) == 0) {
+            RecordingFileHeader header;
+            header.magic = LIDAR_RECORDING_MAGIC;
+            header.version = LIDAR_RECORDING_VERSION;
+            header.reserved = 0;
+            if (fwrite(&header, sizeof(header), 1, file) != 1) {
+                fclose(file);
+                return SL_RESULT_OPERATION_FAIL;
+            }
+        }
+        return new RecordingChannel(channel, type, file);
+    }
+
+    Result<IReplayChannel*> createReplayChannel(const std::string& path, bool realTime)
+    {
+        return new ReplayChannel(path, realTime);
+    }
+
+}
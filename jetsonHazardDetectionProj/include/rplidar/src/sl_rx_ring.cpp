@@ -0,0 +1,273 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_rx_ring.h"
+#include "sl_crc.h"
+#include <stddef.h>
+
+namespace sl {
+
+    static sl_u8 xorChecksum(const sl_u8* data, size_t len)
+    {
+        // fold eight bytes per step, the low byte of the folded word is the xor of all of them
+        sl_u64 acc = 0;
+        size_t pos = 0;
+        for (; pos + sizeof(acc) <= len; pos += sizeof(acc)) {
+            sl_u64 word;
+            memcpy(&word, data + pos, sizeof(word));
+            acc ^= word;
+        }
+        acc ^= acc >> 32;
+        acc ^= acc >> 16;
+        acc ^= acc >> 8;
+
+        sl_u8 checksum = (sl_u8)acc;
+        for (; pos < len; ++pos) {
+            checksum ^= data[pos];
+        }
+        return checksum;
+    }
+
+    LidarRxRing::LidarRxRing()
+        : _head(0)
+        , _tail(0)
+        , _markCount(0)
+    {
+        _received.store(0, std::memory_order_relaxed);
+    }
+
+    void LidarRxRing::clear()
+    {
+        _head = 0;
+        _tail = 0;
+        _markCount = 0;
+    }
+
+    void LidarRxRing::_compact()
+    {
+        if (!_head) return;
+        memmove(_buf, _buf + _head, size());
+
+        // chunks which have been consumed entirely are forgotten
+        size_t kept = 0;
+        for (size_t pos = 0; pos < _markCount; ++pos) {
+            if (_marks[pos].end <= _head) continue;
+            _marks[kept].end = _marks[pos].end - _head;
+            _marks[kept].ns = _marks[pos].ns;
+            ++kept;
+        }
+        _markCount = kept;
+
+        _tail -= _head;
+        _head = 0;
+    }
+
+    void LidarRxRing::_markChunk(sl_u64 ns)
+    {
+        if (_markCount == MAX_CHUNK_MARKS) {
+            // many tiny reads without any compaction, the oldest chunk is merged into the next one
+            memmove(_marks, _marks + 1, sizeof(_marks[0]) * (MAX_CHUNK_MARKS - 1));
+            --_markCount;
+        }
+        _marks[_markCount].end = _tail;
+        _marks[_markCount].ns = ns;
+        ++_markCount;
+    }
+
+    void LidarRxRing::_countReceived(size_t bytes)
+    {
+        _received.store(_received.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    sl_u64 LidarRxRing::arrivalTime(const sl_u8* data, size_t* trailing) const
+    {
+        size_t offset = data - _buf;
+        for (size_t pos = 0; pos < _markCount; ++pos) {
+            if (offset < _marks[pos].end) {
+                if (trailing) *trailing = _marks[pos].end - offset;
+                return _marks[pos].ns;
+            }
+        }
+        if (trailing) *trailing = 0;
+        return _markCount ? _marks[_markCount - 1].ns : getns();
+    }
+
+    bool LidarRxRing::fill(IChannel* channel, size_t wanted, sl_u32 timeout)
+    {
+        if (wanted > CAPACITY) wanted = CAPACITY;
+        if (size() >= wanted) return true;
+
+        // move the pending partial frame to the front, this is at most one frame worth of bytes
+        _compact();
+
+        // take everything that is ready, up to the free space, in one read
+        int ans = channel->waitAndRead(_buf + _tail, CAPACITY - _tail, wanted - _tail, timeout);
+        sl_u64 arrival = getns();
+        if (ans > 0) {
+            _tail += ans;
+            _markChunk(arrival);
+            _countReceived(ans);
+        }
+        return size() >= wanted;
+    }
+
+    bool LidarRxRing::pull(IChannel* channel)
+    {
+        _compact();
+        if (_tail == CAPACITY) return true;
+
+        sl_u64 arrival = getns();
+        int ans = channel->read(_buf + _tail, CAPACITY - _tail);
+        if (ans < 0) return false;
+        if (ans > 0) {
+            _tail += ans;
+            _markChunk(arrival);
+            _countReceived(ans);
+        }
+        return true;
+    }
+
+    size_t LidarRxRing::read(void* buffer, size_t size)
+    {
+        if (size > this->size()) size = this->size();
+        memcpy(buffer, _buf + _head, size);
+        _head += size;
+        return size;
+    }
+
+    size_t LidarRxRing::frameSize(LidarFrameType type)
+    {
+        switch (type) {
+        case LIDAR_FRAME_ANS_HEADER:
+            return sizeof(sl_lidar_ans_header_t);
+        case LIDAR_FRAME_MEASUREMENT_NODE:
+            return sizeof(sl_lidar_response_measurement_node_t);
+        case LIDAR_FRAME_CAPSULE:
+            return sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+        case LIDAR_FRAME_ULTRA_CAPSULE:
+            return sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t);
+        case LIDAR_FRAME_HQ_CAPSULE:
+            return sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t);
+        }
+        return 0;
+    }
+
+    int LidarRxRing::nextFrame(LidarFrameType type, const sl_u8 *& frame, size_t & skipped)
+    {
+        const sl_u8* begin = _buf + _head;
+        const sl_u8* end = _buf + _tail;
+        const sl_u8* sync = _findSync(type, begin, end);
+
+        skipped = sync - begin;
+        _head += skipped;
+
+        size_t size = frameSize(type);
+        if ((size_t)(end - sync) < size) return FRAME_NEED_MORE;
+
+        if (!_verify(type, sync)) {
+            _head += 1;
+            skipped += 1;
+            return FRAME_CORRUPTED;
+        }
+
+        frame = sync;
+        _head += size;
+        return FRAME_FOUND;
+    }
+
+    const sl_u8* LidarRxRing::_findSync(LidarFrameType type, const sl_u8* begin, const sl_u8* end)
+    {
+        // returns the first position which may start a frame, a lone first sync byte at the end is kept
+        const sl_u8* pos = begin;
+        switch (type) {
+        case LIDAR_FRAME_ANS_HEADER:
+            while (pos < end) {
+                pos = (const sl_u8*)memchr(pos, SL_LIDAR_ANS_SYNC_BYTE1, end - pos);
+                if (!pos) return end;
+                if (pos + 1 == end || pos[1] == SL_LIDAR_ANS_SYNC_BYTE2) return pos;
+                ++pos;
+            }
+            return end;
+
+        case LIDAR_FRAME_HQ_CAPSULE:
+            pos = (const sl_u8*)memchr(pos, SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC, end - pos);
+            return pos ? pos : end;
+
+        case LIDAR_FRAME_CAPSULE:
+        case LIDAR_FRAME_ULTRA_CAPSULE:
+            for (; pos < end; ++pos) {
+                if ((pos[0] >> 4) != SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1) continue;
+                if (pos + 1 == end || (pos[1] >> 4) == SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2) return pos;
+            }
+            return end;
+
+        case LIDAR_FRAME_MEASUREMENT_NODE:
+            // the sync bit and its reverse in the first byte, the check bit in the second one
+            for (; pos < end; ++pos) {
+                if (!((pos[0] ^ (pos[0] >> 1)) & 0x1)) continue;
+                if (pos + 1 == end || (pos[1] & SL_LIDAR_RESP_MEASUREMENT_CHECKBIT)) return pos;
+            }
+            return end;
+        }
+        return end;
+    }
+
+    bool LidarRxRing::_verify(LidarFrameType type, const sl_u8* frame)
+    {
+        switch (type) {
+        case LIDAR_FRAME_CAPSULE:
+        {
+            const sl_lidar_response_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_capsule_measurement_nodes_t*>(frame);
+            const size_t start = offsetof(sl_lidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
+            sl_u8 recvChecksum = ((capsule->s_checksum_1 & 0xF) | (capsule->s_checksum_2 << 4));
+            return xorChecksum(frame + start, sizeof(*capsule) - start) == recvChecksum;
+        }
+        case LIDAR_FRAME_ULTRA_CAPSULE:
+        {
+            const sl_lidar_response_ultra_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_ultra_capsule_measurement_nodes_t*>(frame);
+            const size_t start = offsetof(sl_lidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6);
+            sl_u8 recvChecksum = ((capsule->s_checksum_1 & 0xF) | (capsule->s_checksum_2 << 4));
+            return xorChecksum(frame + start, sizeof(*capsule) - start) == recvChecksum;
+        }
+        case LIDAR_FRAME_HQ_CAPSULE:
+        {
+            const sl_lidar_response_hq_capsule_measurement_nodes_t* capsule = reinterpret_cast<const sl_lidar_response_hq_capsule_measurement_nodes_t*>(frame);
+            sl_u32 crcCalc = crc32::getResult(const_cast<sl_u8*>(frame), sizeof(*capsule) - 4);
+            return crcCalc == capsule->crc32;
+        }
+        default:
+            // no checksum in the frame
+            return true;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include <atomic>
+
+namespace sl {
+
+    enum LidarFrameType
+    {
+        LIDAR_FRAME_ANS_HEADER = 0,     // sl_lidar_ans_header_t
+        LIDAR_FRAME_MEASUREMENT_NODE,   // sl_lidar_response_measurement_node_t
+        LIDAR_FRAME_CAPSULE,            // sl_lidar_response_capsule_measurement_nodes_t and the dense variant
+        LIDAR_FRAME_ULTRA_CAPSULE,      // sl_lidar_response_ultra_capsule_measurement_nodes_t
+        LIDAR_FRAME_HQ_CAPSULE,         // sl_lidar_response_hq_capsule_measurement_nodes_t
+    };
+
+    /**
+    * Receive buffer shared by all the response and measurement parsers
+    *
+    * Data is pulled from the channel in bulk, as much as available at once, and frames are
+    * located and verified in place. A frame handed out by nextFrame() points into the buffer
+    * and stays valid until the next call to fill(), read() or clear().
+    *
+    * Every chunk read from the channel is stamped with the monotonic time (getns) at which it
+    * became available, so a frame can be traced back to the arrival of its first byte.
+    */
+    class LidarRxRing
+    {
+    public:
+        enum
+        {
+            CAPACITY = 8192,
+            MAX_CHUNK_MARKS = 64,
+        };
+
+        enum
+        {
+            FRAME_FOUND = 0,
+            FRAME_NEED_MORE = 1,
+            FRAME_CORRUPTED = 2,
+        };
+
+        LidarRxRing();
+
+        void clear();
+
+        size_t size() const
+        {
+            return _tail - _head;
+        }
+
+        /// Make sure at least wanted bytes are buffered, pulling everything the channel has ready
+        /// \return false if the data is not available within the timeout
+        bool fill(IChannel* channel, size_t wanted, sl_u32 timeout);
+
+        /// Take whatever a pollable channel has ready, without waiting
+        /// \return false if the channel reported an error
+        bool pull(IChannel* channel);
+
+        /// Copy buffered bytes out, returns the number of bytes copied
+        size_t read(void* buffer, size_t size);
+
+        /// Locate the next frame of the given type
+        ///
+        /// \param frame    Receives the start of the frame when FRAME_FOUND is returned
+        /// \param skipped  Receives the number of bytes discarded while searching for the sync pattern
+        ///
+        /// Returns FRAME_NEED_MORE if no complete frame is buffered yet, the partial frame is kept.
+        /// Returns FRAME_CORRUPTED if a frame failed its checksum, scanning resumes right after its first byte.
+        int nextFrame(LidarFrameType type, const sl_u8 *& frame, size_t & skipped);
+
+        /// Arrival time (nanoseconds, monotonic clock) of the chunk holding the given buffered byte,
+        /// typically the first byte of a frame returned by nextFrame()
+        ///
+        /// \param trailing  Receives the number of bytes of the chunk from data onwards, the bytes
+        ///                  after the frame have been sampled by the device later than the frame itself
+        sl_u64 arrivalTime(const sl_u8* data, size_t* trailing = NULL) const;
+
+        /// Total number of bytes read from the channel, it can be read from any thread
+        sl_u64 bytesReceived() const
+        {
+            return _received.load(std::memory_order_relaxed);
+        }
+
+        static size_t frameSize(LidarFrameType type);
+
+    protected:
+        struct ChunkMark
+        {
+            size_t  end;    // buffer offset right after the last byte of the chunk
+            sl_u64  ns;
+        };
+
+        void _compact();
+        void _markChunk(sl_u64 ns);
+        void _countReceived(size_t bytes);
+
+        static const sl_u8* _findSync(LidarFrameType type, const sl_u8* begin, const sl_u8* end);
+        static bool _verify(LidarFrameType type, const sl_u8* frame);
+
+        sl_u8   _buf[CAPACITY];
+        size_t  _head;
+        size_t  _tail;
+
+        ChunkMark _marks[MAX_CHUNK_MARKS];
+        size_t    _markCount;
+
+        // only the reading thread updates it, the other threads just load it
+        std::atomic<sl_u64> _received;
+    };
+}
@@ -0,0 +1,238 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_scan_order.h"
+#include <assert.h>
+#include <algorithm>
+
+namespace sl { namespace scan_order {
+
+    typedef sl_lidar_response_measurement_node_hq_t node_hq_t;
+
+    enum
+    {
+        // angle_z_q14 counts 16384 per 90 degrees
+        FULL_TURN_Q14 = 65536,
+        // a step back of more than half a turn is the wrap at 360 degrees, not a local disorder
+        WRAP_MIN_STEP_Q14 = FULL_TURN_Q14 / 2,
+        // nodes the insertion pass may shift per node of the scan before the full sort takes over
+        MAX_INSERTION_MOVES_PER_NODE = 8,
+    };
+
+    static inline bool angleLessQ14(const node_hq_t& a, const node_hq_t& b)
+    {
+        return a.angle_z_q14 < b.angle_z_q14;
+    }
+
+    // Same interpolation as the floating point version: the first node, when invalid, is extrapolated
+    // back from the first valid one, then every other invalid node is placed as if the samples of the
+    // scan were evenly spaced from the first node. The angles are 16.16 fixed point q14 values, the
+    // truncation to 16 bits wraps them at 360 degrees.
+    static bool fillInvalidAngles(node_hq_t* nodebuffer, size_t count)
+    {
+        size_t first = 0;
+        while (first < count && !nodebuffer[first].dist_mm_q2) ++first;
+        if (first == count) return false;
+
+        sl_s64 inc = ((sl_s64)FULL_TURN_Q14 << 16) / (sl_s64)count;
+        if (first) {
+            sl_s64 head = ((sl_s64)nodebuffer[first].angle_z_q14 << 16) - (sl_s64)first * inc;
+            nodebuffer[0].angle_z_q14 = head > 0 ? (sl_u16)(head >> 16) : 0;
+        }
+
+        sl_s64 angle = (sl_s64)nodebuffer[0].angle_z_q14 << 16;
+        for (size_t i = 1; i < count; ++i) {
+            angle += inc;
+            if (!nodebuffer[i].dist_mm_q2) nodebuffer[i].angle_z_q14 = (sl_u16)(angle >> 16);
+        }
+        return true;
+    }
+
+    // Finish a nearly sorted run, stable. It gives up once more than maxMoves nodes have been shifted,
+    // the nodes are still a permutation of the input then.
+    static bool insertionPass(node_hq_t* nodebuffer, sl_u64* timestamps, size_t count, size_t maxMoves)
+    {
+        size_t moves = 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (!angleLessQ14(nodebuffer[i], nodebuffer[i - 1])) continue;
+
+            node_hq_t node = nodebuffer[i];
+            sl_u64 timestamp = timestamps ? timestamps[i] : 0;
+            size_t pos = i;
+            do {
+                nodebuffer[pos] = nodebuffer[pos - 1];
+                if (timestamps) timestamps[pos] = timestamps[pos - 1];
+                --pos;
+            } while (pos && angleLessQ14(node, nodebuffer[pos - 1]));
+            nodebuffer[pos] = node;
+            if (timestamps) timestamps[pos] = timestamp;
+
+            moves += i - pos;
+            if (moves > maxMoves) return false;
+        }
+        return true;
+    }
+
+    // Stable counting sort over the low, then the high byte of the angle
+    static void countingSort(node_hq_t* nodebuffer, sl_u64* timestamps, size_t count, node_hq_t* scratchNodes, sl_u64* scratchTimestamps)
+    {
+        size_t offsets[2][256] = {};
+        for (size_t i = 0; i < count; ++i) {
+            ++offsets[0][nodebuffer[i].angle_z_q14 & 0xFF];
+            ++offsets[1][nodebuffer[i].angle_z_q14 >> 8];
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            size_t sum = 0;
+            for (int key = 0; key < 256; ++key) {
+                size_t keyCount = offsets[pass][key];
+                offsets[pass][key] = sum;
+                sum += keyCount;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t pos = offsets[0][nodebuffer[i].angle_z_q14 & 0xFF]++;
+            scratchNodes[pos] = nodebuffer[i];
+            if (timestamps) scratchTimestamps[pos] = timestamps[i];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t pos = offsets[1][scratchNodes[i].angle_z_q14 >> 8]++;
+            nodebuffer[pos] = scratchNodes[i];
+            if (timestamps) timestamps[pos] = scratchTimestamps[i];
+        }
+    }
+
+    sl_result ascendQ14(node_hq_t* nodebuffer, sl_u64* timestamps, size_t count, node_hq_t* scratchNodes, sl_u64* scratchTimestamps)
+    {
+        assert(!timestamps || (scratchNodes && scratchTimestamps));
+
+        if (!count || !fillInvalidAngles(nodebuffer, count)) return SL_RESULT_OPERATION_FAIL;
+
+        // the largest step back is where the scan wraps at 360 degrees
+        size_t wrap = 0;
+        int wrapStep = 0;
+        for (size_t i = 1; i < count; ++i) {
+            int step = (int)nodebuffer[i - 1].angle_z_q14 - (int)nodebuffer[i].angle_z_q14;
+            if (step > wrapStep) {
+                wrapStep = step;
+                wrap = i;
+            }
+        }
+        if (!wrapStep) return SL_RESULT_OK;
+
+        if (wrapStep >= WRAP_MIN_STEP_Q14) {
+            std::rotate(nodebuffer, nodebuffer + wrap, nodebuffer + count);
+            if (timestamps) std::rotate(timestamps, timestamps + wrap, timestamps + count);
+        }
+        if (insertionPass(nodebuffer, timestamps, count, count * MAX_INSERTION_MOVES_PER_NODE)) return SL_RESULT_OK;
+
+        if (scratchNodes) {
+            countingSort(nodebuffer, timestamps, count, scratchNodes, scratchTimestamps);
+        }
+        else {
+            std::stable_sort(nodebuffer, nodebuffer + count, &angleLessQ14);
+        }
+        return SL_RESULT_OK;
+    }
+
+    static inline float getAngle(const node_hq_t& node)
+    {
+        return node.angle_z_q14 * 90.f / 16384.f;
+    }
+
+    static inline void setAngle(node_hq_t& node, float v)
+    {
+        node.angle_z_q14 = sl_u32(v * 16384.f / 90.f);
+    }
+
+    static bool angleLessThan(const node_hq_t& a, const node_hq_t& b)
+    {
+        return getAngle(a) < getAngle(b);
+    }
+
+    sl_result ascendFloat(node_hq_t* nodebuffer, size_t count)
+    {
+        float inc_origin_angle = 360.f / count;
+        size_t i = 0;
+
+        //Tune head
+        for (i = 0; i < count; i++) {
+            if (nodebuffer[i].dist_mm_q2 == 0) {
+                continue;
+            }
+            else {
+                while (i != 0) {
+                    i--;
+                    float expect_angle = getAngle(nodebuffer[i + 1]) - inc_origin_angle;
+                    if (expect_angle < 0.0f) expect_angle = 0.0f;
+                    setAngle(nodebuffer[i], expect_angle);
+                }
+                break;
+            }
+        }
+
+        // all the data is invalid
+        if (i == count) return SL_RESULT_OPERATION_FAIL;
+
+        //Tune tail
+        for (i = count - 1; i >= 0; i--) {
+            if (nodebuffer[i].dist_mm_q2 == 0) {
+                continue;
+            }
+            else {
+                while (i != (count - 1)) {
+                    i++;
+                    float expect_angle = getAngle(nodebuffer[i - 1]) + inc_origin_angle;
+                    if (expect_angle > 360.0f) expect_angle -= 360.0f;
+                    setAngle(nodebuffer[i], expect_angle);
+                }
+                break;
+            }
+        }
+
+        //Fill invalid angle in the scan
+        float frontAngle = getAngle(nodebuffer[0]);
+        for (i = 1; i < count; i++) {
+            if (nodebuffer[i].dist_mm_q2 == 0) {
+                float expect_angle = frontAngle + i * inc_origin_angle;
+                if (expect_angle > 360.0f) expect_angle -= 360.0f;
+                setAngle(nodebuffer[i], expect_angle);
+            }
+        }
+
+        // Reorder the scan according to the angle value
+        std::sort(nodebuffer, nodebuffer + count, &angleLessThan);
+
+        return SL_RESULT_OK;
+    }
+}}
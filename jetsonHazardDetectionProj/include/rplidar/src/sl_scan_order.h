@@ -0,0 +1,61 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+
+namespace sl { namespace scan_order {
+
+    /**
+    * Reordering of a revolution by ascending angle, behind ILidarDriver::ascendScanData
+    *
+    * Nodes without a distance first get an angle interpolated from the valid ones, then the nodes
+    * are sorted by angle_z_q14. A revolution from the device is already ascending apart from the
+    * wrap at 360 degrees and a few small steps back, so the run is rotated at the wrap and finished
+    * with an insertion pass. Only a scan far from that shape falls back to a full sort. Everything
+    * is done on the q14 angles, 65536 of them make a full turn.
+    */
+
+    /// Sort nodebuffer in place, the timestamps (may be NULL) are moved along with their nodes
+    /// The full sort fallback is a counting sort through scratchNodes and scratchTimestamps, each holding count items.
+    /// Without scratch buffers it falls back to std::stable_sort, timestamps must be NULL in that case.
+    ///
+    /// The interface will return SL_RESULT_OPERATION_FAIL and leave the nodes untouched when none of them has a distance.
+    sl_result ascendQ14(sl_lidar_response_measurement_node_hq_t* nodebuffer, sl_u64* timestamps, size_t count,
+        sl_lidar_response_measurement_node_hq_t* scratchNodes = NULL, sl_u64* scratchTimestamps = NULL);
+
+    /// The former floating point implementation of ascendScanData, kept as the reference to compare with
+    sl_result ascendFloat(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t count);
+}}
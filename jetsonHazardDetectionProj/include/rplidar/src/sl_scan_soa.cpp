@@ -0,0 +1,103 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_scan_soa.h"
+#include <math.h>
+
+namespace sl { namespace scan_soa {
+
+    enum
+    {
+        QUARTER_TURN_Q14 = 16384,
+    };
+
+    // sin of [0, 90] degrees for every q14 step, 64KB filled on first use
+    struct QuarterSineTable
+    {
+        float value[QUARTER_TURN_Q14 + 1];
+
+        QuarterSineTable()
+        {
+            const double step = 3.14159265358979323846 / 2 / QUARTER_TURN_Q14;
+            for (int i = 0; i <= QUARTER_TURN_Q14; ++i) {
+                value[i] = (float)sin(i * step);
+            }
+        }
+    };
+
+    static const QuarterSineTable& quarterSine()
+    {
+        // function statics are initialized once and thread safe, concurrent drivers never race on them
+        static const QuarterSineTable table;
+        return table;
+    }
+
+    // the quadrant mirrors the index in odd quadrants and gives the signs of sin and cos
+    static inline void lookup(const QuarterSineTable& table, sl_u32 angle, float& sinValue, float& cosValue)
+    {
+        sl_u32 quadrant = (angle >> 14) & 3;
+        sl_u32 index = angle & (QUARTER_TURN_Q14 - 1);
+        if (quadrant & 1) index = QUARTER_TURN_Q14 - index;
+
+        sinValue = table.value[index];
+        cosValue = table.value[QUARTER_TURN_Q14 - index];
+        if (quadrant & 2) sinValue = -sinValue;
+        if ((quadrant + 1) & 2) cosValue = -cosValue;
+    }
+
+    void splitNodes(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u16* angle_q14, sl_u32* dist_q2, sl_u8* quality)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            angle_q14[i] = nodes[i].angle_z_q14;
+            dist_q2[i] = nodes[i].dist_mm_q2;
+            quality[i] = nodes[i].quality;
+        }
+    }
+
+    void toCartesian(const sl_u16* angle_q14, const sl_u32* dist_q2, size_t count, float* x, float* y)
+    {
+        const QuarterSineTable& table = quarterSine();
+        for (size_t i = 0; i < count; ++i) {
+            float sinValue, cosValue;
+            lookup(table, angle_q14[i], sinValue, cosValue);
+            float distance = dist_q2[i] * 0.25f;
+            x[i] = distance * cosValue;
+            y[i] = distance * sinValue;
+        }
+    }
+
+    void sinCosQ14(sl_u16 angle_q14, float& sinValue, float& cosValue)
+    {
+        lookup(quarterSine(), angle_q14, sinValue, cosValue);
+    }
+}}
@@ -0,0 +1,59 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+
+namespace sl { namespace scan_soa {
+
+    /**
+    * Structure-of-arrays form of a scan, published along with the packed nodes
+    *
+    * The packed HQ node forces unaligned loads and every consumer converts its angle and distance
+    * again. The driver splits the scan into one aligned array per field once, and can add the
+    * Cartesian coordinates of the nodes. sin / cos come from a table indexed by the q14 angle
+    * folded into the first quadrant, so the coordinates are exact to the q14 resolution.
+    */
+
+    /// Copy the fields of count nodes into parallel arrays
+    void splitNodes(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u16* angle_q14, sl_u32* dist_q2, sl_u8* quality);
+
+    /// Coordinates of count samples in millimeters, x points to 0 degree and y to 90 degree
+    /// A sample without a distance is placed at (0, 0).
+    void toCartesian(const sl_u16* angle_q14, const sl_u32* dist_q2, size_t count, float* x, float* y);
+
+    /// sin and cos of a q14 angle (16384 per 90 degrees) from the lookup table
+    void sinCosQ14(sl_u16 angle_q14, float& sinValue, float& cosValue);
+}}
@@ -0,0 +1,116 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#include "sl_scan_view.h"
+
+namespace sl { namespace scan_view {
+
+    enum
+    {
+        FULL_TURN_Q14 = 65536,
+        NO_NODE = 0xFFFFFFFF,
+    };
+
+    static sl_u32 degreeToQ14(float degree)
+    {
+        return (sl_u32)(degree * 16384.f / 90.f + 0.5f);
+    }
+
+    bool makeFilter(const LidarScanViewDesc& desc, ViewFilter& filter)
+    {
+        if (desc.window_count > LIDAR_SCAN_VIEW_MAX_WINDOWS) return false;
+        if (!(desc.min_distance_mm >= 0) || !(desc.max_distance_mm >= 0)) return false;
+        if (desc.max_distance_mm && desc.max_distance_mm < desc.min_distance_mm) return false;
+        if (desc.bin_degree && !(desc.bin_degree >= 0.1f && desc.bin_degree <= 360)) return false;
+
+        for (size_t i = 0; i < desc.window_count; ++i) {
+            const LidarAngleWindow& window = desc.windows[i];
+            if (!(window.start_degree >= 0 && window.start_degree <= 360 && window.end_degree >= 0 && window.end_degree <= 360)) return false;
+            filter.window_start_q14[i] = degreeToQ14(window.start_degree);
+            filter.window_end_q14[i] = degreeToQ14(window.end_degree);
+        }
+        filter.window_count = desc.window_count;
+        filter.min_quality = desc.min_quality;
+        filter.min_dist_q2 = (sl_u32)(desc.min_distance_mm * 4);
+        filter.max_dist_q2 = desc.max_distance_mm ? (sl_u32)(desc.max_distance_mm * 4) : 0xFFFFFFFF;
+
+        filter.bin_width_q14 = desc.bin_degree ? degreeToQ14(desc.bin_degree) : 0;
+        filter.bin_count = filter.bin_width_q14 ? (FULL_TURN_Q14 + filter.bin_width_q14 - 1) / filter.bin_width_q14 : 0;
+        return filter.bin_count <= MAX_BINS;
+    }
+
+    static inline bool inWindows(const ViewFilter& filter, sl_u32 angle)
+    {
+        if (!filter.window_count) return true;
+        for (size_t i = 0; i < filter.window_count; ++i) {
+            sl_u32 start = filter.window_start_q14[i];
+            sl_u32 end = filter.window_end_q14[i];
+            if (start <= end ? (angle >= start && angle < end) : (angle >= start || angle < end)) return true;
+        }
+        return false;
+    }
+
+    static inline bool selected(const ViewFilter& filter, const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        return node.dist_mm_q2 && node.dist_mm_q2 >= filter.min_dist_q2 && node.dist_mm_q2 <= filter.max_dist_q2
+            && node.quality >= filter.min_quality && inWindows(filter, node.angle_z_q14);
+    }
+
+    size_t apply(const ViewFilter& filter, const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps, size_t count,
+        sl_lidar_response_measurement_node_hq_t* outNodes, sl_u64* outTimestamps, sl_u32* bins)
+    {
+        size_t selectedCount = 0;
+        if (!filter.bin_width_q14) {
+            for (size_t i = 0; i < count; ++i) {
+                if (!selected(filter, nodes[i])) continue;
+                outNodes[selectedCount] = nodes[i];
+                outTimestamps[selectedCount++] = timestamps[i];
+            }
+            return selectedCount;
+        }
+
+        // min pooling: every bin remembers its nearest node, then the bins are emitted in angle order
+        for (size_t bin = 0; bin < filter.bin_count; ++bin) bins[bin] = NO_NODE;
+        for (size_t i = 0; i < count; ++i) {
+            if (!selected(filter, nodes[i])) continue;
+            sl_u32& best = bins[nodes[i].angle_z_q14 / filter.bin_width_q14];
+            if (best == NO_NODE || nodes[i].dist_mm_q2 < nodes[best].dist_mm_q2) best = (sl_u32)i;
+        }
+        for (size_t bin = 0; bin < filter.bin_count; ++bin) {
+            if (bins[bin] == NO_NODE) continue;
+            outNodes[selectedCount] = nodes[bins[bin]];
+            outTimestamps[selectedCount++] = timestamps[bins[bin]];
+        }
+        return selectedCount;
+    }
+}}
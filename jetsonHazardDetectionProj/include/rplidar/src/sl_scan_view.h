@@ -0,0 +1,69 @@
+/*
+ * Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl { namespace scan_view {
+
+    enum
+    {
+        // enough for bins of 0.1 degree, the smallest allowed
+        MAX_BINS = 4096,
+    };
+
+    /**
+    * LidarScanViewDesc converted to the units of the nodes: q14 angles and q2 distances
+    */
+    struct ViewFilter
+    {
+        sl_u32  window_start_q14[LIDAR_SCAN_VIEW_MAX_WINDOWS];
+        sl_u32  window_end_q14[LIDAR_SCAN_VIEW_MAX_WINDOWS];
+        size_t  window_count;
+        sl_u8   min_quality;
+        sl_u32  min_dist_q2;
+        sl_u32  max_dist_q2;
+        sl_u32  bin_width_q14;   // 0 when the view keeps every node
+        size_t  bin_count;
+    };
+
+    /// \return false if the descriptor is out of range
+    bool makeFilter(const LidarScanViewDesc& desc, ViewFilter& filter);
+
+    /// Copy the nodes of the scan selected by filter to outNodes / outTimestamps, which hold count items
+    /// bins is the scratch space of the decimation, MAX_BINS items.
+    /// \return the number of nodes selected
+    size_t apply(const ViewFilter& filter, const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps, size_t count,
+        sl_lidar_response_measurement_node_hq_t* outNodes, sl_u64* outTimestamps, sl_u32* bins);
+}}
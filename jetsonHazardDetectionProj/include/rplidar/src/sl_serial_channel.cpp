@@ -95,6 +95,17 @@ namespace sl {
             return lenRec;
         }
 
+        int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+        {
+            if (_closePending) return 0;
+            return _rxtxSerial->waitandrecv((sl_u8 *)buffer, size, minSize, timeoutInMs);
+        }
+
+        int getPollHandle()
+        {
+            return _rxtxSerial->getPollHandle();
+        }
+
         void clearReadCache()
         {
            
@@ -105,6 +116,19 @@ namespace sl {
             dtr ? _rxtxSerial->setDTR() : _rxtxSerial->clearDTR();
         }
 
+        bool setBaudRate(int baudrate)
+        {
+            _baudrate = baudrate;
+            _rxtxSerial->close();
+            return open();
+        }
+
+        int getBaudRate()
+        {
+            sl_u32 actual = _rxtxSerial->getBaudRate();
+            return actual ? (int)actual : _baudrate;
+        }
+
     private:
         rp::hal::serial_rxtx  * _rxtxSerial;
         bool _closePending;
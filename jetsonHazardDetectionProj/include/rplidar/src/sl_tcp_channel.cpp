@@ -31,21 +31,47 @@
   */
 
 #pragma once
+#include "sdkcommon.h"
 #include "sl_lidar_driver.h"
 #include "hal/abs_rxtx.h"
 #include "hal/socket.h"
+#include <atomic>
+#include <vector>
 
 
 namespace sl {
     
-    class TcpChannel : public IChannel
+    class TcpChannel : public ITcpChannel
     {
     public:
-        TcpChannel(const std::string& ip, int port) : _binded_socket(rp::net::StreamSocket::CreateSocket()) {
+        enum {
+            // what a lidar sends in several milliseconds at 100 Mbit/s
+            RX_RING_SIZE = 64 * 1024,
+        };
+
+        TcpChannel(const std::string& ip, int port)
+            : _binded_socket(rp::net::StreamSocket::CreateSocket())
+            , _ring(RX_RING_SIZE)
+            , _head(0)
+            , _tail(0)
+            , _drained(false)
+            , _noDelay(true)
+            , _receiveBufferSize(0)
+            , _busyPollUs(0)
+            , _bytes(0)
+            , _receiveCalls(0)
+            , _waitCalls(0)
+            , _bytesBuffered(0)
+        {
             _ip = ip;
             _port = port;
         }
 
+        ~TcpChannel()
+        {
+            close();
+        }
+
         bool bind(const std::string & ip, sl_s32 port)
         {
             _socket = rp::net::SocketAddress(ip.c_str(), port);
@@ -54,16 +80,26 @@ namespace sl {
 
         bool open()
         {
+            if (!_binded_socket)
+                _binded_socket = rp::net::StreamSocket::CreateSocket();
+            if (!_binded_socket)
+                return false;
             if(SL_IS_FAIL(bind(_ip, _port)))
                 return false;
+            _head = _tail = 0;
+            _drained = false;
+            // the receive buffer size has to be set before connecting to scale the window
+            _applyTuning();
             return IS_OK(_binded_socket->connect(_socket));
             
         }
 
         void close()
         {
-            _binded_socket->dispose();
-            _binded_socket = NULL;
+            if (_binded_socket) {
+                _binded_socket->dispose();
+                _binded_socket = NULL;
+            }
         }
         void flush()
         {
@@ -72,35 +108,193 @@ namespace sl {
 
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
+            bool ready = _waitBuffered(size, timeoutInMs);
             if (actualReady)
-                *actualReady = size;
-            return (_binded_socket->waitforData(timeoutInMs) == RESULT_OK);
-
+                *actualReady = _tail - _head;
+            return ready;
         }
 
         int write(const void* data, size_t size)
         {
-            return _binded_socket->send(data, size);
+            if (!_binded_socket)
+                return -1;
+            if (IS_FAIL(_binded_socket->send(data, size)))
+                return -1;
+            return (int)size;
         }
 
         int read(void* buffer, size_t size)
         {
-            size_t lenRec = 0;
-            _binded_socket->recv(buffer, size, lenRec);
-            return lenRec;
+            if (!_binded_socket)
+                return -1;
+            size_t got = _copyOut(buffer, size);
+            if (got < size && !_receiveInto((sl_u8*)buffer, size, got))
+                return got ? (int)got : -1;
+            return (int)got;
+        }
+
+        int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+        {
+            if (!_binded_socket)
+                return -1;
+            size_t got = _copyOut(buffer, size);
+            if (got == size)
+                return (int)got;
+
+            // straight into the reader's buffer, one receive takes everything queued that fits
+            sl_u32 startTs = getms();
+            for (;;) {
+                if (_drained && got < minSize && !_waitReadable(startTs, timeoutInMs))
+                    break;
+                if (!_receiveInto((sl_u8*)buffer, size, got))
+                    return got ? (int)got : -1;
+                if (got >= minSize || got == size)
+                    break;
+            }
+            return (int)got;
+        }
+
+        int getPollHandle()
+        {
+            return _binded_socket ? _binded_socket->getPollHandle() : -1;
+        }
+
+        void clearReadCache()
+        {
+            _head = _tail = 0;
+        }
+
+        bool setNoDelay(bool enable)
+        {
+            _noDelay = enable;
+            return !_binded_socket || IS_OK(_binded_socket->enableNoDelay(enable));
+        }
+
+        bool setReceiveBufferSize(size_t bytes)
+        {
+            _receiveBufferSize = bytes;
+            return !_binded_socket || IS_OK(_binded_socket->setReceiveBufferSize(bytes));
+        }
+
+        bool setBusyPoll(sl_u32 microseconds)
+        {
+            _busyPollUs = microseconds;
+            return !_binded_socket || IS_OK(_binded_socket->setBusyPoll(microseconds));
         }
 
-        void clearReadCache() {}
+        void getStatistics(TcpChannelStatistics& stats)
+        {
+            stats.bytes_received = _bytes.load(std::memory_order_relaxed);
+            stats.receive_calls = _receiveCalls.load(std::memory_order_relaxed);
+            stats.wait_calls = _waitCalls.load(std::memory_order_relaxed);
+            stats.bytes_buffered = _bytesBuffered.load(std::memory_order_relaxed);
+        }
 
         void setStatus(_u32 flag){}
     private:
+        void _applyTuning()
+        {
+            _binded_socket->enableNoDelay(_noDelay);
+            if (_receiveBufferSize)
+                _binded_socket->setReceiveBufferSize(_receiveBufferSize);
+            if (_busyPollUs)
+                _binded_socket->setBusyPoll(_busyPollUs);
+        }
+
+        static void _add(std::atomic<sl_u64>& counter, sl_u64 value)
+        {
+            // a single thread receives, the counters are only read from other threads
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        // one non-blocking receive into buffer + got, a short one means the socket is drained
+        bool _receiveInto(sl_u8* buffer, size_t size, size_t& got)
+        {
+            size_t len = 0;
+            u_result ans = _binded_socket->recvNoWait(buffer + got, size - got, len);
+            _add(_receiveCalls, 1);
+            if (IS_FAIL(ans))
+                return false;
+            _add(_bytes, len);
+            _drained = len < size - got;
+            got += len;
+            return true;
+        }
+
+        bool _waitReadable(sl_u32 startTs, sl_u32 timeoutInMs)
+        {
+            sl_u32 remaining = timeoutInMs;
+            if (timeoutInMs != (sl_u32)-1) {
+                sl_u32 elapsed = getms() - startTs;
+                remaining = elapsed < timeoutInMs ? timeoutInMs - elapsed : 0;
+            }
+            _add(_waitCalls, 1);
+            return _binded_socket->waitforData(remaining) == RESULT_OK;
+        }
+
+        // take the queued bytes into the ring until size of them are ready
+        bool _waitBuffered(size_t size, sl_u32 timeoutInMs)
+        {
+            if (!_binded_socket)
+                return false;
+            if (size > RX_RING_SIZE)
+                size = RX_RING_SIZE;
+            if (_tail - _head >= size)
+                return true;
+
+            if (_head) {
+                memmove(&_ring[0], &_ring[_head], _tail - _head);
+                _tail -= _head;
+                _head = 0;
+            }
+            sl_u32 startTs = getms();
+            for (;;) {
+                if (_drained && !_waitReadable(startTs, timeoutInMs))
+                    return false;
+                size_t before = _tail;
+                if (!_receiveInto(&_ring[0], RX_RING_SIZE, _tail))
+                    return false;
+                _add(_bytesBuffered, _tail - before);
+                if (_tail >= size)
+                    return true;
+            }
+        }
+
+        size_t _copyOut(void* buffer, size_t size)
+        {
+            size_t ready = _tail - _head;
+            if (!ready)
+                return 0;
+            if (size > ready)
+                size = ready;
+            memcpy(buffer, &_ring[_head], size);
+            _head += size;
+            if (_head == _tail)
+                _head = _tail = 0;
+            return size;
+        }
+
         rp::net::StreamSocket * _binded_socket;
         rp::net::SocketAddress _socket;
         std::string _ip;
         int _port;
+
+        std::vector<sl_u8> _ring;
+        size_t _head;
+        size_t _tail;
+        bool _drained;
+
+        bool _noDelay;
+        size_t _receiveBufferSize;
+        sl_u32 _busyPollUs;
+
+        std::atomic<sl_u64> _bytes;
+        std::atomic<sl_u64> _receiveCalls;
+        std::atomic<sl_u64> _waitCalls;
+        std::atomic<sl_u64> _bytesBuffered;
     };
     Result<IChannel*> createTcpChannel(const std::string& ip, int port)
     {
         return new  TcpChannel(ip, port);
     }
-}
\ No newline at end of file
+}
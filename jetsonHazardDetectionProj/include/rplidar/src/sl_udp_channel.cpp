@@ -31,18 +31,46 @@
   */
 
 #pragma once
+#include "sdkcommon.h"
 #include "sl_lidar_driver.h"
 #include "hal/abs_rxtx.h"
 #include "hal/socket.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 
 namespace sl {
-	class UdpChannel : public IChannel
+	class UdpChannel : public IUdpChannel
 	{
 	public:
-		UdpChannel(const std::string& ip, int port) : _binded_socket(rp::net::DGramSocket::CreateSocket()) {
+        enum {
+            // one datagram per slot, the slots are filled by batched receives
+            DATAGRAM_SLOTS = 64,
+            // more than the payload of an Ethernet frame
+            DATAGRAM_SLOT_SIZE = 2048,
+        };
+
+		UdpChannel(const std::string& ip, int port)
+            : _binded_socket(rp::net::DGramSocket::CreateSocket())
+            , _slotData(DATAGRAM_SLOTS * DATAGRAM_SLOT_SIZE)
+            , _datagrams(0)
+            , _bytes(0)
+            , _truncated(0)
+            , _dropped(0)
+            , _receiveCalls(0)
+        {
             _ip = ip;
             _port = port;
+            for (size_t pos = 0; pos < DATAGRAM_SLOTS; ++pos) {
+                _slotPtrs[pos] = &_slotData[pos * DATAGRAM_SLOT_SIZE];
+            }
+            _resetRing();
+        }
+
+        ~UdpChannel()
+        {
+            close();
         }
 
 		bool bind(const std::string & ip, sl_s32 port)
@@ -53,15 +81,22 @@ namespace sl {
 
         bool open()
         {
+            if (!_binded_socket)
+                _binded_socket = rp::net::DGramSocket::CreateSocket();
+            if (!_binded_socket)
+                return false;
             if(SL_IS_FAIL(bind(_ip, _port)))
                 return false;
+            _resetRing();
             return SL_IS_OK(_binded_socket->setPairAddress(&_socket));         
         }
 
         void close()
         {
-            _binded_socket->dispose();
-            _binded_socket = NULL;
+            if (_binded_socket) {
+                _binded_socket->dispose();
+                _binded_socket = NULL;
+            }
         }
         void flush()
         {
@@ -70,47 +105,170 @@ namespace sl {
 
 		bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
+            bool ready = _waitBuffered(size, timeoutInMs);
             if (actualReady)
-                *actualReady = size;
-            return (_binded_socket->waitforData(timeoutInMs) == RESULT_OK);
-
+                *actualReady = _buffered;
+            return ready;
         }
 
         int write(const void* data, size_t size)
         {
-            return _binded_socket->sendTo(NULL, data, size);
+            if (!_binded_socket)
+                return -1;
+            if (IS_FAIL(_binded_socket->sendTo(_socket, data, size)))
+                return -1;
+            return (int)size;
         }
 
         int read(void* buffer, size_t size)
         {
-            u_result ans;
-            size_t recCnt = 0;
-            size_t lenRec = 0;
-            while (size > recCnt)
-            {
-				sl_u8 *temp = (sl_u8 *)buffer+recCnt;
-                ans = _binded_socket->recvFrom(temp, size, lenRec);
-                recCnt += lenRec;
-                if (ans)
-                    break;
-            }
-            return recCnt;
-        
+            if (!_binded_socket)
+                return -1;
+            if (_buffered < size)
+                _receive();
+            return (int)_copyOut(buffer, size);
         }
 
-        void clearReadCache() {}
+        int waitAndRead(void* buffer, size_t size, size_t minSize, sl_u32 timeoutInMs)
+        {
+            if (!_binded_socket)
+                return -1;
+            _waitBuffered(minSize, timeoutInMs);
+            return (int)_copyOut(buffer, size);
+        }
+
+        int getPollHandle()
+        {
+            return _binded_socket ? _binded_socket->getPollHandle() : -1;
+        }
+
+        void clearReadCache()
+        {
+            _resetRing();
+        }
+
+        void getStatistics(UdpChannelStatistics& stats)
+        {
+            stats.datagrams_received = _datagrams.load(std::memory_order_relaxed);
+            stats.bytes_received = _bytes.load(std::memory_order_relaxed);
+            stats.datagrams_truncated = _truncated.load(std::memory_order_relaxed);
+            stats.datagrams_dropped = _dropped.load(std::memory_order_relaxed);
+            stats.receive_calls = _receiveCalls.load(std::memory_order_relaxed);
+        }
 
         void setStatus(_u32 flag){}
 
 	private:
+        void _resetRing()
+        {
+            _head = 0;
+            _headOffset = 0;
+            _filled = 0;
+            _buffered = 0;
+        }
+
+        static void _add(std::atomic<sl_u64>& counter, sl_u64 value)
+        {
+            // a single thread receives, the counters are only read from other threads
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        // take every queued datagram into the free slots, a second call is only made when the free slots wrap
+        void _receive()
+        {
+            while (_filled < DATAGRAM_SLOTS) {
+                size_t tail = (_head + _filled) % DATAGRAM_SLOTS;
+                size_t run = std::min<size_t>(DATAGRAM_SLOTS - _filled, DATAGRAM_SLOTS - tail);
+                size_t received = 0;
+                size_t truncated = 0;
+                u_result ans = _binded_socket->recvBatch(_slotPtrs + tail, DATAGRAM_SLOT_SIZE, run, _slotLens + tail, received, truncated);
+                _add(_receiveCalls, 1);
+                if (IS_FAIL(ans) || !received)
+                    break;
+
+                size_t bytes = 0;
+                for (size_t pos = 0; pos < received; ++pos) {
+                    bytes += _slotLens[tail + pos];
+                }
+                _filled += received;
+                _buffered += bytes;
+                _add(_datagrams, received);
+                _add(_bytes, bytes);
+                _add(_truncated, truncated);
+                if (received < run)
+                    break;
+            }
+
+            _u32 dropped;
+            if (IS_OK(_binded_socket->getDropCount(dropped)))
+                _dropped.store(dropped, std::memory_order_relaxed);
+        }
+
+        // wait until size bytes are buffered, a full ring counts as ready since it has to be read before anything else arrives
+        bool _waitBuffered(size_t size, sl_u32 timeoutInMs)
+        {
+            if (!_binded_socket)
+                return false;
+
+            _receive();
+            sl_u32 startTs = getms();
+            while (_buffered < size && _filled < DATAGRAM_SLOTS) {
+                sl_u32 remaining = timeoutInMs;
+                if (timeoutInMs != (sl_u32)-1) {
+                    sl_u32 elapsed = getms() - startTs;
+                    if (elapsed >= timeoutInMs)
+                        return false;
+                    remaining = timeoutInMs - elapsed;
+                }
+                if (_binded_socket->waitforData(remaining) != RESULT_OK)
+                    return false;
+                _receive();
+            }
+            return true;
+        }
+
+        // copy the buffered bytes out as one stream, releasing the slots read to the end
+        size_t _copyOut(void* buffer, size_t size)
+        {
+            sl_u8* dest = (sl_u8*)buffer;
+            size_t copied = 0;
+            while (copied < size && _filled) {
+                size_t chunk = std::min(_slotLens[_head] - _headOffset, size - copied);
+                memcpy(dest + copied, (sl_u8*)_slotPtrs[_head] + _headOffset, chunk);
+                copied += chunk;
+                _headOffset += chunk;
+                if (_headOffset == _slotLens[_head]) {
+                    _head = (_head + 1) % DATAGRAM_SLOTS;
+                    _headOffset = 0;
+                    --_filled;
+                }
+            }
+            _buffered -= copied;
+            return copied;
+        }
+
 		rp::net::DGramSocket * _binded_socket;
 		rp::net::SocketAddress _socket;
         std::string _ip;
         int _port;
+
+        std::vector<sl_u8> _slotData;
+        void* _slotPtrs[DATAGRAM_SLOTS];
+        size_t _slotLens[DATAGRAM_SLOTS];
+        size_t _head;
+        size_t _headOffset;
+        size_t _filled;
+        size_t _buffered;
+
+        std::atomic<sl_u64> _datagrams;
+        std::atomic<sl_u64> _bytes;
+        std::atomic<sl_u64> _truncated;
+        std::atomic<sl_u64> _dropped;
+        std::atomic<sl_u64> _receiveCalls;
 	};
 
     Result<IChannel*> createUdpChannel(const std::string& ip, int port)
     {
         return new  UdpChannel(ip, port);
     }
-}
\ No newline at end of file
+}
@@ -47,9 +47,9 @@
  * increase readability and also make modifying code less dangerous as you will be less likely to spend
  * time searching for a missing '}'.
  *
- * Currently when more than one lidar array is made the program does not load. If this problem can be
- * fixed we can create a better 2-D point map that can detect things outside of the cameras field of view.
- * This would also allow the jetson to calculate how how fast we are approaching the detected object by
+ * The lidar arrays live on the heap and are sized from the scan mode, so more than one of them can be kept.
+ * This can be used to create a better 2-D point map that can detect things outside of the cameras field of view.
+ * It would also allow the jetson to calculate how how fast we are approaching the detected object by
  * comparing the current lidar array to the previous lidar array.
  *
  * Lasted Edited: 06/09/2022
@@ -64,6 +64,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
 #include <rplidar.h>
 #include "sl_lidar.h"
 #include "sl_lidar_driver.h"
@@ -77,6 +80,27 @@
 #define DEGREE_PER_PIXEL 78/1280
 #define TOLERANCE 0.5
 
+// lidar calibration targets (run with --calibrate)
+#define LIDAR_MIN_POINTS_PER_DEGREE 1.0f
+#define LIDAR_MAX_REVOLUTION_MS 100.0f
+
+// the lidar reports the area in front of the vehicle in sectors of this size, each one as soon as it has been swept
+#define LIDAR_SECTOR_DEGREES 15.0f
+#define LIDAR_SECTOR_COUNT 24
+// an obstacle closer than this in front of the vehicle is a hazard whatever the camera sees
+#define LIDAR_STOP_DISTANCE_MM 1000.0f
+#define LIDAR_MIN_DISTANCE_MM 555.0f
+// the driver filters every revolution down to the area in front of the vehicle, -120 to +120 degrees
+#define LIDAR_FRONT_LEFT_DEGREES 240.0f
+#define LIDAR_FRONT_RIGHT_DEGREES 120.0f
+// the lidar counters are checked this often, a slower rotation is reported as a motor problem
+#define LIDAR_HEALTH_PERIOD_NS 5000000000ULL
+#define LIDAR_MIN_ROTATION_HZ 5.0f
+// no revolution for this long and the lidar link is reopened in the background
+#define LIDAR_STALL_TIMEOUT_MS 1000
+// the lidar decode thread runs realtime on its own core, away from TensorRT and the display (needs CAP_SYS_NICE)
+#define LIDAR_THREAD_CPU 3
+
 //SPI variables
 #define DUMMY_BITS 4
 #define SPI_DATA_LENGTH (104 + DUMMY_BITS)
@@ -143,6 +167,45 @@ uint8_t rxbuffer[SPI_DATA_LENGTH];
 
 uint8_t hex_to_ascii(uint8_t chksum);
 using namespace sl;
+bool calibrate_lidar(ILidarDriver* drv, IChannel* channel, sl_u16 &scan_mode);
+void report_lidar_health(ILidarDriver* drv, LidarStatistics &last);
+
+/*****************************************************************************************
+ * Keeps the closest obstacle in front of the vehicle (between -120 and +120 degrees) up to
+ * date one sector at a time. The lidar driver calls onScanSector from its own thread as soon
+ * as a sector has been swept, so the front check lags by one sector instead of one revolution.
+ ******************************************************************************************/
+class FrontSectorMonitor : public ILidarSectorListener {
+public:
+    FrontSectorMonitor() : closest_mm(12000) {
+        for(int i = 0; i < LIDAR_SECTOR_COUNT; i++){
+            sector_min_mm[i] = 12000;
+        }
+    }
+
+    void onScanSector(const LidarScanSector& sector) {
+        if((sector.start_angle >= 120) && (sector.end_angle <= 240)){
+            return;
+        }
+        float minimum = 12000;
+        for(size_t pos = 0; pos < sector.count; ++pos){
+            float distance = sector.nodes[pos].dist_mm_q2/4.0f;
+            if((distance > LIDAR_MIN_DISTANCE_MM) && (distance < minimum)){
+                minimum = distance;
+            }
+        }
+        sector_min_mm[sector.index % LIDAR_SECTOR_COUNT] = minimum;
+        for(int i = 0; i < LIDAR_SECTOR_COUNT; i++){
+            minimum = std::min(minimum, sector_min_mm[i]);
+        }
+        closest_mm.store(minimum);
+    }
+
+    std::atomic<float> closest_mm;
+
+private:
+    float sector_min_mm[LIDAR_SECTOR_COUNT];
+};
 
 bool signal_recieved = false;
 void sig_handler (int signo){
@@ -152,12 +215,25 @@ void sig_handler (int signo){
 }
 
 
-int main(){
+int main(int argc, char** argv){
     if(signal(SIGINT, sig_handler) == SIG_ERR){
         printf("Signal Error\n");
     } else {
 	
     }
+
+    bool calibrate = false;
+    const char* record_path = NULL;
+    const char* lidar_path = "/dev/ttyUSB0";
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--calibrate") == 0){
+            calibrate = true;
+        } else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc){
+            record_path = argv[++i];
+        } else if(strcmp(argv[i], "--lidar") == 0 && i + 1 < argc){
+            lidar_path = argv[++i];
+        }
+    }
     
 // set up SPI
     spi_config.mode=0;
@@ -191,10 +267,21 @@ int main(){
     }
 
     sl_lidar_response_device_info_t devinfo;
+    FrontSectorMonitor front_monitor;
     bool connectSuccess = false;
     float runningaverage = 4000;
 
-    channel_instance = (*createSerialPortChannel("/dev/ttyUSB0", 115200));
+// --lidar <device> points at another port, e.g. a tools/lidar_emulator pty
+    channel_instance = (*createSerialPortChannel(lidar_path, 115200));
+// --record <file> keeps the raw lidar traffic, createReplayChannel plays it back offline
+    if(record_path){
+        Result<IChannel*> recorder = createRecordingChannel(channel_instance, CHANNEL_TYPE_SERIALPORT, record_path);
+        if(recorder){
+            channel_instance = *recorder;
+        } else {
+            fprintf(stderr, "cannot record the lidar to %s\n", record_path);
+        }
+    }
     if(SL_IS_OK(drv->connect(channel_instance))){
         op_result = drv->getDeviceInfo(devinfo);
         if(SL_IS_OK(op_result)){
@@ -238,17 +325,45 @@ int main(){
     const uint32_t overlayFlags = detectNet::OverlayFlagsFromStr("box,labels,conf");
 
 	// set up moto
+    int front_view = -1;
+    ILidarSupervisor* supervisor = NULL;
     if(connectSuccess){
         drv->setMotorSpeed();
-        drv->startScan(0,1);
+        drv->setScanSectorListener(&front_monitor, LIDAR_SECTOR_DEGREES);
+        drv->setScanPublishOptions(SCAN_PUBLISH_SORTED);
+        LidarThreadPolicy lidar_thread;
+        lidar_thread.priority = LIDAR_THREAD_PRIORITY_REALTIME;
+        lidar_thread.cpu_mask = 1ULL << LIDAR_THREAD_CPU;
+        drv->setScanThreadPolicy(lidar_thread);
+        LidarScanViewDesc front_view_desc = {};
+        front_view_desc.windows[0].start_degree = 0;
+        front_view_desc.windows[0].end_degree = LIDAR_FRONT_RIGHT_DEGREES;
+        front_view_desc.windows[1].start_degree = LIDAR_FRONT_LEFT_DEGREES;
+        front_view_desc.windows[1].end_degree = 360;
+        front_view_desc.window_count = 2;
+        front_view_desc.min_distance_mm = LIDAR_MIN_DISTANCE_MM;
+        drv->addScanView(front_view_desc, front_view);
+        LidarSupervisorConfig supervisor_config;
+        supervisor_config.stall_timeout_ms = LIDAR_STALL_TIMEOUT_MS;
+        if(calibrate && calibrate_lidar(drv, channel_instance, supervisor_config.scan_mode)){
+            supervisor_config.use_typical_scan = false;
+        } else {
+
+        }
+// the supervisor starts the scan and restarts it whenever the lidar stalls (USB unplugged, motor stopped)
+        supervisor = *createLidarSupervisor(drv, channel_instance, supervisor_config);
+        supervisor->start();
     } else {
     
     }
     
+    LidarScanLease scan;
+    LidarStatistics lidar_stats = {};
+    LidarSupervisorState lidar_state = LIDAR_SUPERVISOR_STARTING;
     while(!signal_recieved && connectSuccess){
 // lidar variables
-        sl_lidar_response_measurement_node_hq_t nodes [8192];
-        size_t count = _countof(nodes);
+        const LidarScanView* front = NULL;
+        size_t count = 0;
 // image variable
         uchar3* image = NULL;
 // sensor fusion variables
@@ -259,22 +374,50 @@ int main(){
         float objectdistance = 555;
         float minimumobjectdistance = 12000;
         float lidarangle = 0;
-//grab data from lidar
-        op_result = drv->grabScanDataHq(nodes, count);
+//grab data from lidar, never waits: the latest revolution is used until a newer one arrives
+        op_result = supervisor->grabScanLease(scan);
+        if(supervisor->getState() != lidar_state){
+            lidar_state = supervisor->getState();
+            if(lidar_state == LIDAR_SUPERVISOR_DEGRADED){
+                printf("LIDAR WARNING: no data for %d ms, reconnecting\n", LIDAR_STALL_TIMEOUT_MS);
+            } else if(lidar_state == LIDAR_SUPERVISOR_RUNNING){
+                printf("LIDAR: running\n");
+            } else {
+
+            }
+        } else {
+
+        }
+        if(lidar_state == LIDAR_SUPERVISOR_RUNNING){
+            report_lidar_health(drv, lidar_stats);
+            if(op_result == SL_RESULT_OPERATION_TIMEOUT && scan.valid()){
+                op_result = SL_RESULT_OK;
+            } else {
+
+            }
+        } else {
+// the last revolution is stale, carry on with the camera alone
+            scan.release();
+        }
+        if (SL_IS_OK(op_result)){
+            front = scan.view(front_view);
+            if(front){
+                count = front->count;
+            } else {
+                op_result = SL_RESULT_OPERATION_FAIL;
+            }
+        } else {
+
+        }
         if (SL_IS_OK(op_result)){
 // check for close objects between -120 and +120 degrees
 // take average value. current loop is above running average cation or hazard will be sent
-            drv->ascendScanData(nodes, count);
+// the front view only holds valid returns of that area, sorted by angle
             for(int pos = 0; pos < (int)count; ++pos){
-                lidarangle = nodes[pos].angle_z_q14*90.f/16348.f;
-                if (((lidarangle < 120) && (lidarangle > 0)) | ((lidarangle > 240) && (lidarangle < 359))) {
-                    runningaverage = (runningaverage + nodes[pos].dist_mm_q2)/(4.0f*2.0f);
-                    objectdistance = nodes[pos].dist_mm_q2/(4.0f);
-                    if ((objectdistance < minimumobjectdistance) && (objectdistance > 555)){
-                        minimumobjectdistance = objectdistance;
-                    } else {
-
-                    }
+                runningaverage = (runningaverage + front->nodes[pos].dist_mm_q2)/(4.0f*2.0f);
+                objectdistance = front->nodes[pos].dist_mm_q2/(4.0f);
+                if (objectdistance < minimumobjectdistance){
+                    minimumobjectdistance = objectdistance;
                 } else {
 
                 }
@@ -318,9 +461,9 @@ int main(){
                     }
 // go through each angle reading from the lidar device and wait until the angle measured from the camera is 
                     for(int pos = 0; pos < (int)count; ++pos){
-                        lidarangle = nodes[pos].angle_z_q14*90.f/16348.f;
+                        lidarangle = front->nodes[pos].angle_z_q14*90.f/16348.f;
                         if ((anglemidcamera > (lidarangle - TOLERANCE)) && (anglemidcamera < (lidarangle + TOLERANCE))){
-                            objectdistance = nodes[pos].dist_mm_q2/4.0f;
+                            objectdistance = front->nodes[pos].dist_mm_q2/4.0f;
                         } else {
                         }
                     }
@@ -373,6 +516,20 @@ int main(){
             txbuffer[CHKSUM_MSB_LOCATION_TX] = hex_to_ascii(((chksum >> 4) & 0x0F));
             txbuffer[CHKSUM_LSB_LOCATION_TX] = hex_to_ascii((chksum & 0x0F));
             printf("HAZARD: %X, OBJECT: %X, OBJ_ANGLE: %X", txbuffer[1], txbuffer[3], txbuffer[5]);
+        } else if ((lidar_state == LIDAR_SUPERVISOR_RUNNING) && (front_monitor.closest_mm.load() < LIDAR_STOP_DISTANCE_MM)) {
+// nothing classified by the camera, but the last lidar sectors show an obstacle right in front
+            txbuffer[PREAMBLE_LOCATION_TX] = PREAMBLE;
+            txbuffer[1] = STOP;
+            txbuffer[2] = COMMA;
+            txbuffer[3] = OTHER;
+            txbuffer[4] = COMMA;
+            txbuffer[5] = FRONT;
+            txbuffer[6] = COMMA;
+            txbuffer[ASTERICK_LOCATION_TX] = ASTERICK;
+            chksum = txbuffer[1] ^ txbuffer[2] ^ txbuffer[3] ^ txbuffer[4] ^ txbuffer[5];
+            txbuffer[CHKSUM_MSB_LOCATION_TX] = hex_to_ascii(((chksum >> 4) & 0x0F));
+            txbuffer[CHKSUM_LSB_LOCATION_TX] = hex_to_ascii((chksum & 0x0F));
+            printf("HAZARD: %X, OBJECT: %X, OBJ_ANGLE: %X, Distance: %f", txbuffer[1], txbuffer[3], txbuffer[5], front_monitor.closest_mm.load());
         } else {
         }
 //render image
@@ -422,8 +579,21 @@ int main(){
         chksum_MSB = 0;
         chksum_LSB = 0;
     }
-    drv->stop();
-    drv->setMotorSpeed(0);
+    scan.release();
+    if(supervisor){
+        supervisor->stop();
+        delete supervisor;
+        drv->setMotorSpeed(0);
+// the recording channel writes out what it still buffers when it is deleted
+        if(record_path){
+            delete drv;
+            delete channel_instance;
+        } else {
+
+        }
+    } else {
+
+    }
     delete thespi;
     SAFE_DELETE(input);
     SAFE_DELETE(output);
@@ -450,3 +620,77 @@ uint8_t hex_to_ascii (uint8_t chksum) {
     }
     return result;
 }
+
+/**************************************************************************************************************
+ * bool calibrate_lidar(ILidarDriver* drv, IChannel* channel, sl_u16 &scan_mode)
+ * Description: switch the lidar to the fastest baud rate both ends sustain, then run every scan mode
+ * and pick the one meeting LIDAR_MIN_POINTS_PER_DEGREE and LIDAR_MAX_REVOLUTION_MS. The points per
+ * second achieved by each mode are printed to show why a mode was picked.
+ *
+ *input: connected lidar driver and its serial channel
+ *output: true with the mode to start in scan_mode, false to fall back to the typical scan mode
+ * ***********************************************************************************************************/
+bool calibrate_lidar(ILidarDriver* drv, IChannel* channel, sl_u16 &scan_mode) {
+    const sl_u32 baud_rates[] = {2000000, 1500000, 1000000, 460800, 256000, 115200};
+    LidarCalibrationTarget target;
+    LidarCalibrationResult result;
+    target.min_points_per_degree = LIDAR_MIN_POINTS_PER_DEGREE;
+    target.max_revolution_ms = LIDAR_MAX_REVOLUTION_MS;
+    target.baud_rates.assign(baud_rates, baud_rates + _countof(baud_rates));
+
+    sl_result op_result = calibrateLidar(drv, static_cast<ISerialPortChannel*>(channel), target, result);
+    printf("LIDAR CALIBRATION: baud rate %u\n", result.baud_rate);
+    for(size_t i = 0; i < result.modes.size(); i++){
+        const LidarScanModeReport& report = result.modes[i];
+        if(SL_IS_OK(report.result)){
+            printf("  mode %u (%s): %.0f of %.0f points/s, %.2f points/deg, %.1f ms/rev, max distance %.1f m%s\n",
+                report.mode.id, report.mode.scan_mode, report.points_per_second, report.nominal_points_per_second,
+                report.points_per_degree, report.revolution_ms, report.mode.max_distance, report.meets_target ? ", meets target" : "");
+        } else {
+            printf("  mode %u (%s): failed (%X)\n", report.mode.id, report.mode.scan_mode, report.result);
+        }
+    }
+    if(SL_IS_FAIL(op_result)){
+        printf("LIDAR CALIBRATION: failed (%X), using the typical scan mode\n", op_result);
+        return false;
+    }
+    if(!result.target_met){
+        printf("LIDAR CALIBRATION: no mode meets %.2f points/deg at %.1f ms/rev, using the closest one\n", target.min_points_per_degree, target.max_revolution_ms);
+    }
+    printf("LIDAR CALIBRATION: selected mode %u\n", result.selected_mode);
+    scan_mode = result.selected_mode;
+    return true;
+}
+
+/**************************************************************************************************************
+ * void report_lidar_health(ILidarDriver* drv, LidarStatistics &last)
+ * Description: every LIDAR_HEALTH_PERIOD_NS print the data rate of the lidar link, the frames lost to
+ * checksum / CRC errors and sync losses, and the rotation frequency. A saturated link shows up as lost
+ * frames, a dying motor as a rotation frequency below LIDAR_MIN_ROTATION_HZ.
+ *
+ *input: scanning lidar driver, counters of the previous report (zeroed before the first call)
+ *output: last is updated when a report has been printed
+ * ***********************************************************************************************************/
+void report_lidar_health(ILidarDriver* drv, LidarStatistics &last) {
+    LidarStatistics stats;
+    drv->getStatistics(stats);
+    if(last.timestamp_ns && (stats.timestamp_ns - last.timestamp_ns < LIDAR_HEALTH_PERIOD_NS)){
+        return;
+    }
+    if(last.timestamp_ns){
+        double seconds = (stats.timestamp_ns - last.timestamp_ns) / 1e9;
+        unsigned long long errors = (stats.checksum_errors - last.checksum_errors) + (stats.crc_errors - last.crc_errors);
+        unsigned long long losses = stats.sync_losses - last.sync_losses;
+        printf("LIDAR: %.0f bytes/s, %.0f revolutions/s, %zu points/rev, %.1f Hz, %llu bad frames, %llu sync losses\n",
+            (stats.bytes_received - last.bytes_received) / seconds, (stats.revolutions - last.revolutions) / seconds,
+            stats.points_per_revolution, stats.rotation_frequency_hz, errors, losses);
+        if(stats.rotation_frequency_hz < LIDAR_MIN_ROTATION_HZ){
+            printf("LIDAR WARNING: rotation at %.1f Hz, check the motor\n", stats.rotation_frequency_hz);
+        } else {
+
+        }
+    } else {
+
+    }
+    last = stats;
+}
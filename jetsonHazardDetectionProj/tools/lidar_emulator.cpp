@@ -0,0 +1,961 @@
+/**************************************************************************************************************
+ * Lidar emulator
+ *
+ * Description:
+ * Emulates Slamtec serial lidars on pseudo-terminals, so the unmodified SDK driver and the hazarddetect
+ * loop can run without the hardware, at sample rates, baud rates and device counts the bench lidar
+ * cannot provide.
+ *
+ * Every emulated device opens a pty and links its slave side to the requested path. It answers the
+ * commands of sl_lidar_cmd.h the way an A1 class device with firmware 1.29 does: device info and health,
+ * sample rate, the scan mode configuration queries and the autobaud handshake. It streams every answer
+ * type of the protocol, one scan mode each:
+ *
+ *     0 Standard     measurement nodes        2 kHz
+ *     1 Express      capsules                 4 kHz
+ *     2 Boost        ultra capsules           8 kHz    typical mode
+ *     3 Dense        dense capsules           8 kHz
+ *     4 HQ           HQ capsules (CRC32)      8 kHz
+ *
+ * The samples are taken from a synthetic room (optionally with a pillar in front of the lidar, which can
+ * move towards it) or from a scene file. The stream is paced like a UART at the rate the host configured
+ * on the port, or at a fixed rate, and frames the link cannot carry are dropped, as a real device would
+ * lose them. Corruption can be injected into every Nth frame.
+ *
+ * Example, two devices feeding hazarddetect through the emulator:
+ *     ./lidar_emulator --link /tmp/ttyLIDAR --devices 2 --obstacle 1500 --approach 300
+ *     ./hazarddetect --lidar /tmp/ttyLIDAR0
+ *
+ * Author: pontred
+ *************************************************************************************************************/
+#include "sl_lidar_cmd.h"
+#include "sl_crc.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <math.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#define EMULATOR_TICK_MS 1
+// the port rate is sampled at this interval when the stream follows it
+#define EMULATOR_BAUD_POLL_MS 100
+// frames are dropped once this much output is waiting for the link (in milliseconds of transfer)
+#define EMULATOR_BACKLOG_MS 100
+#define EMULATOR_MAX_DISTANCE_MM 12000.0f
+#define EMULATOR_SCENE_BINS 3600
+
+static const double PI = 3.14159265358979323846;
+
+static std::atomic<bool> running(true);
+
+void sig_handler(int signo){
+    if(signo == SIGINT || signo == SIGTERM){
+        running = false;
+    }
+}
+
+struct EmulatorOptions{
+    std::string link;
+    int devices;
+    // fixed pacing rate (bits/s), -1 follows the rate set on the port, 0 disables pacing
+    int baud;
+    // rates above it are misdetected by the autobaud handshake, like on a device whose UART cannot reach them
+    int max_baud;
+    float rotation_hz;
+    float room_width_mm;
+    float room_length_mm;
+    float obstacle_mm;
+    float obstacle_radius_mm;
+    float approach_mm_s;
+    std::string scene_path;
+    int corrupt_every;
+};
+
+enum FrameKind{
+    FRAME_STANDARD,
+    FRAME_EXPRESS,
+    FRAME_ULTRA,
+    FRAME_DENSE,
+    FRAME_HQ,
+};
+
+struct EmulatedScanMode{
+    const char* name;
+    sl_u8 ans_type;
+    FrameKind frame;
+    float us_per_sample;
+};
+
+static const EmulatedScanMode SCAN_MODES[] = {
+    { "Standard", SL_LIDAR_ANS_TYPE_MEASUREMENT, FRAME_STANDARD, 500.0f },
+    { "Express", SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, FRAME_EXPRESS, 250.0f },
+    { "Boost", SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, FRAME_ULTRA, 125.0f },
+    { "Dense", SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, FRAME_DENSE, 125.0f },
+    { "HQ", SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ, FRAME_HQ, 125.0f },
+};
+static const sl_u16 SCAN_MODE_COUNT = sizeof(SCAN_MODES) / sizeof(SCAN_MODES[0]);
+static const sl_u16 TYPICAL_SCAN_MODE = 2;
+
+static sl_u64 monotonic_ns(){
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (sl_u64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**************************************************************************************************************
+ * Scene
+ * Distance seen by the lidar in every direction, 0 means no return. Angles are in degrees, clockwise from
+ * the front of the lidar like the driver reports them.
+ *
+ * A scene file holds one "angle_deg distance_mm" pair per line ('#' starts a comment), for example a
+ * revolution dumped from a real lidar. Directions without a sample take the closest sample within 1 degree.
+ *************************************************************************************************************/
+class Scene{
+public:
+    explicit Scene(const EmulatorOptions& options)
+        : _options(options)
+    {
+    }
+
+    bool load(const std::string& path){
+        FILE* file = fopen(path.c_str(), "r");
+        if(!file){
+            return false;
+        }
+        std::vector<float> bins(EMULATOR_SCENE_BINS, -1.0f);
+        char line[256];
+        while(fgets(line, sizeof(line), file)){
+            char* comment = strchr(line, '#');
+            if(comment){
+                *comment = 0;
+            }
+            float angle, distance;
+            if(sscanf(line, "%f %f", &angle, &distance) != 2){
+                continue;
+            }
+            angle = fmodf(angle, 360.0f);
+            if(angle < 0){
+                angle += 360.0f;
+            }
+            bins[(int)(angle * EMULATOR_SCENE_BINS / 360.0f) % EMULATOR_SCENE_BINS] = distance;
+        }
+        fclose(file);
+
+        // fill the directions without a sample from their closest neighbour
+        const int reach = EMULATOR_SCENE_BINS / 360;
+        _bins.assign(EMULATOR_SCENE_BINS, 0.0f);
+        for(int bin = 0; bin < EMULATOR_SCENE_BINS; bin++){
+            for(int offset = 0; offset <= reach; offset++){
+                float before = bins[(bin - offset + EMULATOR_SCENE_BINS) % EMULATOR_SCENE_BINS];
+                float after = bins[(bin + offset) % EMULATOR_SCENE_BINS];
+                if(before >= 0 || after >= 0){
+                    _bins[bin] = before >= 0 ? before : after;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    float distance(double angle_deg, double time_s) const{
+        angle_deg = fmod(angle_deg, 360.0);
+        if(angle_deg < 0){
+            angle_deg += 360.0;
+        }
+        float distance = _bins.empty() ? _room(angle_deg) : _bins[(int)(angle_deg * EMULATOR_SCENE_BINS / 360.0) % EMULATOR_SCENE_BINS];
+        float pillar = _pillar(angle_deg, time_s);
+        if(pillar > 0 && (distance <= 0 || pillar < distance)){
+            distance = pillar;
+        }
+        return distance > EMULATOR_MAX_DISTANCE_MM ? 0.0f : distance;
+    }
+
+private:
+    // lidar in the middle of a rectangular room, the front (0 degree) facing along its length
+    float _room(double angle_deg) const{
+        double rad = angle_deg * PI / 180.0;
+        double front = fabs(cos(rad));
+        double side = fabs(sin(rad));
+        double to_end = front > 1e-9 ? (_options.room_length_mm / 2) / front : 1e12;
+        double to_side = side > 1e-9 ? (_options.room_width_mm / 2) / side : 1e12;
+        return (float)std::min(to_end, to_side);
+    }
+
+    // round pillar straight in front of the lidar, closing in at approach_mm_s and starting over when it gets too close
+    float _pillar(double angle_deg, double time_s) const{
+        if(_options.obstacle_mm <= 0){
+            return 0.0f;
+        }
+        double radius = _options.obstacle_radius_mm;
+        double travel = _options.obstacle_mm - radius - 100.0;
+        double center = _options.obstacle_mm;
+        if(_options.approach_mm_s > 0 && travel > 0){
+            center -= fmod(time_s * _options.approach_mm_s, travel);
+        }
+
+        // ray from the lidar against the circle centered at (center, 0)
+        double rad = angle_deg * PI / 180.0;
+        double along = center * cos(rad);
+        double off_axis = center * sin(rad);
+        double squared = radius * radius - off_axis * off_axis;
+        if(along <= 0 || squared < 0){
+            return 0.0f;
+        }
+        return (float)(along - sqrt(squared));
+    }
+
+    const EmulatorOptions& _options;
+    std::vector<float> _bins;
+};
+
+/**************************************************************************************************************
+ * Frame encoding helpers, the inverse of the SDK decoders
+ *************************************************************************************************************/
+static sl_u8 xor_checksum(const sl_u8* data, size_t size){
+    sl_u8 checksum = 0;
+    for(size_t pos = 0; pos < size; pos++){
+        checksum ^= data[pos];
+    }
+    return checksum;
+}
+
+// express and ultra capsules: sync nibbles around the checksum of everything after the first two bytes
+static void seal_capsule(sl_u8* frame, size_t size){
+    sl_u8 checksum = xor_checksum(frame + 2, size - 2);
+    frame[0] = (SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xF);
+    frame[1] = (SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4);
+}
+
+// variable bit scale of the ultra capsules, returns the 12 bit code and the level of the decoded value
+static sl_u32 varbitscale_encode(sl_u32 distance_mm, sl_u32& level){
+    static const sl_u32 SCALED_BASE[] = { SL_LIDAR_VARBITSCALE_X16_DEST_VAL, SL_LIDAR_VARBITSCALE_X8_DEST_VAL,
+        SL_LIDAR_VARBITSCALE_X4_DEST_VAL, SL_LIDAR_VARBITSCALE_X2_DEST_VAL, 0 };
+    static const sl_u32 TARGET_BASE[] = { 1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT, 1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT,
+        1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT, 1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT, 0 };
+    static const sl_u32 LEVEL[] = { 4, 3, 2, 1, 0 };
+
+    for(int i = 0; i < 5; i++){
+        if(distance_mm >= TARGET_BASE[i]){
+            level = LEVEL[i];
+            return std::min<sl_u32>(SCALED_BASE[i] + ((distance_mm - TARGET_BASE[i]) >> level), 0xFFF);
+        }
+    }
+    level = 0;
+    return 0;
+}
+
+static sl_u32 varbitscale_decode(sl_u32 scaled, sl_u32& level){
+    static const sl_u32 SCALED_BASE[] = { SL_LIDAR_VARBITSCALE_X16_DEST_VAL, SL_LIDAR_VARBITSCALE_X8_DEST_VAL,
+        SL_LIDAR_VARBITSCALE_X4_DEST_VAL, SL_LIDAR_VARBITSCALE_X2_DEST_VAL, 0 };
+    static const sl_u32 TARGET_BASE[] = { 1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT, 1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT,
+        1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT, 1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT, 0 };
+    static const sl_u32 LEVEL[] = { 4, 3, 2, 1, 0 };
+
+    for(int i = 0; i < 5; i++){
+        if(scaled >= SCALED_BASE[i]){
+            level = LEVEL[i];
+            return TARGET_BASE[i] + ((scaled - SCALED_BASE[i]) << level);
+        }
+    }
+    level = 0;
+    return 0;
+}
+
+// ultra capsule samples are reported this far (degrees) before their raw angle, see the SDK decoder
+static double ultra_angle_offset(sl_u32 distance_q2){
+    int offset_q16 = (int)(7.5 * 3.1415926535 * (1 << 16) / 180.0);
+    if(distance_q2 >= 50 * 4){
+        const int k1 = 98361;
+        const int k2 = int(k1 / distance_q2);
+        offset_q16 = (int)(8 * 3.1415926535 * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
+    }
+    return int(offset_q16 * 180 / 3.14159265) / 65536.0;
+}
+
+// 10 bit signed difference to the base distance, the two extreme codes mean no return
+static sl_u32 ultra_predict(sl_u32 distance_mm, sl_u32 base_mm, sl_u32 level){
+    if(!distance_mm || !base_mm){
+        return 0x1FF;
+    }
+    int predict = ((int)distance_mm - (int)base_mm) >> level;
+    predict = std::max(-511, std::min(510, predict));
+    return (sl_u32)predict & 0x3FF;
+}
+
+/**************************************************************************************************************
+ * EmulatedLidar
+ * One device on its own pty, served by its own thread
+ *************************************************************************************************************/
+class EmulatedLidar{
+public:
+    EmulatedLidar(const EmulatorOptions& options, const Scene& scene, int index)
+        : _options(options)
+        , _scene(scene)
+        , _index(index)
+        , _master(-1)
+        , _slave(-1)
+        , _port_baud(115200)
+        , _mode(-1)
+        , _autobaud_answered(false)
+        , _frames_sent(0)
+        , _frames_dropped(0)
+        , _bytes_sent(0)
+        , _commands(0)
+    {
+    }
+
+    ~EmulatedLidar(){
+        if(!_link.empty()){
+            unlink(_link.c_str());
+        }
+        if(_slave >= 0){
+            close(_slave);
+        }
+        if(_master >= 0){
+            close(_master);
+        }
+    }
+
+    bool open(const std::string& link){
+        _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if(_master < 0 || grantpt(_master) != 0 || unlockpt(_master) != 0){
+            return false;
+        }
+        const char* slave_name = ptsname(_master);
+        if(!slave_name){
+            return false;
+        }
+        // keeping the slave open keeps the master readable while no host has the port open
+        _slave = ::open(slave_name, O_RDWR | O_NOCTTY);
+        if(_slave < 0){
+            return false;
+        }
+
+        // raw mode, the line discipline would otherwise echo the stream back as commands
+        struct termios2 tio;
+        if(ioctl(_slave, TCGETS2, &tio) != 0){
+            return false;
+        }
+        tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+        tio.c_oflag &= ~OPOST;
+        tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        tio.c_cflag &= ~(CSIZE | PARENB);
+        tio.c_cflag |= CS8;
+        if(ioctl(_slave, TCSETS2, &tio) != 0){
+            return false;
+        }
+
+        unlink(link.c_str());
+        if(symlink(slave_name, link.c_str()) != 0){
+            return false;
+        }
+        _link = link;
+        printf("lidar %d on %s (%s)\n", _index, link.c_str(), slave_name);
+        return true;
+    }
+
+    void run(){
+        sl_u64 last_tick = monotonic_ns();
+        sl_u64 last_baud_poll = 0;
+        double budget = 0;
+
+        while(running){
+            pollfd pfd = { _master, POLLIN, 0 };
+            poll(&pfd, 1, EMULATOR_TICK_MS);
+
+            sl_u64 now = monotonic_ns();
+            if(now - last_baud_poll >= EMULATOR_BAUD_POLL_MS * 1000000ULL){
+                _port_baud = _readPortBaud();
+                last_baud_poll = now;
+            }
+
+            _receive();
+            _generate(now);
+
+            // UART pacing: 10 bits per byte
+            int baud = _paceBaud();
+            if(baud > 0){
+                budget += (now - last_tick) * 1e-9 * baud / 10.0;
+                budget = std::min(budget, baud / 10.0 * 2 * EMULATOR_TICK_MS / 1000.0 + 1);
+            } else {
+                budget = (double)_tx.size();
+            }
+            last_tick = now;
+            budget -= _send((size_t)budget);
+        }
+    }
+
+    void report() const{
+        printf("lidar %d: %llu commands, %llu frames sent, %llu frames dropped by the link, %llu bytes\n", _index,
+            (unsigned long long)_commands, (unsigned long long)_frames_sent, (unsigned long long)_frames_dropped,
+            (unsigned long long)_bytes_sent);
+    }
+
+private:
+    int _paceBaud() const{
+        return _options.baud < 0 ? _port_baud : _options.baud;
+    }
+
+    int _readPortBaud() const{
+        struct termios2 tio;
+        if(ioctl(_slave, TCGETS2, &tio) != 0 || !tio.c_ospeed){
+            return _port_baud;
+        }
+        return (int)tio.c_ospeed;
+    }
+
+    size_t _send(size_t max_bytes){
+        size_t count = std::min(max_bytes, _tx.size());
+        if(!count){
+            return 0;
+        }
+        ssize_t written = write(_master, &_tx[0], count);
+        if(written <= 0){
+            return 0;
+        }
+        _tx.erase(_tx.begin(), _tx.begin() + written);
+        _bytes_sent += written;
+        return (size_t)written;
+    }
+
+    /**********************************************************************************************************
+     * Commands
+     *********************************************************************************************************/
+    void _receive(){
+        sl_u8 buffer[512];
+        ssize_t count;
+        while((count = read(_master, buffer, sizeof(buffer))) > 0){
+            _rx.insert(_rx.end(), buffer, buffer + count);
+        }
+
+        size_t pos = 0;
+        while(pos < _rx.size()){
+            if(_rx[pos] == SL_LIDAR_AUTOBAUD_MAGICBYTE){
+                while(pos < _rx.size() && _rx[pos] == SL_LIDAR_AUTOBAUD_MAGICBYTE){
+                    pos++;
+                }
+                if(!_autobaud_answered){
+                    sl_u32 detected = _port_baud <= _options.max_baud ? _port_baud : _port_baud / 2;
+                    _reply(&detected, sizeof(detected));
+                    _autobaud_answered = true;
+                }
+                continue;
+            }
+            if(_rx[pos] != SL_LIDAR_CMD_SYNC_BYTE){
+                pos++;
+                continue;
+            }
+            if(_rx.size() - pos < 2){
+                break;
+            }
+
+            sl_u8 cmd = _rx[pos + 1];
+            size_t size = 2;
+            const sl_u8* payload = NULL;
+            size_t payload_size = 0;
+            if(cmd & SL_LIDAR_CMDFLAG_HAS_PAYLOAD){
+                if(_rx.size() - pos < 3 || _rx.size() - pos < 4u + _rx[pos + 2]){
+                    break;
+                }
+                payload_size = _rx[pos + 2];
+                payload = &_rx[pos + 3];
+                size = 4 + payload_size;
+                // a command with a bad checksum is ignored by the device
+                if(xor_checksum(&_rx[pos], size - 1) != _rx[pos + size - 1]){
+                    pos++;
+                    continue;
+                }
+            }
+            _autobaud_answered = false;
+            _command(cmd, payload, payload_size);
+            pos += size;
+        }
+        _rx.erase(_rx.begin(), _rx.begin() + pos);
+    }
+
+    void _command(sl_u8 cmd, const sl_u8* payload, size_t payload_size){
+        _commands++;
+        switch(cmd){
+        case SL_LIDAR_CMD_STOP:
+        case SL_LIDAR_CMD_RESET:
+            _mode = -1;
+            _tx.clear();
+            break;
+        case SL_LIDAR_CMD_SCAN:
+        case SL_LIDAR_CMD_FORCE_SCAN:
+            _startScan(0);
+            break;
+        case SL_LIDAR_CMD_EXPRESS_SCAN:
+        {
+            // the legacy express request (working mode 0) runs the express capsules
+            sl_u8 mode = payload_size >= 1 ? payload[0] : 0;
+            _startScan(mode == 0 || mode >= SCAN_MODE_COUNT ? 1 : mode);
+            break;
+        }
+        case SL_LIDAR_CMD_HQ_SCAN:
+            _startScan(4);
+            break;
+        case SL_LIDAR_CMD_GET_DEVICE_INFO:
+        {
+            sl_lidar_response_device_info_t info;
+            info.model = 0x18;
+            info.firmware_version = (1 << 8) | 29;
+            info.hardware_version = 7;
+            for(size_t i = 0; i < sizeof(info.serialnum); i++){
+                info.serialnum[i] = (sl_u8)(0xE0 + i);
+            }
+            info.serialnum[sizeof(info.serialnum) - 1] = (sl_u8)_index;
+            _answer(SL_LIDAR_ANS_TYPE_DEVINFO, &info, sizeof(info));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_DEVICE_HEALTH:
+        {
+            sl_lidar_response_device_health_t health;
+            health.status = SL_LIDAR_STATUS_OK;
+            health.error_code = 0;
+            _answer(SL_LIDAR_ANS_TYPE_DEVHEALTH, &health, sizeof(health));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_SAMPLERATE:
+        {
+            sl_lidar_response_sample_rate_t rate;
+            rate.std_sample_duration_us = (sl_u16)SCAN_MODES[0].us_per_sample;
+            rate.express_sample_duration_us = (sl_u16)SCAN_MODES[1].us_per_sample;
+            _answer(SL_LIDAR_ANS_TYPE_SAMPLE_RATE, &rate, sizeof(rate));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_ACC_BOARD_FLAG:
+        {
+            sl_lidar_response_acc_board_flag_t flag;
+            flag.support_flag = 0;
+            _answer(SL_LIDAR_ANS_TYPE_ACC_BOARD_FLAG, &flag, sizeof(flag));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_LIDAR_CONF:
+            if(payload_size >= sizeof(sl_u32)){
+                _answerConf(payload, payload_size);
+            } else {
+
+            }
+            break;
+        default:
+            // motor control and the baudrate confirmation take no answer
+            break;
+        }
+    }
+
+    void _answerConf(const sl_u8* payload, size_t payload_size){
+        sl_u32 type;
+        memcpy(&type, payload, sizeof(type));
+        sl_u16 mode = 0;
+        if(payload_size >= sizeof(type) + sizeof(mode)){
+            memcpy(&mode, payload + sizeof(type), sizeof(mode));
+        } else {
+
+        }
+        if(mode >= SCAN_MODE_COUNT){
+            return;
+        } else {
+
+        }
+
+        std::vector<sl_u8> answer((const sl_u8*)&type, (const sl_u8*)&type + sizeof(type));
+        switch(type){
+        case SL_LIDAR_CONF_SCAN_MODE_COUNT:
+            _append(answer, SCAN_MODE_COUNT);
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_TYPICAL:
+            _append(answer, TYPICAL_SCAN_MODE);
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_US_PER_SAMPLE:
+            _append(answer, (sl_u32)(SCAN_MODES[mode].us_per_sample * 256));
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_MAX_DISTANCE:
+            _append(answer, (sl_u32)(EMULATOR_MAX_DISTANCE_MM / 1000 * 256));
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_ANS_TYPE:
+            _append(answer, SCAN_MODES[mode].ans_type);
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_NAME:
+            answer.insert(answer.end(), SCAN_MODES[mode].name, SCAN_MODES[mode].name + strlen(SCAN_MODES[mode].name) + 1);
+            break;
+        case SL_LIDAR_CONF_DESIRED_ROT_FREQ:
+        {
+            sl_lidar_response_desired_rot_speed_t speed;
+            speed.rpm = (sl_u16)(_options.rotation_hz * 60);
+            speed.pwm_ref = 660;
+            _append(answer, speed);
+            break;
+        }
+        default:
+            // an unknown configuration entry is not answered
+            return;
+        }
+        _answer(SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF, &answer[0], answer.size());
+    }
+
+    template <typename T>
+    static void _append(std::vector<sl_u8>& buffer, const T& value){
+        const sl_u8* bytes = reinterpret_cast<const sl_u8*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+
+    void _answer(sl_u8 type, const void* data, size_t size, bool loop = false){
+        sl_lidar_ans_header_t header;
+        header.syncByte1 = SL_LIDAR_ANS_SYNC_BYTE1;
+        header.syncByte2 = SL_LIDAR_ANS_SYNC_BYTE2;
+        header.size_q30_subtype = (sl_u32)size | (loop ? (SL_LIDAR_ANS_PKTFLAG_LOOP << SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT) : 0);
+        header.type = type;
+        _reply(&header, sizeof(header));
+        if(data){
+            _reply(data, size);
+        } else {
+
+        }
+    }
+
+    void _reply(const void* data, size_t size){
+        const sl_u8* bytes = reinterpret_cast<const sl_u8*>(data);
+        _tx.insert(_tx.end(), bytes, bytes + size);
+    }
+
+    /**********************************************************************************************************
+     * Scan stream
+     *********************************************************************************************************/
+    static size_t _frameSize(FrameKind frame){
+        switch(frame){
+        case FRAME_STANDARD:
+            return sizeof(sl_lidar_response_measurement_node_t);
+        case FRAME_EXPRESS:
+            return sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+        case FRAME_ULTRA:
+            return sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t);
+        case FRAME_DENSE:
+            return sizeof(sl_lidar_response_dense_capsule_measurement_nodes_t);
+        case FRAME_HQ:
+            return sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t);
+        }
+        return 0;
+    }
+
+    static size_t _samplesPerFrame(FrameKind frame){
+        switch(frame){
+        case FRAME_STANDARD:
+            return 1;
+        case FRAME_EXPRESS:
+            return 32;
+        case FRAME_ULTRA:
+        case FRAME_HQ:
+            return 96;
+        case FRAME_DENSE:
+            return 40;
+        }
+        return 1;
+    }
+
+    void _startScan(int mode){
+        _answer(SCAN_MODES[mode].ans_type, NULL, _frameSize(SCAN_MODES[mode].frame), true);
+        _mode = mode;
+        _scan_start_ns = monotonic_ns();
+        _next_sample = 0;
+        _frame_count = 0;
+    }
+
+    double _sampleAngle(sl_u64 sample) const{
+        double degrees_per_sample = 360.0 * _options.rotation_hz * SCAN_MODES[_mode].us_per_sample * 1e-6;
+        return fmod(sample * degrees_per_sample, 360.0);
+    }
+
+    double _sampleTime(sl_u64 sample) const{
+        return sample * SCAN_MODES[_mode].us_per_sample * 1e-6;
+    }
+
+    float _sampleDistance(sl_u64 sample) const{
+        return _scene.distance(_sampleAngle(sample), _sampleTime(sample));
+    }
+
+    void _generate(sl_u64 now){
+        if(_mode < 0 || now < _scan_start_ns){
+            return;
+        }
+        const EmulatedScanMode& mode = SCAN_MODES[_mode];
+        size_t frame_size = _frameSize(mode.frame);
+        size_t per_frame = _samplesPerFrame(mode.frame);
+        sl_u64 due = (sl_u64)((now - _scan_start_ns) / (mode.us_per_sample * 1000.0));
+
+        int baud = _paceBaud();
+        size_t backlog = baud > 0 ? (size_t)(baud / 10.0 * EMULATOR_BACKLOG_MS / 1000.0) : (64u << 10);
+
+        std::vector<sl_u8> frame(frame_size);
+        while(_next_sample + per_frame <= due){
+            if(_tx.size() + frame_size > backlog){
+                // the link cannot carry the scan mode at this rate
+                _frames_dropped++;
+            } else {
+                _encode(mode.frame, _next_sample, &frame[0]);
+                _frame_count++;
+                if(_options.corrupt_every > 0 && _frame_count % _options.corrupt_every == 0){
+                    frame[frame_size / 2] ^= 0x5A;
+                } else {
+
+                }
+                _reply(&frame[0], frame_size);
+                _frames_sent++;
+            }
+            _next_sample += per_frame;
+        }
+    }
+
+    void _encode(FrameKind kind, sl_u64 sample, sl_u8* frame){
+        switch(kind){
+        case FRAME_STANDARD:
+            _encodeStandard(sample, reinterpret_cast<sl_lidar_response_measurement_node_t*>(frame));
+            break;
+        case FRAME_EXPRESS:
+            _encodeExpress(sample, reinterpret_cast<sl_lidar_response_capsule_measurement_nodes_t*>(frame));
+            seal_capsule(frame, _frameSize(kind));
+            break;
+        case FRAME_ULTRA:
+            _encodeUltra(sample, reinterpret_cast<sl_lidar_response_ultra_capsule_measurement_nodes_t*>(frame));
+            seal_capsule(frame, _frameSize(kind));
+            break;
+        case FRAME_DENSE:
+            _encodeDense(sample, reinterpret_cast<sl_lidar_response_dense_capsule_measurement_nodes_t*>(frame));
+            seal_capsule(frame, _frameSize(kind));
+            break;
+        case FRAME_HQ:
+            _encodeHq(sample, reinterpret_cast<sl_lidar_response_hq_capsule_measurement_nodes_t*>(frame));
+            break;
+        }
+    }
+
+    bool _isRevolutionStart(sl_u64 sample) const{
+        return sample == 0 || _sampleAngle(sample) < _sampleAngle(sample - 1);
+    }
+
+    // the first capsule after the scan started carries the sync bit, the decoders restart from it
+    sl_u16 _capsuleStartAngle(sl_u64 sample) const{
+        sl_u16 angle_q6 = (sl_u16)(_sampleAngle(sample) * 64) & 0x7FFF;
+        return sample == 0 ? (angle_q6 | SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT) : angle_q6;
+    }
+
+    static sl_u8 _quality(float distance){
+        return distance > 0 ? (0x2F << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+    }
+
+    void _encodeStandard(sl_u64 sample, sl_lidar_response_measurement_node_t* node){
+        int sync = _isRevolutionStart(sample) ? 1 : 0;
+        float distance = _sampleDistance(sample);
+        node->sync_quality = (distance > 0 ? (15 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0) | ((!sync) << 1) | sync;
+        node->angle_q6_checkbit = (sl_u16)(((sl_u16)(_sampleAngle(sample) * 64) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT);
+        node->distance_q2 = (sl_u16)std::min(distance * 4, 65535.0f);
+    }
+
+    void _encodeExpress(sl_u64 sample, sl_lidar_response_capsule_measurement_nodes_t* capsule){
+        capsule->start_angle_sync_q6 = _capsuleStartAngle(sample);
+        for(size_t cabin = 0; cabin < 16; cabin++){
+            // no angle offsets, the samples sit on the interpolated angles
+            sl_u16 first = (sl_u16)std::min(_sampleDistance(sample + cabin * 2) * 4, 65532.0f);
+            sl_u16 second = (sl_u16)std::min(_sampleDistance(sample + cabin * 2 + 1) * 4, 65532.0f);
+            capsule->cabins[cabin].distance_angle_1 = first & 0xFFFC;
+            capsule->cabins[cabin].distance_angle_2 = second & 0xFFFC;
+            capsule->cabins[cabin].offset_angles_q3 = 0;
+        }
+    }
+
+    void _encodeDense(sl_u64 sample, sl_lidar_response_dense_capsule_measurement_nodes_t* capsule){
+        capsule->start_angle_sync_q6 = _capsuleStartAngle(sample);
+        for(size_t cabin = 0; cabin < 40; cabin++){
+            capsule->cabins[cabin].distance = (sl_u16)_sampleDistance(sample + cabin);
+        }
+    }
+
+    // distance of an ultra capsule sample, taken where the decoder will place it once its offset is removed
+    sl_u32 _ultraDistance(sl_u64 sample) const{
+        double raw = _sampleAngle(sample);
+        double time_s = _sampleTime(sample);
+        float distance = _scene.distance(raw - ultra_angle_offset(0), time_s);
+        distance = _scene.distance(raw - ultra_angle_offset((sl_u32)(distance * 4)), time_s);
+        return (sl_u32)distance;
+    }
+
+    void _encodeUltra(sl_u64 sample, sl_lidar_response_ultra_capsule_measurement_nodes_t* capsule){
+        capsule->start_angle_sync_q6 = _capsuleStartAngle(sample);
+
+        // the major distance of each cabin, plus the first one of the next capsule which the last cabin refers to
+        sl_u32 major[33];
+        sl_u32 level[33];
+        sl_u32 base[33];
+        for(size_t cabin = 0; cabin <= 32; cabin++){
+            major[cabin] = varbitscale_encode(_ultraDistance(sample + cabin * 3), level[cabin]);
+            base[cabin] = varbitscale_decode(major[cabin], level[cabin]);
+        }
+
+        for(size_t cabin = 0; cabin < 32; cabin++){
+            sl_u32 base1 = base[cabin];
+            sl_u32 level1 = level[cabin];
+            if(!major[cabin] && major[cabin + 1]){
+                base1 = base[cabin + 1];
+                level1 = level[cabin + 1];
+            } else {
+
+            }
+            sl_u32 predict1 = ultra_predict(_ultraDistance(sample + cabin * 3 + 1), base1, level1);
+            sl_u32 predict2 = ultra_predict(_ultraDistance(sample + cabin * 3 + 2), base[cabin + 1], level[cabin + 1]);
+            capsule->ultra_cabins[cabin].combined_x3 = (major[cabin] & 0xFFF) | (predict1 << 12) | (predict2 << 22);
+        }
+    }
+
+    void _encodeHq(sl_u64 sample, sl_lidar_response_hq_capsule_measurement_nodes_t* capsule){
+        capsule->sync_byte = SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC;
+        // device clock in microseconds, 0 would mean the device does not report it
+        capsule->time_stamp = (sl_u64)(_sampleTime(sample) * 1e6) + 1;
+        for(size_t pos = 0; pos < 96; pos++){
+            float distance = _sampleDistance(sample + pos);
+            sl_lidar_response_measurement_node_hq_t& node = capsule->node_hq[pos];
+            node.angle_z_q14 = (sl_u16)(_sampleAngle(sample + pos) * 16384 / 90);
+            node.dist_mm_q2 = (sl_u32)(distance * 4);
+            node.quality = _quality(distance);
+            node.flag = _isRevolutionStart(sample + pos) ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+        }
+        capsule->crc32 = sl::crc32::getResult(reinterpret_cast<sl_u8*>(capsule), sizeof(*capsule) - sizeof(capsule->crc32));
+    }
+
+    const EmulatorOptions& _options;
+    const Scene& _scene;
+    int _index;
+    std::string _link;
+    int _master;
+    int _slave;
+    int _port_baud;
+
+    std::vector<sl_u8> _rx;
+    std::vector<sl_u8> _tx;
+
+    // running scan mode, -1 when idle
+    int _mode;
+    sl_u64 _scan_start_ns;
+    sl_u64 _next_sample;
+    sl_u64 _frame_count;
+    bool _autobaud_answered;
+
+    sl_u64 _frames_sent;
+    sl_u64 _frames_dropped;
+    sl_u64 _bytes_sent;
+    sl_u64 _commands;
+};
+
+static void print_usage(const char* name){
+    printf("usage: %s [options]\n"
+        "  --link PATH          symlink to the emulated port (default /tmp/ttyLIDAR), numbered with --devices\n"
+        "  --devices N          number of emulated lidars (default 1)\n"
+        "  --baud N             pace the stream at N bits/s, 0 for no pacing (default: the rate set on the port)\n"
+        "  --max-baud N         highest rate the autobaud handshake detects right (default 1000000)\n"
+        "  --hz F               rotation frequency (default 10)\n"
+        "  --room WxL           synthetic room in millimeters (default 4000x6000)\n"
+        "  --obstacle MM        pillar in front of the lidar at MM millimeters (default none)\n"
+        "  --approach MM_S      speed the pillar closes in at (default 0)\n"
+        "  --scene FILE         \"angle_deg distance_mm\" pairs instead of the synthetic room\n"
+        "  --corrupt N          corrupt one byte of every Nth frame (default 0, never)\n", name);
+}
+
+int main(int argc, char** argv){
+    EmulatorOptions options;
+    options.link = "/tmp/ttyLIDAR";
+    options.devices = 1;
+    options.baud = -1;
+    options.max_baud = 1000000;
+    options.rotation_hz = 10.0f;
+    options.room_width_mm = 4000.0f;
+    options.room_length_mm = 6000.0f;
+    options.obstacle_mm = 0.0f;
+    options.obstacle_radius_mm = 150.0f;
+    options.approach_mm_s = 0.0f;
+    options.corrupt_every = 0;
+
+    for(int i = 1; i < argc; i++){
+        bool has_value = i + 1 < argc;
+        if(strcmp(argv[i], "--link") == 0 && has_value){
+            options.link = argv[++i];
+        } else if(strcmp(argv[i], "--devices") == 0 && has_value){
+            options.devices = std::max(1, atoi(argv[++i]));
+        } else if(strcmp(argv[i], "--baud") == 0 && has_value){
+            options.baud = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--max-baud") == 0 && has_value){
+            options.max_baud = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--hz") == 0 && has_value){
+            options.rotation_hz = (float)atof(argv[++i]);
+        } else if(strcmp(argv[i], "--room") == 0 && has_value){
+            if(sscanf(argv[++i], "%fx%f", &options.room_width_mm, &options.room_length_mm) != 2){
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--obstacle") == 0 && has_value){
+            options.obstacle_mm = (float)atof(argv[++i]);
+        } else if(strcmp(argv[i], "--approach") == 0 && has_value){
+            options.approach_mm_s = (float)atof(argv[++i]);
+        } else if(strcmp(argv[i], "--scene") == 0 && has_value){
+            options.scene_path = argv[++i];
+        } else if(strcmp(argv[i], "--corrupt") == 0 && has_value){
+            options.corrupt_every = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(options.rotation_hz <= 0){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Scene scene(options);
+    if(!options.scene_path.empty() && !scene.load(options.scene_path)){
+        fprintf(stderr, "cannot read the scene %s\n", options.scene_path.c_str());
+        return 1;
+    }
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+    // keep the port announcements and the report in order when the output is logged
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    bool opened = true;
+    std::vector<EmulatedLidar*> lidars;
+    for(int i = 0; i < options.devices; i++){
+        EmulatedLidar* lidar = new EmulatedLidar(options, scene, i);
+        std::string link = options.devices > 1 ? options.link + std::to_string(i) : options.link;
+        if(!lidar->open(link)){
+            fprintf(stderr, "cannot create the port %s: %s\n", link.c_str(), strerror(errno));
+            delete lidar;
+            opened = false;
+            break;
+        }
+        lidars.push_back(lidar);
+    }
+
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < lidars.size() && opened; i++){
+        threads.push_back(std::thread(&EmulatedLidar::run, lidars[i]));
+    }
+    for(size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+
+    for(size_t i = 0; i < lidars.size(); i++){
+        lidars[i]->report();
+        delete lidars[i];
+    }
+    return opened ? 0 : 1;
+}